@@ -0,0 +1,206 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      BitMask.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef BitMask_h__
+#define BitMask_h__
+
+#include <cstring>
+#include <cstddef>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//Selection mask storing one bit per element, 64 elements are set, combined and counted per word
+class BitMask{
+public:
+	typedef unsigned long long Word;
+	enum { BITS = 64 };
+
+	inline BitMask();
+	inline explicit BitMask( const size_t, const bool = false );
+	inline BitMask( const BitMask & );
+	inline ~BitMask();
+
+	inline BitMask & operator=( const BitMask & );
+	inline void resize( const size_t, const bool = false );
+
+	inline size_t size() const { return m_size; }
+	inline size_t nbWords() const { return m_nbWords; }
+	inline bool test( const size_t _idx ) const { return ( ( m_words[_idx / BITS] >> ( _idx % BITS ) ) & 1 ) != 0; }
+	inline bool operator[]( const size_t _idx ) const { return test( _idx ); }
+	inline void set( const size_t _idx ) { m_words[_idx / BITS] |= ( Word )1 << ( _idx % BITS ); }
+	inline void reset( const size_t _idx ) { m_words[_idx / BITS] &= ~( ( Word )1 << ( _idx % BITS ) ); }
+	inline void set( const size_t _idx, const bool _val ) { if( _val ) set( _idx ); else reset( _idx ); }
+	inline Word getWord( const size_t _idx ) const { return m_words[_idx]; }
+	inline void setWord( const size_t _idx, const Word _val ) { m_words[_idx] = ( _idx == m_nbWords - 1 ) ? _val & lastWordMask() : _val; }
+
+	inline void setAll();
+	inline void clearAll();
+	inline BitMask & operator&=( const BitMask & );
+	inline BitMask & operator|=( const BitMask & );
+	inline bool operator==( const BitMask & ) const;
+	inline size_t count() const;
+
+	//Selects the elements whose value is in [_min, _max], _values( n ) returning the value of the element n
+	template < class Values > void selectInRange( const Values &, const double, const double );
+
+	static inline unsigned int popcount( const Word );
+
+protected:
+	inline Word lastWordMask() const { return ( m_size % BITS == 0 ) ? ~( Word )0 : ( ( ( Word )1 << ( m_size % BITS ) ) - 1 ); }
+
+protected:
+	Word * m_words;
+	size_t m_size, m_nbWords;
+};
+
+BitMask::BitMask():m_words( NULL ), m_size( 0 ), m_nbWords( 0 )
+{
+}
+
+BitMask::BitMask( const size_t _size, const bool _val ):m_words( NULL ), m_size( 0 ), m_nbWords( 0 )
+{
+	resize( _size, _val );
+}
+
+BitMask::BitMask( const BitMask & _o ):m_words( NULL ), m_size( 0 ), m_nbWords( 0 )
+{
+	*this = _o;
+}
+
+BitMask::~BitMask()
+{
+	if( m_words != NULL )
+		delete [] m_words;
+}
+
+BitMask & BitMask::operator=( const BitMask & _o )
+{
+	if( this == &_o ) return *this;
+	resize( _o.m_size );
+	if( m_nbWords > 0 )
+		memcpy( m_words, _o.m_words, m_nbWords * sizeof( Word ) );
+	return *this;
+}
+
+void BitMask::resize( const size_t _size, const bool _val )
+{
+	size_t nbWords = ( _size + BITS - 1 ) / BITS;
+	if( nbWords != m_nbWords ){
+		if( m_words != NULL )
+			delete [] m_words;
+		m_words = ( nbWords > 0 ) ? new Word[nbWords] : NULL;
+	}
+	m_size = _size;
+	m_nbWords = nbWords;
+	if( _val )
+		setAll();
+	else
+		clearAll();
+}
+
+bool BitMask::operator==( const BitMask & _o ) const
+{
+	if( m_size != _o.m_size ) return false;
+	return m_nbWords == 0 || memcmp( m_words, _o.m_words, m_nbWords * sizeof( Word ) ) == 0;
+}
+
+void BitMask::setAll()
+{
+	if( m_nbWords == 0 ) return;
+	memset( m_words, 0xFF, m_nbWords * sizeof( Word ) );
+	m_words[m_nbWords - 1] &= lastWordMask();
+}
+
+void BitMask::clearAll()
+{
+	if( m_nbWords > 0 )
+		memset( m_words, 0, m_nbWords * sizeof( Word ) );
+}
+
+BitMask & BitMask::operator&=( const BitMask & _o )
+{
+	for( size_t n = 0; n < m_nbWords && n < _o.m_nbWords; n++ )
+		m_words[n] &= _o.m_words[n];
+	for( size_t n = _o.m_nbWords; n < m_nbWords; n++ )
+		m_words[n] = 0;
+	return *this;
+}
+
+BitMask & BitMask::operator|=( const BitMask & _o )
+{
+	for( size_t n = 0; n < m_nbWords && n < _o.m_nbWords; n++ )
+		m_words[n] |= _o.m_words[n];
+	if( m_nbWords > 0 )
+		m_words[m_nbWords - 1] &= lastWordMask();
+	return *this;
+}
+
+size_t BitMask::count() const
+{
+	size_t nb = 0;
+	for( size_t n = 0; n < m_nbWords; n++ )
+		nb += popcount( m_words[n] );
+	return nb;
+}
+
+template < class Values >
+void BitMask::selectInRange( const Values & _values, const double _min, const double _max )
+{
+	long long nbWords = m_nbWords;
+#pragma omp parallel for
+	for( long long w = 0; w < nbWords; w++ ){
+		size_t first = ( size_t )w * BITS, last = ( first + BITS < m_size ) ? first + BITS : m_size;
+		Word bits = 0;
+		for( size_t n = first; n < last; n++ ){
+			double val = _values( n );
+			bits |= ( Word )( _min <= val && val <= _max ) << ( n - first );
+		}
+		m_words[w] = bits;
+	}
+}
+
+unsigned int BitMask::popcount( const Word _w )
+{
+#if defined( _MSC_VER ) && defined( _M_X64 )
+	return ( unsigned int )__popcnt64( _w );
+#elif defined( __GNUC__ )
+	return ( unsigned int )__builtin_popcountll( _w );
+#else
+	Word w = _w - ( ( _w >> 1 ) & 0x5555555555555555ULL );
+	w = ( w & 0x3333333333333333ULL ) + ( ( w >> 2 ) & 0x3333333333333333ULL );
+	w = ( w + ( w >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+	return ( unsigned int )( ( w * 0x0101010101010101ULL ) >> 56 );
+#endif
+}
+
+#endif // BitMask_h__
@@ -43,6 +43,9 @@
 #include "DetectionSet.hpp"
 #include "WrapperVoronoiDiagram.hpp"
 #include "DetectionCleanerWidget.hpp"
+#include "DetectionCleaner.hpp"
+#include "DetectionSetStream.hpp"
+#include "LocalizationCache.hpp"
 #include "RoiManagerWidget.hpp"
 #include "MiscQuantificationWidget.hpp"
 #include "DBScan.hpp"
@@ -570,22 +573,15 @@ void Camera2D::setSuperResObject( SuperResObject * _obj )
 
 void Camera2D::createVoronoiDiagram( const bool _cleanerChosen )
 {
-	DetectionPoint * dset = NULL;
-	int nbPoints = 0;
+	DetectionSet * dset = ( _cleanerChosen ) ? this->getDetectionSetCleaned() : this->getDetectionSet();
 
-	if( _cleanerChosen ){
-		dset = this->getDetectionSetCleaned()->getPoints();
-		nbPoints = this->getDetectionSetCleaned()->getNbPoints();
-	}
-	else{
-		dset = this->getDetectionSet()->getPoints();
-		nbPoints = this->getDetectionSet()->getNbPoints();
-	}
-
-	if( dset == NULL ) return;
+	if( dset == NULL || dset->getXs() == NULL ) return;
 
 	double w = m_superResObj->getWidth(), h = m_superResObj->getHeight();
-	WrapperVoronoiDiagram * wrapper = new WrapperVoronoiDiagram( dset, nbPoints, w, h );
+	//The current diagram is updated when only a part of the localizations changed, as after a cleaning or a crop
+	WrapperVoronoiDiagram * wrapper = m_superResObj->getVoronoiDiagram();
+	if( wrapper == NULL || wrapper->getWidth() != w || wrapper->getHeight() != h || !wrapper->update( dset ) )
+		wrapper = new WrapperVoronoiDiagram( dset, w, h );
 	m_superResObj->setVoronoiDiagram( wrapper );
 }
 
@@ -599,7 +595,25 @@ void Camera2D::cleanDetections()
 		return;
 	}
 
-	DetectionCleaner * dcleaner = new DetectionCleaner(dset, m_dcw->getSizeFixedNeighborhood(), m_dcw->getPixelSize(), m_dcw->getBackgroundValue(), m_dcw->getInt2PhotonRatio(), m_dcw->getMaxDarkTime(), m_dcw->getOptions(), m_superResObj->getDir());
+	//The localizations are read frame block by frame block from the binary file of the dataset when it already exists
+	//and still matches the dataset (no crop or cleaning since the loading), from the dataset otherwise. The source is
+	//never parsed again since the localizations are in memory
+	DetectionSetStream * stream = NULL;
+	QString binaryName = LocalizationCache::existingBinaryFile( QString( ( dset->getDir() + dset->getName() ).c_str() ) );
+	if( !binaryName.isEmpty() ){
+		stream = new DetectionSetStream( binaryName, DetectionCleaner::NB_FRAMES_PER_BLOCK );
+		if( !stream->isOpen() || stream->nbPoints() != ( unsigned int )dset->getNbPoints() || stream->nbSlices() != dset->nbSlices() ){
+			delete stream;
+			stream = NULL;
+		}
+	}
+	DetectionCleaner * dcleaner = NULL;
+	if( stream != NULL ){
+		dcleaner = new DetectionCleaner(stream, m_dcw->getSizeFixedNeighborhood(), m_dcw->getPixelSize(), m_dcw->getBackgroundValue(), m_dcw->getInt2PhotonRatio(), m_dcw->getMaxDarkTime(), m_dcw->getOptions());
+		delete stream;
+	}
+	else
+		dcleaner = new DetectionCleaner(dset, m_dcw->getSizeFixedNeighborhood(), m_dcw->getPixelSize(), m_dcw->getBackgroundValue(), m_dcw->getInt2PhotonRatio(), m_dcw->getMaxDarkTime(), m_dcw->getOptions(), m_superResObj->getDir());
 	m_superResObj->setDetectionCleaner( dcleaner );
 	m_dcw->setDetectionCleaner( this->getDetectionCleaner() );
 	m_voroWidget->setEnableFordsetCleaner( true );
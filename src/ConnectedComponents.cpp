@@ -0,0 +1,154 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      ConnectedComponents.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <cstddef>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "ConnectedComponents.hpp"
+
+ConnectedComponents::ConnectedComponents():m_parents( NULL ), m_labels( NULL ), m_firstMember( NULL ), m_members( NULL ), m_nbNodes( 0 ), m_nbComponents( 0 )
+{
+}
+
+ConnectedComponents::~ConnectedComponents()
+{
+	clear();
+}
+
+void ConnectedComponents::clear()
+{
+	if( m_parents != NULL )
+		delete [] m_parents;
+	if( m_labels != NULL )
+		delete [] m_labels;
+	if( m_firstMember != NULL )
+		delete [] m_firstMember;
+	if( m_members != NULL )
+		delete [] m_members;
+	m_parents = m_labels = m_firstMember = m_members = NULL;
+	m_nbNodes = m_nbComponents = 0;
+}
+
+//Root of the node with path halving, the root of a set is always its smallest node
+int ConnectedComponents::find( const int _idx )
+{
+	int current = _idx;
+	while( m_parents[current] != current ){
+		m_parents[current] = m_parents[m_parents[current]];
+		current = m_parents[current];
+	}
+	return current;
+}
+
+void ConnectedComponents::unite( const int _idx1, const int _idx2 )
+{
+	int root1 = find( _idx1 ), root2 = find( _idx2 );
+	if( root1 < root2 )
+		m_parents[root2] = root1;
+	else if( root2 < root1 )
+		m_parents[root1] = root2;
+}
+
+//Parallel union-find: the nodes are split in one contiguous range per thread, each thread unites the edges inside its
+//range without synchronization since the roots of these sets stay in the range. The edges across ranges are then
+//united serially, and the labels are read from the final roots in parallel
+void ConnectedComponents::build( const int * _neighbors, const int _degree, const bool * _selected, const int _nb )
+{
+	clear();
+	m_nbNodes = _nb;
+	m_parents = new int[m_nbNodes];
+	m_labels = new int[m_nbNodes];
+#pragma omp parallel for
+	for( int n = 0; n < m_nbNodes; n++ )
+		m_parents[n] = n;
+
+	int nbRanges = 1;
+#ifdef _OPENMP
+	nbRanges = omp_get_max_threads();
+#endif
+	std::vector < std::vector < std::pair < int, int > > > crossEdges( nbRanges );
+#pragma omp parallel for schedule(static, 1)
+	for( int range = 0; range < nbRanges; range++ ){
+		int begin = ( int )( ( ( long long )m_nbNodes * range ) / nbRanges ), end = ( int )( ( ( long long )m_nbNodes * ( range + 1 ) ) / nbRanges );
+		for( int n = begin; n < end; n++ ){
+			if( !_selected[n] ) continue;
+			const int * neighbors = _neighbors + n * _degree;
+			for( int i = 0; i < _degree; i++ ){
+				int other = neighbors[i];
+				//Each edge is seen from both of its nodes, it is only kept from the largest one
+				if( other < 0 || other >= n || !_selected[other] ) continue;
+				if( other >= begin )
+					unite( n, other );
+				else
+					crossEdges[range].push_back( std::make_pair( n, other ) );
+			}
+		}
+	}
+	for( int range = 0; range < nbRanges; range++ )
+		for( unsigned int i = 0; i < crossEdges[range].size(); i++ )
+			unite( crossEdges[range][i].first, crossEdges[range][i].second );
+
+#pragma omp parallel for
+	for( int n = 0; n < m_nbNodes; n++ ){
+		int current = n;
+		while( m_parents[current] != current )
+			current = m_parents[current];
+		m_labels[n] = current;
+	}
+	//The roots are renumbered in increasing order, a root is the first node of its component
+	for( int n = 0; n < m_nbNodes; n++ )
+		if( _selected[n] && m_labels[n] == n )
+			m_parents[n] = m_nbComponents++;
+#pragma omp parallel for
+	for( int n = 0; n < m_nbNodes; n++ )
+		m_labels[n] = ( _selected[n] ) ? m_parents[m_labels[n]] : -1;
+
+	m_firstMember = new int[m_nbComponents + 1];
+	for( int n = 0; n <= m_nbComponents; n++ )
+		m_firstMember[n] = 0;
+	for( int n = 0; n < m_nbNodes; n++ )
+		if( m_labels[n] >= 0 )
+			m_firstMember[m_labels[n] + 1]++;
+	for( int n = 0; n < m_nbComponents; n++ )
+		m_firstMember[n + 1] += m_firstMember[n];
+	m_members = new int[m_firstMember[m_nbComponents]];
+	//m_parents is reused as the insertion position of each component
+	for( int n = 0; n < m_nbComponents; n++ )
+		m_parents[n] = m_firstMember[n];
+	for( int n = 0; n < m_nbNodes; n++ )
+		if( m_labels[n] >= 0 )
+			m_members[m_parents[m_labels[n]]++] = n;
+	delete [] m_parents;
+	m_parents = NULL;
+}
@@ -0,0 +1,63 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      ConnectedComponents.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef ConnectedComponents_h__
+#define ConnectedComponents_h__
+
+//Connected components of the selected nodes of a graph with a fixed degree, such as the faces of the triangulation
+//with their three neighbors (-1 for no neighbor). The components are numbered in the order of their smallest node and
+//their members are stored in compressed sparse row form, sorted by node index
+class ConnectedComponents{
+public:
+	ConnectedComponents();
+	~ConnectedComponents();
+
+	void build( const int *, const int, const bool *, const int );
+	void clear();
+
+	inline int nbNodes() const { return m_nbNodes; }
+	inline int nbComponents() const { return m_nbComponents; }
+	inline int getLabel( const int _idx ) const { return m_labels[_idx]; }
+	inline const int * getLabels() const { return m_labels; }
+	inline int nbMembers( const int _idx ) const { return m_firstMember[_idx + 1] - m_firstMember[_idx]; }
+	inline const int * members( const int _idx ) const { return m_members + m_firstMember[_idx]; }
+
+protected:
+	int find( const int );
+	void unite( const int, const int );
+
+protected:
+	int * m_parents, * m_labels, * m_firstMember, * m_members;
+	int m_nbNodes, m_nbComponents;
+};
+
+#endif // ConnectedComponents_h__
@@ -64,23 +64,19 @@ DBScan::DBScan(DetectionSet * _dset) :m_eps(0.), m_minPts(0.), m_nbMinCluster(0.
 	m_sizeClusters = m_majorAxisClusters = m_minorAxisClusters = m_nbLocsClusters = NULL;
 	m_centroids = NULL;
 
-	DetectionPoint * origPoints = _dset->getPoints();
+	m_columns = NULL;
+	m_xs = m_ys = NULL;
+
+	const LocReal * xs = _dset->getXs(), * ys = _dset->getYs();
 	m_nbOriginalPoints = _dset->nbPoints();
 	m_unclassifiedId = m_nbOriginalPoints;
 	m_noiseId = m_nbOriginalPoints + 1;
 
-	m_cloud = new KdPointCloud_D();
-	m_cloud->m_pts.resize(_dset->nbPoints());
-	for (unsigned int n2 = 0; n2 < _dset->nbPoints(); n2++){
-		m_cloud->m_pts[n2].m_x = origPoints[n2].x();
-		m_cloud->m_pts[n2].m_y = origPoints[n2].y();
-	}
-	m_tree = new KdTree_2D_double(2, *m_cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */));
-	m_tree->buildIndex();
+	m_tree = _dset->getSpatialIndex();
 
 	m_points.clear();
 	for (unsigned int n = 0; n < m_nbOriginalPoints; n++)
-		m_points.push_back(DBScanPoint(origPoints[n].x(), origPoints[n].y(), n, m_unclassifiedId));
+		m_points.push_back(DBScanPoint(xs[n], ys[n], n, m_unclassifiedId));
 }
 
 DBScan::DBScan(DetectionSet * _dset, const double _eps, const unsigned int _minPts, const unsigned int _nbMinCluster) :DBScan(_dset)
@@ -98,30 +94,37 @@ DBScan::DBScan(DetectionSet * _dset1, DetectionSet * _dset2)
 	m_unclassifiedId = m_nbOriginalPoints;
 	m_noiseId = m_nbOriginalPoints + 1;
 
-	m_cloud = new KdPointCloud_D();
-	m_cloud->m_pts.resize(m_nbOriginalPoints);
+	m_xs = new LocReal[m_nbOriginalPoints];
+	m_ys = new LocReal[m_nbOriginalPoints];
 	for (unsigned int i = 0; i < 2; i++){
-		DetectionPoint * origPoints = (i == 0) ? _dset1->getPoints() : _dset2->getPoints();
-		unsigned int nbPoints = (i == 0) ? _dset1->nbPoints() : _dset2->nbPoints();
-		for (unsigned int n2 = 0; n2 < nbPoints; n2++, cpt++){
-			m_cloud->m_pts[cpt].m_x = origPoints[n2].x();
-			m_cloud->m_pts[cpt].m_y = origPoints[n2].y();
-		}
+		DetectionSet * dset = (i == 0) ? _dset1 : _dset2;
+		unsigned int nbPoints = dset->nbPoints();
+		memcpy(m_xs + cpt, dset->getXs(), nbPoints * sizeof(LocReal));
+		memcpy(m_ys + cpt, dset->getYs(), nbPoints * sizeof(LocReal));
+		cpt += nbPoints;
 	}
-	m_tree = new KdTree_2D_double(2, *m_cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */));
+	m_columns = new KdColumns_L(m_xs, m_ys, m_nbOriginalPoints);
+	m_tree = new KdTree_2D_columns(2, *m_columns, nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */));
 	m_tree->buildIndex();
 
 	m_points.clear();
 	for (unsigned int n = 0; n < m_nbOriginalPoints; n++)
-		m_points.push_back(DBScanPoint(m_cloud->m_pts[n].m_x, m_cloud->m_pts[n].m_y, n, m_unclassifiedId));
+		m_points.push_back(DBScanPoint(m_xs[n], m_ys[n], n, m_unclassifiedId));
 
 	std::cout << "Time for construction of colocalized DBScan " << timer.getTimeElapsed().toAscii().data() << std::endl;
 }
 
 DBScan::~DBScan()
 {
-	delete m_cloud;
-	delete m_tree;
+	//Only the colocalization owns its index
+	if (m_columns != NULL){
+		delete m_tree;
+		delete m_columns;
+	}
+	if (m_xs != NULL)
+		delete[] m_xs;
+	if (m_ys != NULL)
+		delete[] m_ys;
 	if (m_sizeClusters != NULL)
 		delete[] m_sizeClusters;
 	if (m_majorAxisClusters != NULL)
@@ -281,11 +284,11 @@ const bool DBScan::expandCluster( DBPoints & _points, DBScanPoint * _p, const un
 
 const DBRegion DBScan::getRegion( DBPoints & _points, DBScanPoint * _p, const double _epsSq )
 {
-	const double search_radius = static_cast<double>(_epsSq);
-	std::vector<std::pair<std::size_t, double> > ret_matches;
+	const LocReal search_radius = static_cast<LocReal>(_epsSq);
+	std::vector<std::pair<std::size_t, LocReal> > ret_matches;
 	nanoflann::SearchParams params;
 	std::size_t nMatches;
-	const double queryPt[2] = { _p->m_x, _p->m_y };
+	const LocReal queryPt[2] = { (LocReal)_p->m_x, (LocReal)_p->m_y };
 	nMatches = m_tree->radiusSearch(&queryPt[0], search_radius, ret_matches, params);
 	//distances[largestSet + i] = Geometry::distance(m_clouds[otherId]->m_pts[ret_index[0]].m_x, m_clouds[otherId]->m_pts[ret_index[0]].m_y, m_clouds[otherId]->m_pts[allSeeds[i]].m_x, m_clouds[otherId]->m_pts[allSeeds[i]].m_y);
 
@@ -317,7 +320,7 @@ Vec2md * DBScan::generateVertices() const
 {
 	Vec2md * vertices = new Vec2md[m_nbOriginalPoints];
 	for (unsigned int n = 0; n < m_nbOriginalPoints; n++)
-		vertices[n].set(m_cloud->m_pts[n].m_x, m_cloud->m_pts[n].m_y);
+		vertices[n].set(m_points[n].m_x, m_points[n].m_y);
 	return vertices;
 }
 
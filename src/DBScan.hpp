@@ -100,8 +100,10 @@ protected:
 	unsigned int m_minPts, m_unclassifiedId, m_noiseId, m_nbOriginalPoints, m_nbMinCluster;
 	bool m_applyPCA;
 
-	KdPointCloud_D * m_cloud;
-	KdTree_2D_double * m_tree;
+	//The index is borrowed from the detection set, except for the colocalization where it is built on the merged columns
+	KdTree_2D_columns * m_tree;
+	KdColumns_L * m_columns;
+	LocReal * m_xs, * m_ys;
 
 	double * m_sizeClusters, * m_majorAxisClusters, * m_minorAxisClusters, * m_nbLocsClusters;
 	unsigned int m_realNbClusters;
@@ -0,0 +1,199 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      DensitySweep.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <iostream>
+
+#include "DensitySweep.hpp"
+
+DensitySweep::DensitySweep( const int * _faceMolecules, const int * _neighborFaces, const float * _areaFaces, const LocReal * _densities, const bool * _validFaces, const int _nbFaces, const int _nbMolecules ):m_faceMolecules( _faceMolecules ), m_neighborFaces( _neighborFaces ), m_areaFaces( _areaFaces ), m_densities( _densities ), m_validFaces( _validFaces ), m_nbFaces( _nbFaces ), m_nbMolecules( _nbMolecules )
+{
+	m_parents = new int[m_nbFaces];
+	m_nbFacesObject = new int[m_nbFaces];
+	m_nbMoleculesObject = new int[m_nbFaces];
+	m_areaObject = new double[m_nbFaces];
+	m_added = new bool[m_nbFaces];
+	memset( m_added, 0, m_nbFaces * sizeof( bool ) );
+	m_junctions.resize( m_nbFaces );
+
+	m_firstRepresentative = new int[m_nbMolecules + 1];
+	m_nbRepresentatives = new int[m_nbMolecules];
+	memset( m_firstRepresentative, 0, ( m_nbMolecules + 1 ) * sizeof( int ) );
+	memset( m_nbRepresentatives, 0, m_nbMolecules * sizeof( int ) );
+	for( int n = 0; n < 3 * m_nbFaces; n++ )
+		m_firstRepresentative[m_faceMolecules[n] + 1]++;
+	for( int n = 0; n < m_nbMolecules; n++ )
+		m_firstRepresentative[n + 1] += m_firstRepresentative[n];
+	m_representatives = new int[m_firstRepresentative[m_nbMolecules]];
+}
+
+DensitySweep::~DensitySweep()
+{
+	delete [] m_parents;
+	delete [] m_nbFacesObject;
+	delete [] m_nbMoleculesObject;
+	delete [] m_areaObject;
+	delete [] m_added;
+	delete [] m_firstRepresentative;
+	delete [] m_nbRepresentatives;
+	delete [] m_representatives;
+}
+
+int DensitySweep::find( const int _idx )
+{
+	int current = _idx;
+	while( m_parents[current] != current ){
+		m_parents[current] = m_parents[m_parents[current]];
+		current = m_parents[current];
+	}
+	return current;
+}
+
+//Keeps a single representative of the molecule in the object of the root, returns the number of the removed ones
+int DensitySweep::removeDuplicates( const int _molecule, const int _root )
+{
+	int * representatives = m_representatives + m_firstRepresentative[_molecule];
+	int nb = 0;
+	bool found = false;
+	for( int i = 0; i < m_nbRepresentatives[_molecule]; i++ ){
+		if( find( representatives[i] ) == _root ){
+			if( found ) continue;
+			found = true;
+		}
+		representatives[nb++] = representatives[i];
+	}
+	int nbRemoved = m_nbRepresentatives[_molecule] - nb;
+	m_nbRepresentatives[_molecule] = nb;
+	return nbRemoved;
+}
+
+//Union by number of faces, the junctions of the smallest list are the only molecules that can be counted twice
+void DensitySweep::unite( const int _idx1, const int _idx2 )
+{
+	int root1 = find( _idx1 ), root2 = find( _idx2 );
+	if( root1 == root2 ) return;
+	if( m_nbFacesObject[root1] < m_nbFacesObject[root2] )
+		std::swap( root1, root2 );
+	m_parents[root2] = root1;
+	m_nbFacesObject[root1] += m_nbFacesObject[root2];
+	m_nbMoleculesObject[root1] += m_nbMoleculesObject[root2];
+	m_areaObject[root1] += m_areaObject[root2];
+	if( m_junctions[root1].size() < m_junctions[root2].size() )
+		m_junctions[root1].swap( m_junctions[root2] );
+	std::vector < int > & junctions = m_junctions[root2];
+	for( unsigned int i = 0; i < junctions.size(); i++ ){
+		int molecule = junctions[i];
+		m_nbMoleculesObject[root1] -= removeDuplicates( molecule, root1 );
+		if( m_nbRepresentatives[molecule] > 1 )
+			m_junctions[root1].push_back( molecule );
+	}
+	std::vector < int >().swap( junctions );
+}
+
+void DensitySweep::addFace( const int _face )
+{
+	m_added[_face] = true;
+	m_parents[_face] = _face;
+	m_nbFacesObject[_face] = 1;
+	m_nbMoleculesObject[_face] = 0;
+	m_areaObject[_face] = m_areaFaces[_face];
+	m_roots.push_back( _face );
+	for( int j = 0; j < 3; j++ ){
+		int neigh = m_neighborFaces[3 * _face + j];
+		if( neigh >= 0 && m_added[neigh] )
+			unite( _face, neigh );
+	}
+	int root = find( _face );
+	for( int j = 0; j < 3; j++ ){
+		int molecule = m_faceMolecules[3 * _face + j];
+		int * representatives = m_representatives + m_firstRepresentative[molecule];
+		int nb = m_nbRepresentatives[molecule];
+		bool counted = false;
+		for( int i = 0; i < nb && !counted; i++ )
+			counted = find( representatives[i] ) == root;
+		if( counted ) continue;
+		representatives[nb] = _face;
+		m_nbRepresentatives[molecule]++;
+		m_nbMoleculesObject[root]++;
+		if( nb == 0 ) continue;
+		m_junctions[root].push_back( molecule );
+		if( nb == 1 )
+			m_junctions[find( representatives[0] )].push_back( molecule );
+	}
+}
+
+bool sortFacesByDensity( const std::pair < LocReal, int > & _f1, const std::pair < LocReal, int > & _f2 ){
+	return _f1.first > _f2.first;
+}
+
+bool sortThresholds( const DensitySweep::Threshold & _t1, const DensitySweep::Threshold & _t2 ){
+	return _t1.m_threshold > _t2.m_threshold;
+}
+
+//The thresholds are given by their factor and density and are sorted by decreasing density on return. The objects are
+//the ones whose area and number of localizations are in the same bounds as in WrapperVoronoiDiagram::createVoronoiObjects
+void DensitySweep::sweep( std::vector < Threshold > & _thresholds, const double _minArea, const unsigned int _minLocs, const double _maxArea, const unsigned int _maxLocs )
+{
+	std::vector < std::pair < LocReal, int > > faces;
+	faces.reserve( m_nbFaces );
+	for( int n = 0; n < m_nbFaces; n++ )
+		if( m_validFaces[n] )
+			faces.push_back( std::make_pair( m_densities[n], n ) );
+	std::sort( faces.begin(), faces.end(), sortFacesByDensity );
+	std::stable_sort( _thresholds.begin(), _thresholds.end(), sortThresholds );
+
+	unsigned int current = 0;
+	for( unsigned int t = 0; t < _thresholds.size(); t++ ){
+		Threshold & threshold = _thresholds[t];
+		//Same selection as WrapperVoronoiDiagram::applyDensityFactorROIs, density strictly above the threshold
+		for( ; current < faces.size() && faces[current].first > threshold.m_threshold; current++ )
+			addFace( faces[current].second );
+		unsigned int nbRoots = 0;
+		threshold.m_nbObjects = threshold.m_nbLocalizations = 0;
+		threshold.m_area = 0.;
+		for( unsigned int i = 0; i < m_roots.size(); i++ ){
+			int root = m_roots[i];
+			if( m_parents[root] != root ) continue;
+			m_roots[nbRoots++] = root;
+			double area = m_areaObject[root];
+			unsigned int nbMol = m_nbMoleculesObject[root];
+			if( area > _minArea && nbMol > _minLocs && area <= _maxArea && nbMol <= _maxLocs ){
+				threshold.m_nbObjects++;
+				threshold.m_nbLocalizations += nbMol;
+				threshold.m_area += area;
+			}
+		}
+		m_roots.resize( nbRoots );
+		threshold.m_nbComponents = nbRoots;
+		threshold.m_meanArea = ( threshold.m_nbObjects > 0 ) ? threshold.m_area / ( double )threshold.m_nbObjects : 0.;
+		threshold.m_meanLocalizations = ( threshold.m_nbObjects > 0 ) ? ( double )threshold.m_nbLocalizations / ( double )threshold.m_nbObjects : 0.;
+		std::cout << "Density factor " << threshold.m_factor << ": " << threshold.m_nbObjects << " objects, " << threshold.m_nbLocalizations << " localizations" << std::endl;
+	}
+}
@@ -0,0 +1,84 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      DensitySweep.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef DensitySweep_h__
+#define DensitySweep_h__
+
+#include <vector>
+
+#include "Precision.hpp"
+
+//Objects of the Voronoi segmentation for a list of density thresholds in a single pass. A face is part of an object
+//when the densities of its three molecules are above the threshold, so the faces are sorted by their minimal density
+//and added from the densest one, merging the objects with a union-find as the threshold decreases (a merge tree).
+//The localizations of an object are its distinct molecules: a molecule shared by several objects is tracked by one
+//representative face per object, and the duplicates are removed when two of these objects merge
+class DensitySweep{
+public:
+	struct Threshold{
+		double m_factor, m_threshold, m_area, m_meanArea, m_meanLocalizations;
+		unsigned int m_nbObjects, m_nbLocalizations, m_nbComponents;
+	};
+
+	DensitySweep( const int *, const int *, const float *, const LocReal *, const bool *, const int, const int );
+	~DensitySweep();
+
+	void sweep( std::vector < Threshold > &, const double, const unsigned int, const double, const unsigned int );
+
+protected:
+	int find( const int );
+	void unite( const int, const int );
+	void addFace( const int );
+	int removeDuplicates( const int, const int );
+
+protected:
+	//Per face: its three molecules, its three neighbors (-1 for none), its area, the minimal density of its molecules
+	//and if it can be selected at all
+	const int * m_faceMolecules, * m_neighborFaces;
+	const float * m_areaFaces;
+	const LocReal * m_densities;
+	const bool * m_validFaces;
+	int m_nbFaces, m_nbMolecules;
+
+	//Union-find over the faces, the aggregates are only valid for the roots
+	int * m_parents, * m_nbFacesObject, * m_nbMoleculesObject;
+	double * m_areaObject;
+	bool * m_added;
+	std::vector < int > m_roots;
+	//Molecules with representatives in several objects, listed by each of these objects
+	std::vector < std::vector < int > > m_junctions;
+
+	//Representative faces of each molecule, at most one per object, in CSR form with one slot per incident face
+	int * m_firstRepresentative, * m_nbRepresentatives, * m_representatives;
+};
+
+#endif // DensitySweep_h__
@@ -41,6 +41,7 @@
 
 #include "DetectionCleaner.hpp"
 #include "DetectionSet.hpp"
+#include "DetectionSetStream.hpp"
 #include "lmcurve.h"
 #include "GeneralTools.hpp"
 
@@ -70,62 +71,117 @@ void quicksort( CleanerPoint ** _array, double * _ts, const int _start, const in
 	quicksort( _array, _ts, right + 1, _end );
 }
 
-CleanerPoint::CleanerPoint():m_t( 0 ), m_done(false)
+CleanerPoint::CleanerPoint():m_point( 0., 0. ), m_t( 0 ), m_done(false)
 {
-	m_point = NULL;
 }
 
-CleanerPoint::CleanerPoint(DetectionPoint * _dp, const double _t, const double _intensity, const double _sigma) : m_t(_t), m_intensity(_intensity), m_sigma(_sigma), m_done(false)
+CleanerPoint::CleanerPoint(const double _x, const double _y, const double _t, const double _intensity, const double _sigma) : m_point(_x, _y), m_t(_t), m_intensity(_intensity), m_sigma(_sigma), m_done(false)
 {
-	m_point = _dp;
 }
 
 CleanerPoint::~CleanerPoint()
 {
 }
 
-void CleanerPoint::set(DetectionPoint * _dp, const double _t, const double _intensity, const double _sigma)
+void CleanerPoint::set(const double _x, const double _y, const double _t, const double _intensity, const double _sigma)
 {
-	m_point = _dp;
+	m_point.set(_x, _y);
 	m_t = _t;
 	m_intensity = _intensity;
 	m_sigma = _sigma;
 }
 
+CleanerWindow::CleanerWindow( DetectionSetStream * _stream ):m_stream( _stream ), m_firstFrame( 0 )
+{
+}
+
+//Localizations of the frame _t, the blocks are loaded up to this frame if needed
+std::vector < CleanerPoint > & CleanerWindow::frame( const int _t )
+{
+	while( _t >= m_firstFrame + ( int )m_frames.size() && loadNextBlock() );
+	if( _t < m_firstFrame || _t >= m_firstFrame + ( int )m_frames.size() ){
+		m_empty.clear();
+		return m_empty;
+	}
+	return m_frames[_t - m_firstFrame];
+}
+
+void CleanerWindow::releaseBefore( const int _t )
+{
+	while( m_firstFrame < _t && !m_frames.empty() ){
+		m_frames.pop_front();
+		m_firstFrame++;
+	}
+}
+
+void CleanerWindow::reset()
+{
+	m_frames.clear();
+	m_firstFrame = 0;
+	m_stream->reset();
+}
+
+bool CleanerWindow::loadNextBlock()
+{
+	if( m_firstFrame + ( int )m_frames.size() >= m_stream->nbSlices() )
+		return false;
+	FrameBlock block;
+	bool loaded = m_stream->nextBlock( block );
+	if( block.m_nbFrames == 0 )
+		return false;
+	if( !loaded )
+		std::cout << "Impossible to read the frames " << block.m_firstFrame << " to " << block.m_firstFrame + block.m_nbFrames - 1 << ", they are considered empty" << std::endl;
+	bool hasSigma = m_stream->hasSigmaPerLocalization();
+	for( int t = block.m_firstFrame; t < block.m_firstFrame + block.m_nbFrames; t++ ){
+		m_frames.push_back( std::vector < CleanerPoint >() );
+		if( !loaded ) continue;
+		std::vector < CleanerPoint > & points = m_frames.back();
+		unsigned int first = block.getFirstPoint( t ), nb = block.getSizePoints( t );
+		points.reserve( nb );
+		for( unsigned int n = first; n < first + nb; n++ )
+			points.push_back( CleanerPoint( block.m_xs[n], block.m_ys[n], t, block.m_intensities[n], hasSigma ? block.m_sigmas[n] : 0. ) );
+	}
+	return true;
+}
+
 DetectionCleaner::DetectionCleaner(DetectionSet * _dset, const double _sizeNeigh, const double _pixelValue, const double _background, const double _ratioInt2Photon, const int _maxDarkTime, const unsigned char _options, const std::string & _dir) :m_sizeNeigh(_sizeNeigh), m_pixelValue(_pixelValue), m_background(_background), m_ratioInt2Photon(_ratioInt2Photon), m_maxDarkTime(_maxDarkTime), m_options(_options)
+{
+	DetectionSetStream stream( _dset, NB_FRAMES_PER_BLOCK );
+	clean( stream );
+}
+
+DetectionCleaner::DetectionCleaner(DetectionSetStream * _stream, const double _sizeNeigh, const double _pixelValue, const double _background, const double _ratioInt2Photon, const int _maxDarkTime, const unsigned char _options) :m_sizeNeigh(_sizeNeigh), m_pixelValue(_pixelValue), m_background(_background), m_ratioInt2Photon(_ratioInt2Photon), m_maxDarkTime(_maxDarkTime), m_options(_options)
+{
+	clean( *_stream );
+}
+
+DetectionCleaner::~DetectionCleaner()
+{
+
+}
+
+void DetectionCleaner::clean( DetectionSetStream & _stream )
 {
 	m_totalRemoved = m_totalAdded = m_totalDetections = 0.;
 
-	int nbTime = _dset->nbSlices();
-	m_hasSigma = _dset->hasSigmaPerLocalization();
+	int nbTime = _stream.nbSlices();
+	m_hasSigma = _stream.hasSigmaPerLocalization();
 
 	QTime time, test;
 	time.start();
 	std::cout << "Beginning cleaning of the detection set" << std::endl;
 
-	//Creation of the cleanerPoints in a single dimension array, needs to have the nb points per time and starting points in the array then
-	CleanerPoint * cpoints = new CleanerPoint[_dset->getNbPoints()];
-	DetectionPoint * originalPoints = _dset->getPoints();
-	uint * firstPointTime = _dset->getFirstPoint(), * nbPointsTime = _dset->getSizePoints();
-	double * intensities = _dset->getIntensities();
-	CleanerPoint * ptrC = cpoints;
-	for( int t = 0; t < nbTime; t++ )
-		for( int n = 0; n < nbPointsTime[t]; n++ ){
-			int index = firstPointTime[t] + n;
-			( *ptrC++ ).set( &originalPoints[index], t, intensities[index], m_hasSigma ? _dset->getSigma(index) : 0. );
-		}
-
-	CleanerPoint ** unchangedCPoints = new CleanerPoint*[_dset->getNbPoints()];
-	Vec4md * newCPoints = new Vec4md[_dset->getNbPoints()];
-	int currentUnchanged = 0, currentNew = 0;
+	//The cleanerPoints are created frame block by frame block while the passes move forward in time
+	CleanerWindow window( &_stream );
+	std::vector < CleanerPoint > unchangedCPoints;
+	std::vector < Vec4md > newCPoints;
 
-	int targetNbMolecules = 0, maxDarkTime = 20;
-	determineMaxDarkTimePaper( cpoints, _dset->getNbPoints(), firstPointTime, nbPointsTime, nbTime );
-	for( int n = 0; n < _dset->getNbPoints(); n++ )
-		cpoints[n].m_done = false;
-	cleanDetectionSet( cpoints, _dset->getNbPoints(), firstPointTime, nbPointsTime, nbTime, unchangedCPoints, currentUnchanged, newCPoints, currentNew, m_maxDarkTime );
+	determineMaxDarkTimePaper( window, nbTime );
+	cleanDetectionSet( window, nbTime, unchangedCPoints, newCPoints, m_maxDarkTime );
+	window.reset();
 
 	//For voronoiDiagram
+	int currentUnchanged = unchangedCPoints.size(), currentNew = newCPoints.size();
 	m_nbTotalClean = currentUnchanged + currentNew;
 	m_xs = new double[m_nbTotalClean];
 	m_ys = new double[m_nbTotalClean];
@@ -135,10 +191,10 @@ DetectionCleaner::DetectionCleaner(DetectionSet * _dset, const double _sizeNeigh
 	unsigned short * ptrT = m_ts;
 	unsigned int * ptrPhotons = m_nbPhotons;
 	for( int i = 0; i < currentUnchanged; i++ ){
-		*ptrX = unchangedCPoints[i]->m_point->x();
-		*ptrY = unchangedCPoints[i]->m_point->y();
-		*ptrT = ( unsigned short )unchangedCPoints[i]->m_t;
-		*ptrPhotons = ( unsigned int )unchangedCPoints[i]->getIntensity();
+		*ptrX = unchangedCPoints[i].m_point.x();
+		*ptrY = unchangedCPoints[i].m_point.y();
+		*ptrT = ( unsigned short )unchangedCPoints[i].m_t;
+		*ptrPhotons = ( unsigned int )unchangedCPoints[i].getIntensity();
 		ptrX++;
 		ptrY++;
 		ptrT++;
@@ -155,10 +211,6 @@ DetectionCleaner::DetectionCleaner(DetectionSet * _dset, const double _sizeNeigh
 		ptrPhotons++;
 	}
 
-	delete [] unchangedCPoints;
-	delete [] newCPoints;
-	delete [] cpoints;
-
 	double blinkFit = m_eqnBlinks->getParams()[0];
 	double tonFit = m_eqnTOns->getParams()[1];
 	double kd = blinkFit * tonFit;
@@ -170,7 +222,7 @@ DetectionCleaner::DetectionCleaner(DetectionSet * _dset, const double _sizeNeigh
 	QString tau( 0x03C4 );
 	m_statsCleaner += "k_d / ( k_d + k_b ) = " + QString::number(blinkFit) + "\nk_d + k_b = " + QString::number(tonFit) + "\nk_d = " + QString::number(kd) + "\nk_b = " + QString::number(kb) + "\nN_blinks = 1 + (k_d / k_b) = " + QString::number(nblink) + "\n# detections for " + tau + "_" + QString::number(m_maxDarkTime) + " = " + QString::number(m_nbTotalClean) + "\n\nControl by blinks (#emission burst / N_blinks):\n# emission burst = " + QString::number(m_nbEmBurst) + "\n# detections for control by blinks = " + QString::number(m_nbEmBurst) + " / " + QString::number(nblink) + " = " + QString::number(controlNbMol) + "\n\nNormalized difference: (" + QString::number(m_nbTotalClean) + " - " + QString::number(controlNbMol) + " ) / " + QString::number(m_nbTotalClean) + " = " + QString::number(err) + "%";
 
-	m_totalDetections = _dset->getNbPoints();
+	m_totalDetections = _stream.nbPoints();
 	m_totalRemoved = m_totalDetections - currentUnchanged;
 	m_totalAdded = currentNew;
 
@@ -182,19 +234,15 @@ DetectionCleaner::DetectionCleaner(DetectionSet * _dset, const double _sizeNeigh
 	m_toggleDisplay = true;
 }
 
-DetectionCleaner::~DetectionCleaner()
-{
-
-}
-
-void DetectionCleaner::determineMaxDarkTimePaper( CleanerPoint * _cpoints, const int _nbTotalData, unsigned int * _firstPointTime, unsigned int * _nbPointsTime, const int _nbTime )
+void DetectionCleaner::determineMaxDarkTimePaper( CleanerWindow & _window, const int _nbTime )
 {
-	m_nbEmBurst = computeNbEmissionBurst( _cpoints, _nbTotalData, _firstPointTime, _nbPointsTime, _nbTime );
-	int darkTimeByStats = computeAnalysisParameters( _cpoints, _nbTotalData, _firstPointTime, _nbPointsTime, _nbTime, m_maxDarkTime );
+	m_nbEmBurst = computeNbEmissionBurst( _window, _nbTime );
+	int darkTimeByStats = computeAnalysisParameters( _window, _nbTime, m_maxDarkTime );
 	m_maxDarkTime = (m_options & DetectionCleaner::FixedMaxDarkTimeFlag) ? m_maxDarkTime : darkTimeByStats;
 }
 
-void DetectionCleaner::cleanDetectionSet( CleanerPoint * _cpoints, const int _nbTotalData, unsigned int * _firstPointTime, unsigned int * _nbPointsTime, const int _nbTime, CleanerPoint ** _unchangedCPoints, int & _currentUnchanged, Vec4md * _newCPoints, int & _currentNew, const int _darkTime )
+//Each pass reads the stream from its first frame, the points are created again and none of them is done
+void DetectionCleaner::cleanDetectionSet( CleanerWindow & _window, const int _nbTime, std::vector < CleanerPoint > & _unchangedCPoints, std::vector < Vec4md > & _newCPoints, const int _darkTime )
 {
 	//Definition of the distance function pointer
 	DetectionCleaner::DistanceFunction dfunction;
@@ -202,56 +250,57 @@ void DetectionCleaner::cleanDetectionSet( CleanerPoint * _cpoints, const int _nb
 	if( m_options & DetectionCleaner::PhotonDistanceFlag ) dfunction = &DetectionCleaner::photonDistance;
 	if( m_options & DetectionCleaner::PhotonBackgroundDistanceFlag ) dfunction = &DetectionCleaner::photonBackgroundDistance;
 
-	CleanerPoint ** tmpCPoints = new CleanerPoint *[_nbTotalData];
-	int size = 0;
+	std::vector < CleanerPoint * > tmpCPoints;
+	_window.reset();
 	for( int t = 0; t < _nbTime; t++ ){
-		for( int n = _firstPointTime[t]; n < _firstPointTime[t] + _nbPointsTime[t]; n++ ){
-			if( !_cpoints[n].m_done ){
-				_cpoints[n].m_done = true;
-				Vec2md barycenter(_cpoints[n].getPoint()->x(), _cpoints[n].getPoint()->y());
-				size = 0;
-				tmpCPoints[size++] = &_cpoints[n];
-				int currentNeigh = 0, currentBlinks = 0, timeN = t + 1, nbDetections = 0;
-				double x = _cpoints[n].getPoint()->x(), y = _cpoints[n].getPoint()->y(), totalIntensity = 0.;
+		_window.releaseBefore( t );
+		std::vector < CleanerPoint > & cpoints = _window.frame( t );
+		for( unsigned int n = 0; n < cpoints.size(); n++ ){
+			CleanerPoint & cpoint = cpoints[n];
+			if( !cpoint.m_done ){
+				cpoint.m_done = true;
+				Vec2md barycenter(cpoint.getPoint()->x(), cpoint.getPoint()->y());
+				tmpCPoints.clear();
+				tmpCPoints.push_back( &cpoint );
+				int currentBlinks = 0, timeN = t + 1, nbDetections = 0;
+				double totalIntensity = 0.;
 				while( currentBlinks <= _darkTime && timeN < _nbTime ){
-					bool neighFound = false;
-					int index;
-					double d = pow((this->*dfunction)(_cpoints[n].getIntensity(), m_hasSigma ? _cpoints[n].getSigma() : 0.), 2);
-					for( int n2 = _firstPointTime[timeN]; n2 < _firstPointTime[timeN] + _nbPointsTime[timeN]; n2++ ){
-						if( !_cpoints[n2].m_done ){
-							double x2 = _cpoints[n2].getPoint()->x() - barycenter.x(), y2 = _cpoints[n2].getPoint()->y() - barycenter.y();
+					std::vector < CleanerPoint > & cpointsN = _window.frame( timeN );
+					CleanerPoint * neigh = NULL;
+					double d = pow((this->*dfunction)(cpoint.getIntensity(), m_hasSigma ? cpoint.getSigma() : 0.), 2);
+					for( unsigned int n2 = 0; n2 < cpointsN.size(); n2++ ){
+						if( !cpointsN[n2].m_done ){
+							double x2 = cpointsN[n2].getPoint()->x() - barycenter.x(), y2 = cpointsN[n2].getPoint()->y() - barycenter.y();
 							double length = x2 * x2 + y2 * y2;
 							if( length < d ){
-								neighFound = true;
-								index = n2;
+								neigh = &cpointsN[n2];
 								d = length;
 							}
 						}
 					}
-					if( neighFound ){
+					if( neigh != NULL ){
 						nbDetections++;
-						totalIntensity += _cpoints[index].getIntensity();
-						_cpoints[index].m_done = true;
+						totalIntensity += neigh->getIntensity();
+						neigh->m_done = true;
 						currentBlinks = 0;
-						tmpCPoints[size++] = &_cpoints[index];
-						averagingPosition(barycenter, tmpCPoints, size);
+						tmpCPoints.push_back( neigh );
+						averagingPosition(barycenter, &tmpCPoints[0], tmpCPoints.size());
 					}
 					else
 						currentBlinks++;
 					timeN++;
 				}
 				if( nbDetections == 0 )
-					_unchangedCPoints[_currentUnchanged++] = &_cpoints[n];
+					_unchangedCPoints.push_back( cpoint );
 				else
-					_newCPoints[_currentNew++].set( barycenter.x(), barycenter.y(), _cpoints[n].getT(), totalIntensity );
-				size = 0;
+					_newCPoints.push_back( Vec4md( barycenter.x(), barycenter.y(), cpoint.getT(), totalIntensity ) );
 			}
 		}
 	}
 }
 
 
-int DetectionCleaner::computeNbEmissionBurst( CleanerPoint * _cpoints, const int _nbTotalData, unsigned int * _firstPointTime, unsigned int * _nbPointsTime, const int _nbTime )
+int DetectionCleaner::computeNbEmissionBurst( CleanerWindow & _window, const int _nbTime )
 {
 	//Definition of the distance function pointer
 	DetectionCleaner::DistanceFunction dfunction;
@@ -260,37 +309,38 @@ int DetectionCleaner::computeNbEmissionBurst( CleanerPoint * _cpoints, const int
 	if( m_options & DetectionCleaner::PhotonBackgroundDistanceFlag ) dfunction = &DetectionCleaner::photonBackgroundDistance;
 
 	/****Computation of the number of emission burst (done with a dark time of 0) ********/
-	CleanerPoint ** tmpCPoints = new CleanerPoint *[_nbTotalData];
-	int size = 0, nbEmBurst = 0, maxDarkTime = 1;
-	for( int n = 0; n < _nbTotalData; n++ )
-		_cpoints[n].m_done = false;
+	std::vector < CleanerPoint * > tmpCPoints;
+	int nbEmBurst = 0, maxDarkTime = 1;
+	_window.reset();
 	for( int t = 0; t < _nbTime; t++ ){
-		for( int n = _firstPointTime[t]; n < _firstPointTime[t] + _nbPointsTime[t]; n++ ){
-			if( !_cpoints[n].m_done ){
-				_cpoints[n].m_done = true;
-				size = 0;
-				tmpCPoints[size++] = &_cpoints[n];
-				int currentNeigh = 0, currentDarkTime = 0, timeN = t + 1;
-				Vec2md barycenter(_cpoints[n].getPoint()->x(), _cpoints[n].getPoint()->y());
+		_window.releaseBefore( t );
+		std::vector < CleanerPoint > & cpoints = _window.frame( t );
+		for( unsigned int n = 0; n < cpoints.size(); n++ ){
+			CleanerPoint & cpoint = cpoints[n];
+			if( !cpoint.m_done ){
+				cpoint.m_done = true;
+				tmpCPoints.clear();
+				tmpCPoints.push_back( &cpoint );
+				int currentDarkTime = 0, timeN = t + 1;
+				Vec2md barycenter(cpoint.getPoint()->x(), cpoint.getPoint()->y());
 				while (currentDarkTime < maxDarkTime && timeN < _nbTime){
-					bool neighFound = false;
-					int index;			
-					double d = pow((this->*dfunction)(_cpoints[n].getIntensity(), m_hasSigma ? _cpoints[n].getSigma() : 0.), 2);
-					for( int n2 = _firstPointTime[timeN]; n2 < _firstPointTime[timeN] + _nbPointsTime[timeN]; n2++ ){
-						if( !_cpoints[n2].m_done ){
-							double x2 = _cpoints[n2].getPoint()->x() - barycenter.x(), y2 = _cpoints[n2].getPoint()->y() - barycenter.y();
+					std::vector < CleanerPoint > & cpointsN = _window.frame( timeN );
+					CleanerPoint * neigh = NULL;
+					double d = pow((this->*dfunction)(cpoint.getIntensity(), m_hasSigma ? cpoint.getSigma() : 0.), 2);
+					for( unsigned int n2 = 0; n2 < cpointsN.size(); n2++ ){
+						if( !cpointsN[n2].m_done ){
+							double x2 = cpointsN[n2].getPoint()->x() - barycenter.x(), y2 = cpointsN[n2].getPoint()->y() - barycenter.y();
 							double length = x2 * x2 + y2 * y2;
 							if( length < d ){
-								neighFound = true;
-								index = n2;
+								neigh = &cpointsN[n2];
 								d = length;
 							}
 						}
 					}
-					if( neighFound ){
-						tmpCPoints[size++] = &_cpoints[index];
-						averagingPosition(barycenter, tmpCPoints, size);
-						_cpoints[index].m_done = true;
+					if( neigh != NULL ){
+						tmpCPoints.push_back( neigh );
+						averagingPosition(barycenter, &tmpCPoints[0], tmpCPoints.size());
+						neigh->m_done = true;
 						currentDarkTime = 0;
 					}
 					else
@@ -304,7 +354,7 @@ int DetectionCleaner::computeNbEmissionBurst( CleanerPoint * _cpoints, const int
 	return nbEmBurst;
 }
 
-int DetectionCleaner::computeAnalysisParameters( CleanerPoint * _cpoints, const int _nbTotalData, unsigned int * _firstPointTime, unsigned int * _nbPointsTime, const int _nbTime, const int _maxDarkTime )
+int DetectionCleaner::computeAnalysisParameters( CleanerWindow & _window, const int _nbTime, const int _maxDarkTime )
 {
 	//Definition of the distance function pointer
 	DetectionCleaner::DistanceFunction dfunction;
@@ -320,44 +370,45 @@ int DetectionCleaner::computeAnalysisParameters( CleanerPoint * _cpoints, const
 	double * tons = new double[_nbTime];
 	memset( tons, 0, _nbTime * sizeof( double ) );
 
-	CleanerPoint ** tmpCPoints = new CleanerPoint *[_nbTotalData];
-	int size = 0;
+	std::vector < CleanerPoint * > tmpCPoints;
 	int totalDetec = 0;
-	for( int n = 0; n < _nbTotalData; n++ )
-		_cpoints[n].m_done = false;
+	_window.reset();
 	for( int t = 0; t < _nbTime; t++ ){
-		for( int n = _firstPointTime[t]; n < _firstPointTime[t] + _nbPointsTime[t]; n++ ){
-			if( !_cpoints[n].m_done ){
-				_cpoints[n].m_done = true;
-				tmpCPoints[size++] = &_cpoints[n];
-				int currentNeigh = 0, currentDarkTime = 0, timeN = t + 1, nbDetections = 1, nbBlinks = 0, nbOn = 1, tBleach = 1;
-				double x = _cpoints[n].getPoint()->x(), y = _cpoints[n].getPoint()->y();
+		_window.releaseBefore( t );
+		std::vector < CleanerPoint > & cpoints = _window.frame( t );
+		for( unsigned int n = 0; n < cpoints.size(); n++ ){
+			CleanerPoint & cpoint = cpoints[n];
+			if( !cpoint.m_done ){
+				cpoint.m_done = true;
+				tmpCPoints.clear();
+				tmpCPoints.push_back( &cpoint );
+				int currentDarkTime = 0, timeN = t + 1, nbDetections = 1, nbBlinks = 0, nbOn = 1, tBleach = 1;
+				double x = cpoint.getPoint()->x(), y = cpoint.getPoint()->y();
 				while( currentDarkTime < _maxDarkTime && timeN < _nbTime ){
-					bool neighFound = false;
-					int index;
-					double d = pow((this->*dfunction)(_cpoints[n].getIntensity(), m_hasSigma ? _cpoints[n].getSigma() : 0.), 2);
-					for( int n2 = _firstPointTime[timeN]; n2 < _firstPointTime[timeN] + _nbPointsTime[timeN]; n2++ ){
-						if( !_cpoints[n2].m_done ){
-							double x2 = _cpoints[n2].getPoint()->x() - x, y2 = _cpoints[n2].getPoint()->y() - y;
+					std::vector < CleanerPoint > & cpointsN = _window.frame( timeN );
+					CleanerPoint * neigh = NULL;
+					double d = pow((this->*dfunction)(cpoint.getIntensity(), m_hasSigma ? cpoint.getSigma() : 0.), 2);
+					for( unsigned int n2 = 0; n2 < cpointsN.size(); n2++ ){
+						if( !cpointsN[n2].m_done ){
+							double x2 = cpointsN[n2].getPoint()->x() - x, y2 = cpointsN[n2].getPoint()->y() - y;
 							double length = x2 * x2 + y2 * y2;
 							if( length < d ){
-								neighFound = true;
-								index = n2;
+								neigh = &cpointsN[n2];
 								d = length;
 							}
 						}
 					}
-					if( neighFound ){
+					if( neigh != NULL ){
 						nbDetections++;
 						nbOn++;
-						tmpCPoints[size++] = &_cpoints[index];
+						tmpCPoints.push_back( neigh );
 						x = y = 0.;
-						double dsize = size;
-						for( int i = 0; i < size; i++ ){
+						double dsize = tmpCPoints.size();
+						for( unsigned int i = 0; i < tmpCPoints.size(); i++ ){
 							x += ( tmpCPoints[i]->getPoint()->x() / dsize );
 							y += ( tmpCPoints[i]->getPoint()->y() / dsize );
 						}
-						_cpoints[index].m_done = true;
+						neigh->m_done = true;
 						if( currentDarkTime != 0 ){
 							nbBlinks++;
 							toffs[currentDarkTime]++;
@@ -377,7 +428,6 @@ int DetectionCleaner::computeAnalysisParameters( CleanerPoint * _cpoints, const
 				}
 				totalDetec += nbDetections;
 				blinks[nbBlinks]++;
-				size = 0;
 			}
 		}
 	}
@@ -35,6 +35,8 @@
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Polygon_2.h>
 #include <list>
+#include <vector>
+#include <deque>
 #include <QString>
 
 #include "GeneralTools.hpp"
@@ -47,22 +49,23 @@ typedef K::Point_2 Point_2;
 typedef CGAL::Polygon_2<K> Polygon_2;
 
 class DetectionSet;
+class DetectionSetStream;
 
 class CleanerPoint{
 public:
 	CleanerPoint();
-	CleanerPoint(DetectionPoint *, const double, const double, const double);
+	CleanerPoint(const double, const double, const double, const double, const double);
 	~CleanerPoint();
 
-	void set(DetectionPoint *, const double, const double, const double);
+	void set(const double, const double, const double, const double, const double);
 
-	inline DetectionPoint * getPoint() const {return m_point;}
+	inline const Vec2md * getPoint() const {return &m_point;}
 	inline double getT() const {return m_t;}
 	inline double getIntensity() const{return m_intensity;}
 	inline double getSigma() const{ return m_sigma; }
 
 protected:
-	DetectionPoint * m_point;
+	Vec2md m_point;
 	double m_t, m_intensity, m_sigma;
 	bool m_done;
 
@@ -70,11 +73,35 @@ protected:
 	friend void quicksort( CleanerPoint **, double *, const int, const int );
 };
 
+//Frames of a stream loaded block by block as the tracking moves forward in time, the frames before the first one
+//still reachable are released so that only the frames spanned by the tracks in progress are resident
+class CleanerWindow{
+public:
+	CleanerWindow( DetectionSetStream * );
+
+	std::vector < CleanerPoint > & frame( const int );
+	void releaseBefore( const int );
+	void reset();
+
+protected:
+	bool loadNextBlock();
+
+protected:
+	DetectionSetStream * m_stream;
+	std::deque < std::vector < CleanerPoint > > m_frames;
+	int m_firstFrame;
+	std::vector < CleanerPoint > m_empty;
+};
+
 class DetectionCleaner{
 public:
 	enum CleanerOptionFlags{ FixedDistanceFlag = 0x01, PhotonDistanceFlag = 0x02, PhotonBackgroundDistanceFlag = 0x04, FixedMaxDarkTimeFlag = 0x08 };
 
+	//Number of frames read at a time from the stream of localizations
+	static const int NB_FRAMES_PER_BLOCK = 256;
+
 	DetectionCleaner(DetectionSet *, const double, const double, const double, const double, const int, const unsigned char, const std::string &);
+	DetectionCleaner(DetectionSetStream *, const double, const double, const double, const double, const int, const unsigned char);
 	~DetectionCleaner();
 
 	//void draw() const;
@@ -96,11 +123,12 @@ public:
 	double photonBackgroundDistance(double, double);
 
 protected:
-	void determineMaxDarkTimePaper( CleanerPoint *, const int, unsigned int *, unsigned int *, const int );
-	void cleanDetectionSet( CleanerPoint *, const int, unsigned int *, unsigned int *, const int, CleanerPoint **, int &, Vec4md *, int &, const int );
+	void clean( DetectionSetStream & );
+	void determineMaxDarkTimePaper( CleanerWindow &, const int );
+	void cleanDetectionSet( CleanerWindow &, const int, std::vector < CleanerPoint > &, std::vector < Vec4md > &, const int );
 
-	int computeNbEmissionBurst( CleanerPoint *, const int, unsigned int *, unsigned int *, const int );
-	int computeAnalysisParameters( CleanerPoint *, const int, unsigned int *, unsigned int *, const int, const int );
+	int computeNbEmissionBurst( CleanerWindow &, const int );
+	int computeAnalysisParameters( CleanerWindow &, const int, const int );
 
 	void averagingPosition(Vec2md &, CleanerPoint **, const int);
 
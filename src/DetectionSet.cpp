@@ -40,6 +40,8 @@
 #include <cmath>
 
 #include "DetectionSet.hpp"
+#include "LocalizationFileParser.hpp"
+#include "GeneralTools.hpp"
 #include "ImageViewer.hpp"
 
 std::vector < std::string > & split(const std::string & s, char delim, std::vector < std::string > & elems){
@@ -54,9 +56,22 @@ std::vector < std::string > & split(const std::string & s, char delim, std::vect
 	return elems;
 }
 
+char determineSeparator(const std::string & s){
+	if (s.find('\t') != std::string::npos)
+		return '\t';
+	if (s.find(',') != std::string::npos)
+		return ',';
+	if (s.find(' ') != std::string::npos)
+		return ' ';
+	return 0;
+}
+
 DetectionSet::DetectionSet():ObjectInterface(),m_w(0), m_h(0)
 {
-	m_points = m_displayPoints = NULL;
+	m_xs = m_ys = m_zs = NULL;
+	m_displayPoints = NULL;
+	m_kdColumns = NULL;
+	m_kdTree = NULL;
 	m_firstsPoint = m_sizePoints = NULL;
 	m_intensities = m_sigmas = NULL;
 	m_colors = NULL;
@@ -64,20 +79,31 @@ DetectionSet::DetectionSet():ObjectInterface(),m_w(0), m_h(0)
 
 DetectionSet::DetectionSet( const DetectionSet & o ):ObjectInterface( o ), m_dir(o.m_dir), m_name(o.m_name), intensityMin(o.intensityMin), intensityMax(o.intensityMax), m_nbPoints( o.m_nbPoints ), m_nbSlices( o.m_nbSlices ), m_w(o.m_w), m_h(o.m_h)
 {
-	m_points = m_displayPoints = NULL;
+	m_xs = m_ys = m_zs = NULL;
+	m_displayPoints = NULL;
+	m_kdColumns = NULL;
+	m_kdTree = NULL;
 	m_firstsPoint = m_sizePoints = NULL;
 	m_intensities = m_sigmas = NULL;
 	m_colors = NULL;
 
 	m_firstsPoint = new unsigned int[m_nbSlices];
 	m_sizePoints = new unsigned int[m_nbSlices];
-	m_points = new DetectionPoint[m_nbPoints];
-	memcpy( m_points, o.m_points, m_nbPoints * sizeof( DetectionPoint ) );
-	m_intensities = new double[m_nbPoints];
-	memcpy(m_intensities, o.m_intensities, m_nbPoints * sizeof(double));
+	memcpy( m_firstsPoint, o.m_firstsPoint, m_nbSlices * sizeof( unsigned int ) );
+	memcpy( m_sizePoints, o.m_sizePoints, m_nbSlices * sizeof( unsigned int ) );
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
+	memcpy( m_xs, o.m_xs, m_nbPoints * sizeof( LocReal ) );
+	memcpy( m_ys, o.m_ys, m_nbPoints * sizeof( LocReal ) );
+	if( o.m_zs != NULL ){
+		m_zs = new LocReal[m_nbPoints];
+		memcpy( m_zs, o.m_zs, m_nbPoints * sizeof( LocReal ) );
+	}
+	m_intensities = new LocReal[m_nbPoints];
+	memcpy(m_intensities, o.m_intensities, m_nbPoints * sizeof(LocReal));
 	if (o.m_sigmas != NULL){
-		m_sigmas = new double[m_nbPoints];
-		memcpy(m_sigmas, o.m_sigmas, m_nbPoints * sizeof(double));
+		m_sigmas = new LocReal[m_nbPoints];
+		memcpy(m_sigmas, o.m_sigmas, m_nbPoints * sizeof(LocReal));
 	}
 	else
 		m_sigmas = NULL;
@@ -87,7 +113,10 @@ DetectionSet::DetectionSet( const DetectionSet & o ):ObjectInterface( o ), m_dir
 
 DetectionSet::DetectionSet( const std::vector < DetectionSet * > & vect ):ObjectInterface()
 {
-	m_points = m_displayPoints = NULL;
+	m_xs = m_ys = m_zs = NULL;
+	m_displayPoints = NULL;
+	m_kdColumns = NULL;
+	m_kdTree = NULL;
 	m_firstsPoint = m_sizePoints = NULL;
 	m_intensities = m_sigmas = NULL;
 	m_colors = NULL;
@@ -95,7 +124,7 @@ DetectionSet::DetectionSet( const std::vector < DetectionSet * > & vect ):Object
 	m_nbPoints = 0;
 	m_nbSlices = 0;
 	m_w = m_h = 0.f;
-	bool hasSignmas = true;
+	bool hasSignmas = true, hasZs = true;
 	for( std::vector < DetectionSet * >::const_iterator it2 = vect.begin(); it2 != vect.end(); it2++ ){
 		DetectionSet * o = *it2;
 		m_nbPoints += o->m_nbPoints;
@@ -105,32 +134,41 @@ DetectionSet::DetectionSet( const std::vector < DetectionSet * > & vect ):Object
 		if( o->m_h > m_h )
 			m_h = o->m_h;
 		hasSignmas = hasSignmas & o->m_sigmas != NULL;
+		hasZs = hasZs && o->m_zs != NULL;
 	}
 	m_firstsPoint = new unsigned int[m_nbSlices];
 	m_sizePoints = new unsigned int[m_nbSlices];
-	m_points = new DetectionPoint[m_nbPoints];
-	m_intensities = new double[m_nbPoints];
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
+	m_zs = ( hasZs ) ? new LocReal[m_nbPoints] : NULL;
+	m_intensities = new LocReal[m_nbPoints];
 	if (hasSignmas)
-		m_sigmas = new double[m_nbPoints];
+		m_sigmas = new LocReal[m_nbPoints];
 	else
 		m_sigmas = NULL;
 
 	unsigned int * ptrFirst = m_firstsPoint, * ptrSize = m_sizePoints;
-	DetectionPoint * ptrP = m_points;
-	double * ptrI = m_intensities, * ptrS = m_sigmas;
+	LocReal * ptrX = m_xs, * ptrY = m_ys, * ptrZ = m_zs;
+	LocReal * ptrI = m_intensities, * ptrS = m_sigmas;
 	int addingForStart = 0;
 	for( std::vector < DetectionSet * >::const_iterator it2 = vect.begin(); it2 != vect.end(); it2++ ){
 		DetectionSet * o = *it2;
 		for( int n = 0; n < o->m_nbSlices; n++ )
 			( *ptrFirst++ ) = addingForStart + o->m_firstsPoint[n];
 		memcpy( ptrSize, o->m_sizePoints, o->m_nbSlices * sizeof( unsigned int ) );
-		memcpy( ptrP, o->m_points, o->m_nbPoints * sizeof( DetectionPoint ) );
-		memcpy( ptrI, o->m_intensities, o->m_nbPoints * sizeof( double ) );
+		memcpy( ptrX, o->m_xs, o->m_nbPoints * sizeof( LocReal ) );
+		memcpy( ptrY, o->m_ys, o->m_nbPoints * sizeof( LocReal ) );
+		memcpy( ptrI, o->m_intensities, o->m_nbPoints * sizeof( LocReal ) );
 		ptrSize += o->m_nbSlices;
-		ptrP += o->m_nbPoints;
+		ptrX += o->m_nbPoints;
+		ptrY += o->m_nbPoints;
 		ptrI += o->m_nbPoints;
+		if( hasZs ){
+			memcpy( ptrZ, o->m_zs, o->m_nbPoints * sizeof( LocReal ) );
+			ptrZ += o->m_nbPoints;
+		}
 		if (hasSignmas){
-			memcpy(ptrS, o->m_sigmas, o->m_nbPoints * sizeof(double));
+			memcpy(ptrS, o->m_sigmas, o->m_nbPoints * sizeof(LocReal));
 			ptrS += o->m_nbPoints;
 		}
 		addingForStart += o->m_firstsPoint[o->m_nbSlices - 1] + o->m_sizePoints[o->m_nbSlices - 1];
@@ -145,13 +183,16 @@ DetectionSet::DetectionSet( const std::vector < DetectionSet * > & vect ):Object
 	computeHistograms();
 	m_palette = Palette::getStaticLut( "InvFire" );
 	m_colors = new Color4D[m_nbPoints];
-	m_selection = new bool[m_nbPoints];
+	m_selection.resize( m_nbPoints );
 	forceRegenerateSelection();
 }
 
 DetectionSet::DetectionSet(const std::vector< double > & _xs, const std::vector< double > & _ys, const std::vector< unsigned short > & _ts, const std::vector< unsigned int > & _photons, const int _nbSlices, const int _nbPoints):ObjectInterface()
 {
-	m_points = m_displayPoints = NULL;
+	m_xs = m_ys = m_zs = NULL;
+	m_displayPoints = NULL;
+	m_kdColumns = NULL;
+	m_kdTree = NULL;
 	m_firstsPoint = m_sizePoints = NULL;
 	m_intensities = m_sigmas = NULL;
 	m_colors = NULL;
@@ -163,8 +204,9 @@ DetectionSet::DetectionSet(const std::vector< double > & _xs, const std::vector<
 
 	m_firstsPoint = new unsigned int[m_nbSlices];
 	m_sizePoints = new unsigned int[m_nbSlices];
-	m_points = new DetectionPoint[m_nbPoints];
-	m_intensities = new double[m_nbPoints];
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
+	m_intensities = new LocReal[m_nbPoints];
 	m_sigmas = NULL;
 
 	memset(m_firstsPoint, 0, m_nbSlices * sizeof(unsigned int));
@@ -184,7 +226,8 @@ DetectionSet::DetectionSet(const std::vector< double > & _xs, const std::vector<
 	m_w = m_h = 0;
 	for (int n = 0; n < m_nbPoints; n++){
 		unsigned int currentT = _ts[n];
-		m_points[m_firstsPoint[currentT] + tmpCount[currentT]].set(_xs[n], _ys[n], 0.);
+		m_xs[m_firstsPoint[currentT] + tmpCount[currentT]] = _xs[n];
+		m_ys[m_firstsPoint[currentT] + tmpCount[currentT]] = _ys[n];
 		tmpCount[currentT]++;
 		m_intensities[n] = _photons[n];
 		if (m_intensities[n] < intensityMin)
@@ -205,14 +248,17 @@ DetectionSet::DetectionSet(const std::vector< double > & _xs, const std::vector<
 	computeHistograms();
 	m_palette = Palette::getStaticLut("AllGreen");
 	m_colors = new Color4D[m_nbPoints];
-	m_selection = new bool[m_nbPoints];
+	m_selection.resize( m_nbPoints );
 	forceRegenerateSelection();
 }
 
 
 DetectionSet::DetectionSet( double * _xs, double * _ys, unsigned short * _ts, unsigned int * _photons, const int _nbSlices, const int _nbPoints ):ObjectInterface()
 {
-	m_points = m_displayPoints = NULL;
+	m_xs = m_ys = m_zs = NULL;
+	m_displayPoints = NULL;
+	m_kdColumns = NULL;
+	m_kdTree = NULL;
 	m_firstsPoint = m_sizePoints = NULL;
 	m_intensities = m_sigmas = NULL;
 	m_colors = NULL;
@@ -224,8 +270,9 @@ DetectionSet::DetectionSet( double * _xs, double * _ys, unsigned short * _ts, un
 
 	m_firstsPoint = new unsigned int[m_nbSlices];
 	m_sizePoints = new unsigned int[m_nbSlices];
-	m_points = new DetectionPoint[m_nbPoints];
-	m_intensities = new double[m_nbPoints];
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
+	m_intensities = new LocReal[m_nbPoints];
 	m_sigmas = NULL;
 
 	memset( m_firstsPoint, 0, m_nbSlices * sizeof( unsigned int ) );
@@ -245,7 +292,8 @@ DetectionSet::DetectionSet( double * _xs, double * _ys, unsigned short * _ts, un
 	m_w = m_h = 0;
 	for( int n = 0; n < m_nbPoints; n++ ){
 		unsigned int currentT = _ts[n];
-		m_points[m_firstsPoint[currentT] + tmpCount[currentT]].set( _xs[n], _ys[n], 0. );
+		m_xs[m_firstsPoint[currentT] + tmpCount[currentT]] = _xs[n];
+		m_ys[m_firstsPoint[currentT] + tmpCount[currentT]] = _ys[n];
 		tmpCount[currentT]++;
 		m_intensities[n] = _photons[n];
 		if( m_intensities[n] < intensityMin )
@@ -266,28 +314,60 @@ DetectionSet::DetectionSet( double * _xs, double * _ys, unsigned short * _ts, un
 	computeHistograms();
 	m_palette = Palette::getStaticLut( "AllGreen" );
 	m_colors = new Color4D[m_nbPoints];
-	m_selection = new bool[m_nbPoints];
+	m_selection.resize( m_nbPoints );
+	forceRegenerateSelection();
+}
+
+DetectionSet::DetectionSet(std::vector < LocalizationChunk > & _chunks, const int _nbSlices, const bool _hasSigma):ObjectInterface(), m_w(0), m_h(0)
+{
+	m_xs = m_ys = m_zs = NULL;
+	m_displayPoints = NULL;
+	m_kdColumns = NULL;
+	m_kdTree = NULL;
+	m_firstsPoint = m_sizePoints = NULL;
+	m_intensities = m_sigmas = NULL;
+	m_colors = NULL;
+
+	intensityMin = FLT_MAX;
+	intensityMax = FLT_MIN;
+	setLocalizations(_chunks, _nbSlices, _hasSigma);
+
+	m_stats = new ArrayStatistics[1];
+	m_stats[0] = GeneralTools::generateArrayStatistics(m_intensities, m_nbPoints);
+
+	m_nbHisto = 1;
+	m_histograms = new Histogram *[m_nbHisto];
+	m_histograms[0] = NULL;
+	computeHistograms();
+	m_palette = Palette::getStaticLut("AllGreen");
+	m_colors = new Color4D[m_nbPoints];
+	m_selection.resize( m_nbPoints );
 	forceRegenerateSelection();
 }
 
 DetectionSet::~DetectionSet()
 {
-	if( m_points != NULL )
-		delete [] m_points;
+	if( m_xs != NULL )
+		delete [] m_xs;
+	if( m_ys != NULL )
+		delete [] m_ys;
+	if( m_zs != NULL )
+		delete [] m_zs;
 	if( m_firstsPoint != NULL )
 		delete [] m_firstsPoint;
 	if( m_sizePoints != NULL )
 		delete [] m_sizePoints;
 	if( m_colors != NULL )
 		delete [] m_colors;
-	if( m_selection != NULL )
-		delete [] m_selection;
 	if( m_intensities != NULL )
 		delete [] m_intensities;
+	if( m_sigmas != NULL )
+		delete [] m_sigmas;
 	if( m_stats != NULL )
 		delete [] m_stats;
 	if( m_displayPoints != NULL )
 		delete [] m_displayPoints;
+	invalidateSpatialIndex();
 }
 /*
 void DetectionSet::createTesselerFile(const char * filename)
@@ -641,11 +721,6 @@ int DetectionSet::nbSlices() const
 	return m_nbSlices;
 }
 
-DetectionPoint * DetectionSet::getPoints()
-{
-	return m_points;
-}
-
 unsigned int * DetectionSet::getFirstPoint()
 {
 	return m_firstsPoint;
@@ -660,14 +735,9 @@ int DetectionSet::size() const
 	return m_nbPoints;
 }
 
-DetectionPoint & DetectionSet::operator[]( int _idx )
-{
-	return m_points[_idx];
-}
-
-const DetectionPoint & DetectionSet::operator[]( int _idx ) const
+DetectionPoint DetectionSet::operator[]( int _idx ) const
 {
-	return m_points[_idx];
+	return DetectionPoint( m_xs[_idx], m_ys[_idx], getZ( _idx ) );
 }
 
 bool DetectionSet::isDataSelected( const int )
@@ -723,27 +793,31 @@ double * DetectionSet::getHistogram( const int _typeHistogram, const bool _isLog
 	}
 	return NULL;
 }
+//Intensity of each localization as read by BitMask::selectInRange, in log scale when the histogram is
+class IntensityValues{
+public:
+	IntensityValues( const LocReal * _intensities, const bool _log ):m_intensities( _intensities ), m_log( _log ){}
+
+	inline double operator()( const size_t _idx ) const { return ( m_log ) ? MiscFunction::log10Custom( m_intensities[_idx] ) : m_intensities[_idx]; }
+
+protected:
+	const LocReal * m_intensities;
+	bool m_log;
+};
+
 void DetectionSet::determineSelection( const bool resetSelectionByUser )
 {
 	m_nbSelection = 0;
 	if( resetSelectionByUser )
 		for( int i = 0; i < m_nbHisto; i++ )
 			m_histograms[i]->eraseBounds();
-	uint current = 0;
-	resetDataSelection();
-	for(unsigned int i = 0; i < m_nbPoints; i++)
-	{
-			double inten = ( m_histograms[0]->isLog() ) ? MiscFunction::log10Custom( m_intensities[i] ) : m_intensities[i];
-			m_selection[i] = ( m_histograms[0]->getMin() <= inten && inten <= m_histograms[0]->getMax() );
-			if( m_selection[i] )
-				m_nbSelection++;
-	}
+	m_selection.selectInRange( IntensityValues( m_intensities, m_histograms[0]->isLog() ), m_histograms[0]->getMin(), m_histograms[0]->getMax() );
+	m_nbSelection = m_selection.count();
 }
 
 void DetectionSet::resetDataSelection()
 {
-	for(uint i = 0; i < m_nbPoints; i++)
-		m_selection[i] = false;
+	m_selection.clearAll();
 }
 
 void DetectionSet::forceRegenerateSelection()
@@ -760,7 +834,7 @@ void DetectionSet::draw() const
 	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnableClientState( GL_VERTEX_ARRAY );
 	glEnableClientState( GL_COLOR_ARRAY );
-	glVertexPointer( 3, GL_DOUBLE, 0, m_displayPoints );
+	glVertexPointer( 2, GL_FLOAT, 0, m_displayPoints );
 	glColorPointer( 4, GL_FLOAT, 0, m_colors );
 	glDrawArrays( GL_POINTS, 0, m_nbPoints );
 	glDisableClientState( GL_VERTEX_ARRAY );
@@ -771,9 +845,9 @@ void DetectionSet::draw() const
 
 void DetectionSet::createDisplayPoints( const double _w, const double _h )
 {
-	m_displayPoints = new DetectionPoint[m_nbPoints];
+	m_displayPoints = new Vec2mf[m_nbPoints];
 	for( int n = 0; n < m_nbPoints; n++ )
-		m_displayPoints[n].set( m_points[n].x() / _w, m_points[n].y() / _h, m_points[n].z() );
+		m_displayPoints[n].set( m_xs[n] / _w, m_ys[n] / _h );
 }
 
 bool DetectionSet::isCleanable() const
@@ -783,8 +857,17 @@ bool DetectionSet::isCleanable() const
 
 bool DetectionSet::createFile(const char * _filename)
 {
-	m_dir = std::string(_filename);
-	m_name = std::string(_filename);
+	MappedFile mapped(_filename);
+	return createFile(mapped);
+}
+
+//The format is determined on the first line of the mapping, the same mapping is then parsed
+bool DetectionSet::createFile(const MappedFile & _file)
+{
+	invalidateSpatialIndex();
+	const char * filename = _file.filename().c_str();
+	m_dir = _file.filename();
+	m_name = _file.filename();
 	int index = m_dir.find_last_of("/");
 	m_dir.erase(index, m_dir.size() - index);
 	m_dir.append("/");
@@ -794,41 +877,45 @@ bool DetectionSet::createFile(const char * _filename)
 	intensityMax = FLT_MIN;
 	m_nbPoints = 0;
 
-	std::vector < std::string > headers, values;
-	std::ifstream fs(_filename);
-
-	std::string s;
-	std::getline(fs, s);
-	char * separator = NULL;
-	std::size_t found = s.find('\t');
-	if (found != std::string::npos)
-		separator = new char('\t');
-	else{
-		found = s.find(',');
-		if (found != std::string::npos)
-			separator = new char(',');
-		else{
-			found = s.find(' ');
-			if (found != std::string::npos)
-				separator = new char(' ');
+	if (BinaryLocalizationHeader::isBinaryFile(_file.begin(), _file.end()))
+		createBinaryFile(_file);
+	else if (_file.isMapped()){
+		LocalizationTextLayout layout;
+		if (!describeTextFile(_file, layout))
+			return false;
+		MyTimer timer;
+		LocalizationFileParser::parseChunks(layout.m_chunks, layout.getParser());
+		if (layout.m_generateIntensitiesSigmas){
+			std::random_device rd;
+			std::mt19937 gen(rd());
+			for (unsigned int n = 0; n < layout.m_chunks.size(); n++)
+				layout.m_chunks[n].generateIntensitiesSigmas(gen);
 		}
+		setLocalizations(layout.m_chunks, layout.m_nbSlices, layout.hasSigma());
+		std::cout << "# of localizations:" << m_nbPoints << ", time for parsing file " << timer.getTimeElapsed().toAscii().data() << std::endl;
 	}
-	if (separator == NULL){
-		std::cout << "Impossible to open " << _filename << std::endl;
-		return false;
+	else{
+		//The file cannot be mapped, it is read as a stream
+		std::vector < std::string > headers;
+		std::ifstream fs(filename);
+		std::string s;
+		std::getline(fs, s);
+		char separator = determineSeparator(s);
+		if (separator == 0){
+			std::cout << "Impossible to open " << filename << std::endl;
+			return false;
+		}
+		headers = split(s, separator, headers);
+		if (headers.size() == 2)
+			createTesselerFile(fs, separator, headers);
+		else if (strncmp(s.c_str(), "Total", strlen("Total")) == 0)
+			createSebastienFile(fs, separator, headers);
+		else
+			createOtherFileFormat(fs, separator, headers);
 	}
-	headers = split(s, *separator, headers);
-	if (headers.size() == 2)
-		createTesselerFile(fs, *separator, headers);
-	else if (strncmp(s.c_str(), "Total", strlen("Total")) == 0)
-		createSebastienFile(fs, *separator, headers);
-	else
-		createOtherFileFormat(fs, *separator, headers);
 
-	if (m_nbPoints == 0){
-		delete separator;
+	if (m_nbPoints == 0)
 		return false;
-	}
 
 	m_stats = new ArrayStatistics[1];
 	m_stats[0] = GeneralTools::generateArrayStatistics(m_intensities, m_nbPoints);
@@ -841,10 +928,81 @@ bool DetectionSet::createFile(const char * _filename)
 	if (m_colors != NULL)
 		delete[] m_colors;
 	m_colors = new Color4D[m_nbPoints];
-	m_selection = new bool[m_nbPoints];
+	m_selection.resize( m_nbPoints );
 	regenerateIntensityColorVector();
+	return true;
+}
 
-	delete separator;
+void DetectionSet::createBinaryFile(const MappedFile & _file)
+{
+	m_nbPoints = 0;
+	BinaryLocalizationHeader header;
+	memcpy(&header, _file.begin(), sizeof(BinaryLocalizationHeader));
+	if (header.m_version != BinaryLocalizationHeader::VERSION){
+		std::cout << "Version " << header.m_version << " of the binary localization format is not supported" << std::endl;
+		return;
+	}
+	bool hasSigma = (header.m_flags & BinaryLocalizationHeader::HasSigma) != 0;
+	qint64 sizeExpected = BinaryLocalizationHeader::fileSize(header.m_nbPoints, header.m_nbSlices, hasSigma);
+	if (_file.size() < sizeExpected){
+		std::cout << "Binary localization file is truncated (" << _file.size() << " bytes instead of " << sizeExpected << ")" << std::endl;
+		return;
+	}
+
+	MyTimer timer;
+	m_nbPoints = header.m_nbPoints;
+	m_nbSlices = header.m_nbSlices;
+	m_w = header.m_w;
+	m_h = header.m_h;
+	intensityMin = header.m_intensityMin;
+	intensityMax = header.m_intensityMax;
+
+	const double * xs = (const double *)(_file.begin() + sizeof(BinaryLocalizationHeader));
+	const double * ys = xs + m_nbPoints, * intensities = ys + m_nbPoints;
+	const double * sigmas = hasSigma ? intensities + m_nbPoints : NULL;
+	const unsigned int * firsts = (const unsigned int *)(intensities + (hasSigma ? 2 : 1) * m_nbPoints);
+	const unsigned int * sizes = firsts + m_nbSlices;
+
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
+	copyColumn(m_xs, xs, m_nbPoints);
+	copyColumn(m_ys, ys, m_nbPoints);
+	m_intensities = new LocReal[m_nbPoints];
+	copyColumn(m_intensities, intensities, m_nbPoints);
+	if (hasSigma){
+		m_sigmas = new LocReal[m_nbPoints];
+		copyColumn(m_sigmas, sigmas, m_nbPoints);
+	}
+	m_firstsPoint = new unsigned int[m_nbSlices];
+	m_sizePoints = new unsigned int[m_nbSlices];
+	memcpy(m_firstsPoint, firsts, m_nbSlices * sizeof(unsigned int));
+	memcpy(m_sizePoints, sizes, m_nbSlices * sizeof(unsigned int));
+	std::cout << "# of localizations:" << m_nbPoints << ", time for loading binary file " << timer.getTimeElapsed().toAscii().data() << std::endl;
+}
+
+bool DetectionSet::saveBinaryFile(const char * _filename) const
+{
+	std::ofstream fs(_filename, std::ios::out | std::ios::binary);
+	if (!fs){
+		std::cout << "Impossible to write " << _filename << std::endl;
+		return false;
+	}
+	BinaryLocalizationHeader header(m_nbPoints, m_nbSlices, m_w, m_h, intensityMin, intensityMax, m_sigmas != NULL);
+	fs.write((const char *)&header, sizeof(BinaryLocalizationHeader));
+
+	//The columns are always stored in double precision on disk
+	writeColumn<double>(fs, m_xs, m_nbPoints);
+	writeColumn<double>(fs, m_ys, m_nbPoints);
+	writeColumn<double>(fs, m_intensities, m_nbPoints);
+	if (m_sigmas != NULL)
+		writeColumn<double>(fs, m_sigmas, m_nbPoints);
+	fs.write((const char *)m_firstsPoint, m_nbSlices * sizeof(unsigned int));
+	fs.write((const char *)m_sizePoints, m_nbSlices * sizeof(unsigned int));
+	bool worked = fs.good();
+	fs.close();
+	if (!worked)
+		std::cout << "Error while writing " << _filename << std::endl;
+	return worked;
 }
 
 void DetectionSet::createSebastienFile(std::ifstream & _fs, const char _separator, std::vector < std::string > & _headers)
@@ -853,23 +1011,16 @@ void DetectionSet::createSebastienFile(std::ifstream & _fs, const char _separato
 	intensityMax = FLT_MIN;
 	m_w = m_h = 0.;
 
-	std::vector < DetectionPoint > points;
-	std::vector < double > intensities, sigmas;
+	std::vector < double > xs, ys, intensities, sigmas;
 	std::vector < unsigned short > times;
 	int nbSlices = 0, nbPoints = 0;
 
 	MyTimer timer;
 
 	_fs.clear();
+	_fs.seekg(0, std::ios::end);
+	std::streamoff sizeFile = _fs.tellg();
 	_fs.seekg(0, std::ios::beg);
-	int nbLines = std::count(std::istreambuf_iterator<char>(_fs), std::istreambuf_iterator<char>(), '\n');
-	_fs.clear();
-	_fs.seekg(0, std::ios::beg);
-	unsigned int currentLine = 0, nbForUpdate = nbLines / 100.;
-	if (nbForUpdate == 0) nbForUpdate = 1;
-
-	std::cout << "# of lines:" << nbLines << ", time for computing number of lines " << timer.getTimeElapsed().toAscii().data() << std::endl;
-	printf("Reading file: %.2f %%", (double)currentLine / nbLines * 100.);
 
 	std::string s;
 	std::getline(_fs, s);
@@ -881,6 +1032,14 @@ void DetectionSet::createSebastienFile(std::ifstream & _fs, const char _separato
 	is >> nbPoints;
 	std::getline(_fs, s);
 
+	//Capacity is taken from the header, or estimated from the size of the file (a line has at least 16 characters), instead of counting the lines
+	std::size_t capacity = (nbPoints > 0) ? nbPoints : (std::size_t)(sizeFile / 16);
+	xs.reserve(capacity);
+	ys.reserve(capacity);
+	intensities.reserve(capacity);
+	sigmas.reserve(capacity);
+	times.reserve(capacity);
+
 	double x, y, intensity = 0., sigma = 0.;
 	int t;
 	//Sigmas and intensities are generated as a gaussian distribution of mean 25 and deviation 10
@@ -897,7 +1056,8 @@ void DetectionSet::createSebastienFile(std::ifstream & _fs, const char _separato
 		std::istringstream is2(s);
 		is2 >> t >> x >> y;
 		if (x <= 0. || y <= 0.) continue;
-		points.push_back(DetectionPoint(x, y, 0));
+		xs.push_back(x);
+		ys.push_back(y);
 		times.push_back((unsigned short)t);
 		double val = dintensity(gen);
 		while (val < 0.) val = dintensity(gen);
@@ -909,23 +1069,23 @@ void DetectionSet::createSebastienFile(std::ifstream & _fs, const char _separato
 			xmax = x;
 		if (y > ymax)
 			ymax = y;
-		//if (currentLine++ % nbForUpdate == 0) printf("\rReading file: %.2f %%", ((double)currentLine / nbLines * 100.));
 		if (x > m_w)
 			m_w = x;
 		if (y > m_h)
 			m_h = y;
 	}
-	printf("\n");
 
 	m_nbSlices = times.at(times.size() - 1);
-	m_nbPoints = points.size();
+	m_nbPoints = xs.size();
 	m_firstsPoint = new unsigned int[m_nbSlices];
 	m_sizePoints = new unsigned int[m_nbSlices];
-	m_intensities = new double[m_nbPoints];
-	m_sigmas = new double[m_nbPoints];
-	m_points = new DetectionPoint[m_nbPoints];
+	m_intensities = new LocReal[m_nbPoints];
+	m_sigmas = new LocReal[m_nbPoints];
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
 
-	std::copy(points.begin(), points.end(), m_points);
+	std::copy(xs.begin(), xs.end(), m_xs);
+	std::copy(ys.begin(), ys.end(), m_ys);
 	std::copy(intensities.begin(), intensities.end(), m_intensities);
 	std::copy(sigmas.begin(), sigmas.end(), m_sigmas);
 
@@ -958,10 +1118,11 @@ void DetectionSet::createTesselerFile(std::ifstream & _fs, const char _separator
 	m_nbPoints = atoi(_headers[1].c_str());
 	m_firstsPoint = new unsigned int[m_nbSlices];
 	m_sizePoints = new unsigned int[m_nbSlices];
-	m_intensities = new double[m_nbPoints];
+	m_intensities = new LocReal[m_nbPoints];
 	memset(m_firstsPoint, 0, m_nbSlices * sizeof(unsigned int));
 	memset(m_sizePoints, 0, m_nbSlices * sizeof(unsigned int));
-	m_points = new DetectionPoint[m_nbPoints];
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
 	std::vector < double > sigmas;
 	double x, y, intensity, sigma;
 	int t;
@@ -988,7 +1149,8 @@ void DetectionSet::createTesselerFile(std::ifstream & _fs, const char _separator
 			sigmas.push_back(::atof(values[4].c_str()));
 
 		//fs >> x >> y >> intensity >> t;
-		m_points[n].set(x, y, 0);
+		m_xs[n] = x;
+		m_ys[n] = y;
 		m_intensities[n] = intensity;
 		m_sizePoints[t]++;
 		if (x > m_w)
@@ -999,7 +1161,7 @@ void DetectionSet::createTesselerFile(std::ifstream & _fs, const char _separator
 	for (int n = 1; n < m_nbSlices; n++)
 		m_firstsPoint[n] = m_firstsPoint[n - 1] + m_sizePoints[n - 1];
 	if (!sigmas.empty()){
-		m_sigmas = new double[m_nbPoints];
+		m_sigmas = new LocReal[m_nbPoints];
 		for (int n = 0; n < m_nbPoints; n++)
 			m_sigmas[n] = sigmas[n];
 	}
@@ -1007,18 +1169,11 @@ void DetectionSet::createTesselerFile(std::ifstream & _fs, const char _separator
 	//m_h = ceil(m_h);
 }
 
-void DetectionSet::createOtherFileFormat(std::ifstream & _fs, const char _separator, std::vector < std::string > & _headers)
+bool DetectionSet::determineColumnIndexes(const std::vector < std::string > & _headers, int * _indexes)
 {
-	intensityMin = FLT_MAX;
-	intensityMax = FLT_MIN;
-	m_nbPoints = 0;
-
-	std::vector < std::string > values;
-	std::string s;
-
 	std::string xs1("x"), xs2("Position X"), ys1("y"), ys2("Position Y"), intensities1("intensity"), intensities2("Number Photons"), frames1("frame"), frames2("First Frame"), sigmas1("sigma"), sigmas2("Precision");
 
-	int indexXs, indexYs, indexFrames, indexIntensities, indexSigmas;
+	int & indexXs = _indexes[LocalizationFileParser::ColumnX], & indexYs = _indexes[LocalizationFileParser::ColumnY], & indexFrames = _indexes[LocalizationFileParser::ColumnFrame], & indexIntensities = _indexes[LocalizationFileParser::ColumnIntensity], & indexSigmas = _indexes[LocalizationFileParser::ColumnSigma];
 	indexXs = indexYs = indexFrames = indexIntensities = indexSigmas = -1;
 	for (unsigned int n = 0; n < _headers.size(); n++){
 		std::string current = _headers.at(n);
@@ -1041,12 +1196,28 @@ void DetectionSet::createOtherFileFormat(std::ifstream & _fs, const char _separa
 		if (indexFrames == -1) std::cout << "frame ";
 		if (indexIntensities == -1) std::cout << "intensity ";
 		std::cout << "parameter(s)" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void DetectionSet::createOtherFileFormat(std::ifstream & _fs, const char _separator, std::vector < std::string > & _headers)
+{
+	intensityMin = FLT_MAX;
+	intensityMax = FLT_MIN;
+	m_nbPoints = 0;
+
+	std::vector < std::string > values;
+	std::string s;
+
+	int indexes[LocalizationFileParser::NB_COLUMNS];
+	if (!determineColumnIndexes(_headers, indexes)){
 		_fs.close();
 		return;
 	}
+	int indexXs = indexes[LocalizationFileParser::ColumnX], indexYs = indexes[LocalizationFileParser::ColumnY], indexFrames = indexes[LocalizationFileParser::ColumnFrame], indexIntensities = indexes[LocalizationFileParser::ColumnIntensity], indexSigmas = indexes[LocalizationFileParser::ColumnSigma];
 
-	std::vector < DetectionPoint > points;
-	std::vector < double > intensities, sigmas;
+	std::vector < double > xs, ys, intensities, sigmas;
 	std::vector < unsigned int > times;
 	double x, y, ii;
 	int currentFrame;
@@ -1069,7 +1240,8 @@ void DetectionSet::createOtherFileFormat(std::ifstream & _fs, const char _separa
 				intensityMax = ii;
 			if (ii < intensityMin)
 				intensityMin = ii;
-			points.push_back(DetectionPoint(x, y, 0.));
+			xs.push_back(x);
+			ys.push_back(y);
 			intensities.push_back(ii);
 			times.push_back(currentFrame);
 			if (x > m_w)
@@ -1081,23 +1253,25 @@ void DetectionSet::createOtherFileFormat(std::ifstream & _fs, const char _separa
 		}
 	}
 
-	m_nbPoints = points.size();
+	m_nbPoints = xs.size();
 	m_nbSlices = times.back() + 1;
 
 	m_firstsPoint = new unsigned int[m_nbSlices];
 	m_sizePoints = new unsigned int[m_nbSlices];
-	m_intensities = new double[m_nbPoints];
+	m_intensities = new LocReal[m_nbPoints];
 	if (indexSigmas != -1)
-		m_sigmas = new double[m_nbPoints];
+		m_sigmas = new LocReal[m_nbPoints];
 	else
 		m_sigmas = NULL;
 	memset(m_firstsPoint, 0, m_nbSlices * sizeof(bool));
 	memset(m_sizePoints, 0, m_nbSlices * sizeof(unsigned int));
-	m_points = new DetectionPoint[m_nbPoints];
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
 
 
 	for (int n = 0; n < m_nbPoints; n++){
-		m_points[n].set(points[n].x(), points[n].y(), 0);
+		m_xs[n] = xs[n];
+		m_ys[n] = ys[n];
 		m_intensities[n] = intensities[n];
 		m_sizePoints[times[n]]++;
 		if (m_sigmas != NULL) m_sigmas[n] = sigmas[n];
@@ -1106,6 +1280,146 @@ void DetectionSet::createOtherFileFormat(std::ifstream & _fs, const char _separa
 		m_firstsPoint[n] = m_firstsPoint[n - 1] + m_sizePoints[n - 1];
 }
 
+//Lines are "t x y", localizations with a null coordinate are discarded
+class SebastienLineParser : public ColumnLineParser{
+public:
+	SebastienLineParser(const int * _indexes) :ColumnLineParser(' ', _indexes){}
+	bool parse(const char * _begin, const char * _end, double * _values) const
+	{
+		_values[LocalizationFileParser::ColumnIntensity] = 0.;
+		if (!ColumnLineParser::parse(_begin, _end, _values))
+			return false;
+		return _values[LocalizationFileParser::ColumnX] > 0. && _values[LocalizationFileParser::ColumnY] > 0.;
+	}
+};
+
+//The format is determined on the first line, only the header is read: the chunks of the layout are the ranges of
+//lines holding the localizations, they are parsed by the caller in one go or group by group
+bool DetectionSet::describeTextFile(const MappedFile & _file, LocalizationTextLayout & _layout)
+{
+	std::vector < std::string > headers;
+	std::string s(_file.begin(), LocalizationFileParser::endOfLine(_file.begin(), _file.end()));
+	char separator = determineSeparator(s);
+	if (separator == 0){
+		std::cout << "Impossible to open " << _file.filename() << std::endl;
+		return false;
+	}
+	headers = split(s, separator, headers);
+
+	int indexes[LocalizationFileParser::NB_COLUMNS];
+	const char * ptr = LocalizationFileParser::nextLine(_file.begin(), _file.end()), * end = _file.end();
+	if (headers.size() == 2){
+		_layout.m_nbSlices = atoi(headers[0].c_str());
+		if (ptr >= end)
+			return false;
+		//The sigma column is optional, its presence is determined on the first localization
+		int slots[5] = { -1, -1, -1, -1, -1 };
+		double tmp[5];
+		bool hasSigma = LocalizationFileParser::parseLine(ptr, LocalizationFileParser::endOfLine(ptr, end), separator, slots, 5, tmp) == 5;
+		indexes[LocalizationFileParser::ColumnX] = 0;
+		indexes[LocalizationFileParser::ColumnY] = 1;
+		indexes[LocalizationFileParser::ColumnIntensity] = 2;
+		indexes[LocalizationFileParser::ColumnFrame] = 3;
+		indexes[LocalizationFileParser::ColumnSigma] = hasSigma ? 4 : -1;
+		_layout.setParser(new ColumnLineParser(separator, indexes));
+	}
+	else if (strncmp(s.c_str(), "Total", strlen("Total")) == 0){
+		indexes[LocalizationFileParser::ColumnX] = 1;
+		indexes[LocalizationFileParser::ColumnY] = 2;
+		indexes[LocalizationFileParser::ColumnIntensity] = -1;
+		indexes[LocalizationFileParser::ColumnFrame] = 0;
+		indexes[LocalizationFileParser::ColumnSigma] = -1;
+		_layout.setParser(new SebastienLineParser(indexes));
+		//Sigmas and intensities are not in the file, they are generated
+		_layout.m_generateIntensitiesSigmas = true;
+		ptr = LocalizationFileParser::nextLine(ptr, end);
+	}
+	else{
+		if (!determineColumnIndexes(headers, indexes))
+			return false;
+		//Frames start at 1 in these files
+		_layout.setParser(new ColumnLineParser(separator, indexes, -1));
+		//The localizations end at the first line of 2 characters, the footer that follows is not parsed
+		end = LocalizationFileParser::findLineOfLength(ptr, end, 2);
+	}
+	LocalizationFileParser::splitInChunks(ptr, end, _layout.m_chunks);
+	return true;
+}
+
+//Merges the columns parsed by the workers, localizations are ordered by frame and keep the order of the file inside a frame
+void DetectionSet::setLocalizations(std::vector < LocalizationChunk > & _chunks, const int _nbSlices, const bool _hasSigma)
+{
+	invalidateSpatialIndex();
+	int nbChunks = _chunks.size();
+	m_nbPoints = 0;
+	m_nbSlices = _nbSlices;
+	for (int n = 0; n < nbChunks; n++){
+		const LocalizationChunk & chunk = _chunks[n];
+		if (chunk.size() == 0) continue;
+		m_nbPoints += chunk.size();
+		int endFrame = chunk.m_firstFrame + chunk.m_countsPerFrame.size();
+		if (endFrame > m_nbSlices)
+			m_nbSlices = endFrame;
+		if (chunk.m_maxX > m_w)
+			m_w = chunk.m_maxX;
+		if (chunk.m_maxY > m_h)
+			m_h = chunk.m_maxY;
+		if (chunk.m_minIntensity < intensityMin)
+			intensityMin = chunk.m_minIntensity;
+		if (chunk.m_maxIntensity > intensityMax)
+			intensityMax = chunk.m_maxIntensity;
+	}
+	if (m_nbPoints == 0)
+		return;
+
+	m_firstsPoint = new unsigned int[m_nbSlices];
+	m_sizePoints = new unsigned int[m_nbSlices];
+	memset(m_firstsPoint, 0, m_nbSlices * sizeof(unsigned int));
+	memset(m_sizePoints, 0, m_nbSlices * sizeof(unsigned int));
+	for (int n = 0; n < nbChunks; n++){
+		const LocalizationChunk & chunk = _chunks[n];
+		for (unsigned int i = 0; i < chunk.m_countsPerFrame.size(); i++)
+			m_sizePoints[chunk.m_firstFrame + i] += chunk.m_countsPerFrame[i];
+	}
+	for (int n = 1; n < m_nbSlices; n++)
+		m_firstsPoint[n] = m_firstsPoint[n - 1] + m_sizePoints[n - 1];
+
+	unsigned int * currents = new unsigned int[m_nbSlices];
+	memcpy(currents, m_firstsPoint, m_nbSlices * sizeof(unsigned int));
+	for (int n = 0; n < nbChunks; n++){
+		LocalizationChunk & chunk = _chunks[n];
+		chunk.m_offsetsPerFrame.resize(chunk.m_countsPerFrame.size());
+		for (unsigned int i = 0; i < chunk.m_countsPerFrame.size(); i++){
+			chunk.m_offsetsPerFrame[i] = currents[chunk.m_firstFrame + i];
+			currents[chunk.m_firstFrame + i] += chunk.m_countsPerFrame[i];
+		}
+	}
+	delete [] currents;
+
+	m_xs = new LocReal[m_nbPoints];
+	m_ys = new LocReal[m_nbPoints];
+	m_intensities = new LocReal[m_nbPoints];
+	m_sigmas = (_hasSigma) ? new LocReal[m_nbPoints] : NULL;
+#pragma omp parallel for schedule(dynamic)
+	for (int n = 0; n < nbChunks; n++){
+		LocalizationChunk & chunk = _chunks[n];
+		for (unsigned int i = 0; i < chunk.size(); i++){
+			unsigned int index = chunk.m_offsetsPerFrame[chunk.m_frames[i] - chunk.m_firstFrame]++;
+			m_xs[index] = chunk.m_xs[i];
+			m_ys[index] = chunk.m_ys[i];
+			m_intensities[index] = chunk.m_intensities[i];
+			if (m_sigmas != NULL)
+				m_sigmas[index] = chunk.m_sigmas[i];
+		}
+		//Columns of the chunk are released as soon as they are copied
+		std::vector < LocReal >().swap(chunk.m_xs);
+		std::vector < LocReal >().swap(chunk.m_ys);
+		std::vector < LocReal >().swap(chunk.m_intensities);
+		std::vector < LocReal >().swap(chunk.m_sigmas);
+		std::vector < unsigned int >().swap(chunk.m_frames);
+	}
+}
+
 void DetectionSet::colorLocsOfObject(unsigned int * _indexes, const int _nbLocs, const Color4D & _color)
 {
 	for (unsigned int n = 0; n < _nbLocs; n++){
@@ -1118,3 +1432,26 @@ void DetectionSet::setColors(Color4D * _colors)
 { 
 	memcpy(m_colors, _colors, m_nbPoints * sizeof(Color4D));
 }
+
+KdTree_2D_columns * DetectionSet::getSpatialIndex()
+{
+	if( m_kdTree != NULL ) return m_kdTree;
+	if( m_xs == NULL || m_ys == NULL ) return NULL;
+
+	MyTimer timer;
+	m_kdColumns = new KdColumns_L( m_xs, m_ys, m_nbPoints );
+	m_kdTree = new KdTree_2D_columns( 2, *m_kdColumns, nanoflann::KDTreeSingleIndexAdaptorParams( 10 /* max leaf */ ) );
+	m_kdTree->buildIndex();
+	std::cout << "Time for building the spatial index of " << m_nbPoints << " localizations: " << timer.getTimeElapsed().toAscii().data() << std::endl;
+	return m_kdTree;
+}
+
+void DetectionSet::invalidateSpatialIndex()
+{
+	if( m_kdTree != NULL )
+		delete m_kdTree;
+	if( m_kdColumns != NULL )
+		delete m_kdColumns;
+	m_kdTree = NULL;
+	m_kdColumns = NULL;
+}
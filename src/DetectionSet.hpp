@@ -34,10 +34,17 @@
 
 #include <iostream>
 #include <vector>
+#include "Vec2.hpp"
 #include "Vec3.hpp"
 #include "Vec4.hpp"
+#include "Precision.hpp"
+#include "nanoflann.hpp"
 #include "ObjectInterface.hpp"
 
+class MappedFile;
+class LocalizationChunk;
+class LocalizationTextLayout;
+
 class DetectionSet: public ObjectInterface{
 public:
 	DetectionSet();
@@ -45,6 +52,7 @@ public:
 	DetectionSet( const std::vector < DetectionSet * > & );
 	DetectionSet(const std::vector< double > &, const std::vector< double > &, const std::vector< unsigned short > &, const std::vector< unsigned int > &, const int, const int);
 	DetectionSet(double *, double *, unsigned short *, unsigned int *, const int, const int);
+	DetectionSet(std::vector < LocalizationChunk > &, const int, const bool);
 	virtual ~DetectionSet();
 
 	//virtual void createTesselerFile( const char * filename );
@@ -55,10 +63,15 @@ public:
 	virtual void save();
 
 	virtual bool createFile(const char *);
+	virtual bool createFile(const MappedFile &);
+	virtual void createBinaryFile(const MappedFile &);
+	virtual bool saveBinaryFile(const char *) const;
 	virtual void createTesselerFile(std::ifstream &, const char, std::vector < std::string > &);
 	virtual void createSebastienFile(std::ifstream &, const char, std::vector < std::string > &);
 	virtual void createOtherFileFormat(std::ifstream &, const char, std::vector < std::string > &);
 
+	static bool describeTextFile(const MappedFile &, LocalizationTextLayout &);
+
 	virtual DetectionSet * copy( DetectionSet * = NULL );
 	virtual void setDir( const std::string & _dir );
 	virtual void setName( const std::string & _name );
@@ -66,20 +79,27 @@ public:
 	virtual int nbPoints()const;
 	virtual int nbSlices() const;
 
-	virtual DetectionPoint * getPoints();
 	virtual unsigned int * getFirstPoint();
 	virtual unsigned int * getSizePoints();
 
 	int size() const;
-	DetectionPoint & operator[]( int );
-	const DetectionPoint & operator[]( int ) const;
+	DetectionPoint operator[]( int ) const;
 	bool isDataSelected( const int );
 	void regenerateIntensityColorVector();
 
 
-	inline double * getIntensities() const {return m_intensities;}
+	//Coordinates are stored as separate columns, z is only allocated for 3D datasets
+	inline LocReal * getXs() const { return m_xs; }
+	inline LocReal * getYs() const { return m_ys; }
+	inline LocReal * getZs() const { return m_zs; }
+	inline double getX( const int _idx ) const { return m_xs[_idx]; }
+	inline double getY( const int _idx ) const { return m_ys[_idx]; }
+	inline double getZ( const int _idx ) const { return ( m_zs != NULL ) ? m_zs[_idx] : 0.; }
+	inline bool is3D() const { return m_zs != NULL; }
+
+	inline LocReal * getIntensities() const {return m_intensities;}
 	inline double getIntensity( const int _idx ) const {return m_intensities[_idx];}
-	inline double * getSigmas() const { return m_sigmas; }
+	inline LocReal * getSigmas() const { return m_sigmas; }
 	inline double getSigma(const int _idx) const { return m_sigmas[_idx]; }
 	inline Color4D * getColors() const { return m_colors; }
 	inline int getNbPoints() const {return m_nbPoints;}
@@ -101,18 +121,29 @@ public:
 	void setColors(Color4D *);
 	void colorLocsOfObject(unsigned int *, const int, const Color4D &);
 
+	//KD-tree over the x/y columns, built on first request and shared by all the analyses
+	KdTree_2D_columns * getSpatialIndex();
+	void invalidateSpatialIndex();
+
 
 	inline const float getWidth() const {return m_w;}
 	inline const float getHeight() const {return m_h;}
 	inline const bool hasSigmaPerLocalization() const { return m_sigmas != NULL; }
 
+protected:
+	static bool determineColumnIndexes(const std::vector < std::string > &, int *);
+	void setLocalizations(std::vector < LocalizationChunk > &, const int, const bool);
+
 protected:
 	std::string m_dir, m_name;
 	float intensityMin, intensityMax, m_w, m_h;
 	int m_nbPoints, m_nbSlices;
 
-	DetectionPoint * m_points, * m_displayPoints;
-	double * m_intensities, * m_sigmas;
+	LocReal * m_xs, * m_ys, * m_zs;
+	Vec2mf * m_displayPoints;
+	KdColumns_L * m_kdColumns;
+	KdTree_2D_columns * m_kdTree;
+	LocReal * m_intensities, * m_sigmas;
 	unsigned int * m_firstsPoint, * m_sizePoints;
 
 	Color4D * m_colors;
@@ -0,0 +1,337 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      DetectionSetStream.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <float.h>
+#include <string.h>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryFile>
+
+#include "DetectionSetStream.hpp"
+#include "LocalizationCache.hpp"
+#include "LoaderDetectionSet.hpp"
+#include "DetectionSet.hpp"
+#include "GeneralTools.hpp"
+
+//Size of the pieces of text parsed together during a conversion, a group of nbChunksForParsing() of them is resident at a time
+static const qint64 SIZE_CONVERSION_CHUNK = 8 << 20;
+
+FrameBlock::FrameBlock():m_firstFrame( 0 ), m_nbFrames( 0 ), m_nbOverlapFrames( 0 ), m_firstLocalization( 0 ), m_nbLocalizations( 0 )
+{
+	m_xs = m_ys = m_intensities = m_sigmas = NULL;
+	m_firstsPoint = m_sizePoints = NULL;
+}
+
+DetectionSetStream::DetectionSetStream( const QString & _filename, const int _nbFramesPerBlock, const int _nbOverlapFrames ):m_file( _filename ), m_temporary( false ), m_detections( NULL )
+{
+	initialize( _nbFramesPerBlock, _nbOverlapFrames );
+	if( !m_file.open( QIODevice::ReadOnly ) ){
+		std::cout << "Impossible to open " << _filename.toAscii().data() << std::endl;
+		return;
+	}
+	if( m_file.read( ( char * )&m_header, sizeof( BinaryLocalizationHeader ) ) != sizeof( BinaryLocalizationHeader ) || memcmp( m_header.m_magic, BinaryLocalizationHeader::MAGIC, 4 ) != 0 || m_header.m_version != BinaryLocalizationHeader::VERSION ){
+		std::cout << _filename.toAscii().data() << " is not a binary localization file" << std::endl;
+		return;
+	}
+	if( m_file.size() < BinaryLocalizationHeader::fileSize( m_header.m_nbPoints, m_header.m_nbSlices, hasSigmaPerLocalization() ) ){
+		std::cout << _filename.toAscii().data() << " is truncated" << std::endl;
+		return;
+	}
+
+	//The per frame structure is the only part of the file kept in memory
+	m_firstsPoint = new unsigned int[m_header.m_nbSlices];
+	m_sizePoints = new unsigned int[m_header.m_nbSlices];
+	qint64 offset = BinaryLocalizationHeader::fileSize( m_header.m_nbPoints, 0, hasSigmaPerLocalization() );
+	m_file.seek( offset );
+	m_file.read( ( char * )m_firstsPoint, m_header.m_nbSlices * sizeof( unsigned int ) );
+	m_file.read( ( char * )m_sizePoints, m_header.m_nbSlices * sizeof( unsigned int ) );
+}
+
+DetectionSetStream::DetectionSetStream( const DetectionSet * _detections, const int _nbFramesPerBlock, const int _nbOverlapFrames ):m_temporary( false ), m_detections( _detections )
+{
+	initialize( _nbFramesPerBlock, _nbOverlapFrames );
+	if( _detections == NULL || _detections->getFirsts() == NULL )
+		return;
+	m_header = BinaryLocalizationHeader( _detections->getNbPoints(), _detections->nbSlices(), _detections->getWidth(), _detections->getHeight(), 0.f, 0.f, _detections->hasSigmaPerLocalization() );
+	m_firstsPoint = new unsigned int[m_header.m_nbSlices];
+	m_sizePoints = new unsigned int[m_header.m_nbSlices];
+	memcpy( m_firstsPoint, _detections->getFirsts(), m_header.m_nbSlices * sizeof( unsigned int ) );
+	memcpy( m_sizePoints, _detections->getSizes(), m_header.m_nbSlices * sizeof( unsigned int ) );
+}
+
+DetectionSetStream::~DetectionSetStream()
+{
+	unmapColumns();
+	if( m_firstsPoint != NULL )
+		delete [] m_firstsPoint;
+	if( m_sizePoints != NULL )
+		delete [] m_sizePoints;
+	m_file.close();
+	if( m_temporary )
+		QFile::remove( m_file.fileName() );
+}
+
+void DetectionSetStream::initialize( const int _nbFramesPerBlock, const int _nbOverlapFrames )
+{
+	m_firstsPoint = m_sizePoints = NULL;
+	for( int n = 0; n < 4; n++ )
+		m_mapped[n] = NULL;
+	m_currentFrame = 0;
+	m_nbFramesPerBlock = ( _nbFramesPerBlock < 1 ) ? 1 : _nbFramesPerBlock;
+	m_nbOverlapFrames = ( _nbOverlapFrames < 0 ) ? 0 : _nbOverlapFrames;
+}
+
+//Text files are streamed from their cache entry, which is written the first time by a streamed conversion
+//When the cache cannot be used, the conversion is written in a temporary file removed with the stream
+DetectionSetStream * DetectionSetStream::open( const QString & _filename, const int _nbFramesPerBlock, const int _nbOverlapFrames )
+{
+	MappedFile mapped( _filename.toAscii().data() );
+	if( !mapped.isMapped() )
+		return NULL;
+	QString binaryName = _filename;
+	bool temporary = false;
+	if( !BinaryLocalizationHeader::isBinaryFile( mapped.begin(), mapped.end() ) ){
+		binaryName = LocalizationCache::entryForTextFile( _filename, mapped );
+		if( binaryName.isEmpty() ){
+			QTemporaryFile tmpFile( QDir::tempPath() + "/srtesseler_XXXXXX" );
+			tmpFile.setAutoRemove( false );
+			if( !tmpFile.open() )
+				return NULL;
+			binaryName = tmpFile.fileName();
+			tmpFile.close();
+			if( !convertTextFile( mapped, binaryName ) ){
+				QFile::remove( binaryName );
+				return NULL;
+			}
+			temporary = true;
+		}
+	}
+	DetectionSetStream * stream = new DetectionSetStream( binaryName, _nbFramesPerBlock, _nbOverlapFrames );
+	stream->m_temporary = temporary;
+	if( !stream->isOpen() ){
+		delete stream;
+		return NULL;
+	}
+	return stream;
+}
+
+//Writes the binary columnar file of a text file without building the dataset, the text is parsed group of chunks by
+//group of chunks twice: the first pass counts the localizations of each frame, the second one scatters them at their
+//place in the columns of the output, which are mapped only on the range written by the group
+bool DetectionSetStream::convertTextFile( const MappedFile & _file, const QString & _output )
+{
+	LocalizationTextLayout layout;
+	if( !LoaderDetectionSet::describeTextFile( _file, layout ) )
+		return false;
+	MyTimer timer;
+	std::vector < LocalizationChunk > chunks;
+	for( unsigned int n = 0; n < layout.m_chunks.size(); n++ )
+		LocalizationFileParser::splitInChunksOfSize( layout.m_chunks[n].m_begin, layout.m_chunks[n].m_end, chunks, SIZE_CONVERSION_CHUNK, layout.m_chunks[n].m_frame );
+	int nbChunks = chunks.size(), sizeGroup = LocalizationFileParser::nbChunksForParsing();
+	bool hasSigma = layout.hasSigma();
+
+	std::vector < unsigned int > sizes( std::max( layout.m_nbSlices, 0 ), 0 );
+	for( int first = 0; first < nbChunks; first += sizeGroup ){
+		std::vector < LocalizationChunk > group( chunks.begin() + first, chunks.begin() + std::min( first + sizeGroup, nbChunks ) );
+		LocalizationFileParser::parseChunks( group, layout.getParser() );
+		for( unsigned int n = 0; n < group.size(); n++ ){
+			const LocalizationChunk & chunk = group[n];
+			if( chunk.size() == 0 ) continue;
+			if( chunk.m_firstFrame + chunk.m_countsPerFrame.size() > sizes.size() )
+				sizes.resize( chunk.m_firstFrame + chunk.m_countsPerFrame.size(), 0 );
+			for( unsigned int i = 0; i < chunk.m_countsPerFrame.size(); i++ )
+				sizes[chunk.m_firstFrame + i] += chunk.m_countsPerFrame[i];
+		}
+	}
+	unsigned int nbSlices = sizes.size(), nbPoints = 0;
+	std::vector < unsigned int > firsts( nbSlices, 0 );
+	for( unsigned int n = 0; n < nbSlices; n++ ){
+		firsts[n] = nbPoints;
+		nbPoints += sizes[n];
+	}
+	if( nbPoints == 0 )
+		return false;
+
+	QFile file( _output );
+	if( !file.open( QIODevice::ReadWrite | QIODevice::Truncate ) || !file.resize( BinaryLocalizationHeader::fileSize( nbPoints, nbSlices, hasSigma ) ) ){
+		std::cout << "Impossible to write " << _output.toAscii().data() << std::endl;
+		return false;
+	}
+
+	//Inside a frame, the localizations keep the order of the file as with DetectionSet::setLocalizations
+	std::vector < unsigned int > currents( firsts );
+	double maxX = 0., maxY = 0., intensityMin = FLT_MAX, intensityMax = FLT_MIN;
+	int nbColumns = hasSigma ? 4 : 3;
+	std::random_device rd;
+	std::mt19937 gen( rd() );
+	for( int first = 0; first < nbChunks; first += sizeGroup ){
+		std::vector < LocalizationChunk > group( chunks.begin() + first, chunks.begin() + std::min( first + sizeGroup, nbChunks ) );
+		LocalizationFileParser::parseChunks( group, layout.getParser() );
+		unsigned int minIndex = nbPoints, maxIndex = 0;
+		for( unsigned int n = 0; n < group.size(); n++ ){
+			LocalizationChunk & chunk = group[n];
+			if( chunk.size() == 0 ) continue;
+			if( layout.m_generateIntensitiesSigmas )
+				chunk.generateIntensitiesSigmas( gen );
+			chunk.m_offsetsPerFrame.resize( chunk.m_countsPerFrame.size() );
+			for( unsigned int i = 0; i < chunk.m_countsPerFrame.size(); i++ ){
+				unsigned int & current = currents[chunk.m_firstFrame + i];
+				chunk.m_offsetsPerFrame[i] = current;
+				if( chunk.m_countsPerFrame[i] == 0 ) continue;
+				minIndex = std::min( minIndex, current );
+				current += chunk.m_countsPerFrame[i];
+				maxIndex = std::max( maxIndex, current );
+			}
+			maxX = std::max( maxX, chunk.m_maxX );
+			maxY = std::max( maxY, chunk.m_maxY );
+			intensityMin = std::min( intensityMin, chunk.m_minIntensity );
+			intensityMax = std::max( intensityMax, chunk.m_maxIntensity );
+		}
+		if( minIndex >= maxIndex ) continue;
+
+		//For files ordered by frame the range written by a group is about the size of the group
+		double * columns[4] = { NULL, NULL, NULL, NULL };
+		bool mapped = true;
+		for( int c = 0; c < nbColumns && mapped; c++ ){
+			qint64 offset = ( qint64 )sizeof( BinaryLocalizationHeader ) + ( ( qint64 )c * nbPoints + minIndex ) * sizeof( double );
+			columns[c] = ( double * )file.map( offset, ( qint64 )( maxIndex - minIndex ) * sizeof( double ) );
+			mapped = columns[c] != NULL;
+		}
+		if( mapped ){
+			int nbGroup = group.size();
+#pragma omp parallel for schedule(dynamic)
+			for( int n = 0; n < nbGroup; n++ ){
+				LocalizationChunk & chunk = group[n];
+				for( unsigned int i = 0; i < chunk.size(); i++ ){
+					unsigned int index = chunk.m_offsetsPerFrame[chunk.m_frames[i] - chunk.m_firstFrame]++ - minIndex;
+					columns[0][index] = chunk.m_xs[i];
+					columns[1][index] = chunk.m_ys[i];
+					columns[2][index] = chunk.m_intensities[i];
+					if( hasSigma )
+						columns[3][index] = chunk.m_sigmas[i];
+				}
+			}
+		}
+		for( int c = 0; c < nbColumns; c++ )
+			if( columns[c] != NULL )
+				file.unmap( ( uchar * )columns[c] );
+		if( !mapped ){
+			std::cout << "Impossible to map " << _output.toAscii().data() << std::endl;
+			return false;
+		}
+	}
+
+	BinaryLocalizationHeader header( nbPoints, nbSlices, maxX, maxY, intensityMin, intensityMax, hasSigma );
+	file.seek( BinaryLocalizationHeader::fileSize( nbPoints, 0, hasSigma ) );
+	file.write( ( const char * )&firsts[0], nbSlices * sizeof( unsigned int ) );
+	file.write( ( const char * )&sizes[0], nbSlices * sizeof( unsigned int ) );
+	file.seek( 0 );
+	bool worked = file.write( ( const char * )&header, sizeof( BinaryLocalizationHeader ) ) == sizeof( BinaryLocalizationHeader );
+	worked = file.flush() && worked;
+	file.close();
+	if( !worked ){
+		std::cout << "Error while writing " << _output.toAscii().data() << std::endl;
+		return false;
+	}
+	std::cout << "# of localizations:" << nbPoints << ", time for converting " << _file.filename() << " " << timer.getTimeElapsed().toAscii().data() << std::endl;
+	return true;
+}
+
+void DetectionSetStream::reset()
+{
+	unmapColumns();
+	m_currentFrame = 0;
+}
+
+bool DetectionSetStream::nextBlock( FrameBlock & _block )
+{
+	unmapColumns();
+	int nbSlices = m_header.m_nbSlices;
+	if( !isOpen() || m_currentFrame >= nbSlices )
+		return false;
+
+	int endFrame = std::min( m_currentFrame + m_nbFramesPerBlock, nbSlices );
+	int endOverlap = std::min( endFrame + m_nbOverlapFrames, nbSlices );
+	unsigned int firstLocalization = m_firstsPoint[m_currentFrame];
+	unsigned int endLocalization = m_firstsPoint[endOverlap - 1] + m_sizePoints[endOverlap - 1];
+
+	_block.m_firstFrame = m_currentFrame;
+	_block.m_nbFrames = endFrame - m_currentFrame;
+	_block.m_nbOverlapFrames = endOverlap - endFrame;
+	_block.m_firstLocalization = firstLocalization;
+	_block.m_nbLocalizations = endLocalization - firstLocalization;
+	_block.m_firstsPoint = m_firstsPoint;
+	_block.m_sizePoints = m_sizePoints;
+	if( m_detections != NULL ){
+		_block.m_xs = copyColumn( 0, m_detections->getXs(), firstLocalization, _block.m_nbLocalizations );
+		_block.m_ys = copyColumn( 1, m_detections->getYs(), firstLocalization, _block.m_nbLocalizations );
+		_block.m_intensities = copyColumn( 2, m_detections->getIntensities(), firstLocalization, _block.m_nbLocalizations );
+		_block.m_sigmas = copyColumn( 3, m_detections->getSigmas(), firstLocalization, _block.m_nbLocalizations );
+	}
+	else{
+		_block.m_xs = mapColumn( 0, firstLocalization, _block.m_nbLocalizations );
+		_block.m_ys = mapColumn( 1, firstLocalization, _block.m_nbLocalizations );
+		_block.m_intensities = mapColumn( 2, firstLocalization, _block.m_nbLocalizations );
+		_block.m_sigmas = hasSigmaPerLocalization() ? mapColumn( 3, firstLocalization, _block.m_nbLocalizations ) : NULL;
+	}
+
+	m_currentFrame = endFrame;
+	return _block.m_nbLocalizations == 0 || ( _block.m_xs != NULL && _block.m_ys != NULL && _block.m_intensities != NULL );
+}
+
+//Maps the range of localizations [_first, _first + _nb[ of the column _column of the file
+const double * DetectionSetStream::mapColumn( const int _column, const unsigned int _first, const unsigned int _nb )
+{
+	if( _nb == 0 ) return NULL;
+	qint64 offset = ( qint64 )sizeof( BinaryLocalizationHeader ) + ( ( qint64 )_column * m_header.m_nbPoints + _first ) * sizeof( double );
+	m_mapped[_column] = m_file.map( offset, ( qint64 )_nb * sizeof( double ) );
+	return ( const double * )m_mapped[_column];
+}
+
+//Same range taken from a loaded column, which can be stored in single precision
+const double * DetectionSetStream::copyColumn( const int _column, const LocReal * _values, const unsigned int _first, const unsigned int _nb )
+{
+	if( _nb == 0 || _values == NULL ) return NULL;
+	m_buffers[_column].assign( _values + _first, _values + _first + _nb );
+	return &m_buffers[_column][0];
+}
+
+void DetectionSetStream::unmapColumns()
+{
+	for( int n = 0; n < 4; n++ ){
+		if( m_mapped[n] != NULL )
+			m_file.unmap( m_mapped[n] );
+		m_mapped[n] = NULL;
+	}
+}
@@ -0,0 +1,107 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      DetectionSetStream.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef DetectionSetStream_h__
+#define DetectionSetStream_h__
+
+#include <QFile>
+#include <QString>
+#include <vector>
+
+#include "LocalizationFileParser.hpp"
+
+class DetectionSet;
+
+//Localizations of a block of consecutive frames, the columns are indexed from the first localization of the block
+class FrameBlock{
+public:
+	FrameBlock();
+
+	inline unsigned int getFirstPoint( const int _frame ) const { return m_firstsPoint[_frame] - m_firstLocalization; }
+	inline unsigned int getSizePoints( const int _frame ) const { return m_sizePoints[_frame]; }
+
+	//Frames [m_firstFrame, m_firstFrame + m_nbFrames[ belong to the block, the m_nbOverlapFrames following ones are
+	//also available for the consumers needing to look forward in time (they are the first frames of the next block)
+	int m_firstFrame, m_nbFrames, m_nbOverlapFrames;
+	unsigned int m_firstLocalization, m_nbLocalizations;
+	const double * m_xs, * m_ys, * m_intensities, * m_sigmas;
+	//Per frame structure of the whole dataset, indexed with the frame number
+	const unsigned int * m_firstsPoint, * m_sizePoints;
+};
+
+//Frame-block by frame-block access to a dataset stored with the binary columnar format (.srtb)
+//Only the header and the per frame structure are resident, the columns of the current block are mapped on demand
+//A dataset already loaded can be streamed the same way, the columns of the current block are then copied
+class DetectionSetStream{
+public:
+	DetectionSetStream( const QString &, const int, const int = 0 );
+	DetectionSetStream( const DetectionSet *, const int, const int = 0 );
+	~DetectionSetStream();
+
+	static DetectionSetStream * open( const QString &, const int, const int = 0 );
+	static bool convertTextFile( const MappedFile &, const QString & );
+
+	inline bool isOpen() const { return m_firstsPoint != NULL; }
+	inline int nbSlices() const { return m_header.m_nbSlices; }
+	inline unsigned int nbPoints() const { return m_header.m_nbPoints; }
+	inline float getWidth() const { return m_header.m_w; }
+	inline float getHeight() const { return m_header.m_h; }
+	inline bool hasSigmaPerLocalization() const { return ( m_header.m_flags & BinaryLocalizationHeader::HasSigma ) != 0; }
+	inline const unsigned int * getFirsts() const { return m_firstsPoint; }
+	inline const unsigned int * getSizes() const { return m_sizePoints; }
+
+	void reset();
+	bool nextBlock( FrameBlock & );
+
+protected:
+	void initialize( const int, const int );
+	const double * mapColumn( const int, const unsigned int, const unsigned int );
+	const double * copyColumn( const int, const LocReal *, const unsigned int, const unsigned int );
+	void unmapColumns();
+
+protected:
+	QFile m_file;
+	//The file is a conversion written for this stream only, it is removed with the stream
+	bool m_temporary;
+	BinaryLocalizationHeader m_header;
+	unsigned int * m_firstsPoint, * m_sizePoints;
+	int m_currentFrame, m_nbFramesPerBlock, m_nbOverlapFrames;
+
+	//Mapped parts of the x, y, intensity and sigma columns for the current block
+	uchar * m_mapped[4];
+
+	//Columns of the current block for a dataset already loaded
+	const DetectionSet * m_detections;
+	std::vector < double > m_buffers[4];
+};
+
+#endif // DetectionSetStream_h__
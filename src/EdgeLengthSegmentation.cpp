@@ -0,0 +1,154 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      EdgeLengthSegmentation.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "EdgeLengthSegmentation.hpp"
+
+EdgeLengthSegmentation::EdgeLengthSegmentation():m_lengthsSqr( NULL ), m_edges( NULL ), m_nbEdges( 0 ), m_nbMolecules( 0 ), m_parents( NULL ), m_labels( NULL ), m_sizes( NULL ), m_nbUnited( 0 ), m_nbComponents( 0 ), m_maxLengthSqr( 0.f )
+{
+}
+
+EdgeLengthSegmentation::~EdgeLengthSegmentation()
+{
+	clear();
+}
+
+void EdgeLengthSegmentation::clear()
+{
+	if( m_lengthsSqr != NULL )
+		delete [] m_lengthsSqr;
+	if( m_edges != NULL )
+		delete [] m_edges;
+	if( m_parents != NULL )
+		delete [] m_parents;
+	if( m_labels != NULL )
+		delete [] m_labels;
+	if( m_sizes != NULL )
+		delete [] m_sizes;
+	m_lengthsSqr = NULL;
+	m_edges = m_parents = m_labels = m_sizes = NULL;
+	m_nbEdges = m_nbMolecules = m_nbUnited = m_nbComponents = 0;
+	m_maxLengthSqr = 0.f;
+}
+
+bool sortEdgesByLength( const std::pair < float, int > & _e1, const std::pair < float, int > & _e2 ){
+	return _e1.first < _e2.first;
+}
+
+//The info of each finite vertex has to be its molecule index
+void EdgeLengthSegmentation::build( const Delaunay_triangulation_2 & _delau, const int _nbMolecules )
+{
+	clear();
+	m_nbMolecules = _nbMolecules;
+	std::vector < int > edges;
+	edges.reserve( 2 * ( 3 * m_nbMolecules ) );
+	for( Delaunay_triangulation_2::Finite_edges_iterator it = _delau.finite_edges_begin(); it != _delau.finite_edges_end(); it++ ){
+		edges.push_back( it->first->vertex( ( it->second + 1 ) % 3 )->info() );
+		edges.push_back( it->first->vertex( ( it->second + 2 ) % 3 )->info() );
+	}
+	m_nbEdges = edges.size() / 2;
+	std::vector < std::pair < float, int > > lengths( m_nbEdges );
+	std::vector < VertHandle > molecules( m_nbMolecules );
+	for( Delaunay_triangulation_2::Finite_vertices_iterator it = _delau.finite_vertices_begin(); it != _delau.finite_vertices_end(); it++ )
+		molecules[it->info()] = it;
+#pragma omp parallel for
+	for( int n = 0; n < m_nbEdges; n++ )
+		lengths[n] = std::make_pair( ( float )CGAL::squared_distance( molecules[edges[2 * n]]->point(), molecules[edges[2 * n + 1]]->point() ), n );
+	std::sort( lengths.begin(), lengths.end(), sortEdgesByLength );
+
+	m_lengthsSqr = new float[m_nbEdges];
+	m_edges = new int[2 * m_nbEdges];
+#pragma omp parallel for
+	for( int n = 0; n < m_nbEdges; n++ ){
+		m_lengthsSqr[n] = lengths[n].first;
+		m_edges[2 * n] = edges[2 * lengths[n].second];
+		m_edges[2 * n + 1] = edges[2 * lengths[n].second + 1];
+	}
+	m_parents = new int[m_nbMolecules];
+	m_labels = new int[m_nbMolecules];
+	m_sizes = new int[m_nbMolecules];
+	for( int n = 0; n < m_nbMolecules; n++ )
+		m_parents[n] = n;
+}
+
+int EdgeLengthSegmentation::find( const int _idx )
+{
+	int current = _idx;
+	while( m_parents[current] != current ){
+		m_parents[current] = m_parents[m_parents[current]];
+		current = m_parents[current];
+	}
+	return current;
+}
+
+//Labels the molecules for the edges not longer than the threshold, the components are numbered in the order of
+//their first molecule. Returns the number of components
+int EdgeLengthSegmentation::label( const double _maxLength )
+{
+	m_maxLengthSqr = ( float )( _maxLength * _maxLength );
+	int nbKept = std::upper_bound( m_lengthsSqr, m_lengthsSqr + m_nbEdges, m_maxLengthSqr ) - m_lengthsSqr;
+	if( nbKept < m_nbUnited ){
+		for( int n = 0; n < m_nbMolecules; n++ )
+			m_parents[n] = n;
+		m_nbUnited = 0;
+	}
+	for( ; m_nbUnited < nbKept; m_nbUnited++ ){
+		int root1 = find( m_edges[2 * m_nbUnited] ), root2 = find( m_edges[2 * m_nbUnited + 1] );
+		if( root1 < root2 )
+			m_parents[root2] = root1;
+		else if( root2 < root1 )
+			m_parents[root1] = root2;
+	}
+
+	//The root of a component is its first molecule, so it is labelled before the other ones
+	m_nbComponents = 0;
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		int root = find( n );
+		if( root == n ){
+			m_sizes[m_nbComponents] = 0;
+			m_labels[n] = m_nbComponents++;
+		}
+		else
+			m_labels[n] = m_labels[root];
+		m_sizes[m_labels[n]]++;
+	}
+	return m_nbComponents;
+}
+
+//Length of the edge at the given fraction of the sorted edges
+double EdgeLengthSegmentation::getQuantile( const double _fraction ) const
+{
+	if( m_nbEdges == 0 ) return 0.;
+	int index = ( int )( _fraction * ( m_nbEdges - 1 ) + 0.5 );
+	return sqrt( m_lengthsSqr[std::max( 0, std::min( m_nbEdges - 1, index ) )] );
+}
@@ -0,0 +1,75 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      EdgeLengthSegmentation.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef EdgeLengthSegmentation_h__
+#define EdgeLengthSegmentation_h__
+
+#include "ObjectInterface.hpp"
+
+//Segmentation of the molecules by the length of the Delaunay edges: the edges longer than a threshold are removed and
+//the remaining connected components are labelled. The finite edges are sorted once by length, so the edges kept for a
+//threshold are a prefix of them. The union-find is only continued when the threshold increases, which makes scrubbing
+//the threshold cheap. The lengths are compared squared and in float, as the longest edges of the faces
+class EdgeLengthSegmentation{
+public:
+	EdgeLengthSegmentation();
+	~EdgeLengthSegmentation();
+
+	void build( const Delaunay_triangulation_2 &, const int );
+	void clear();
+	int label( const double );
+	double getQuantile( const double ) const;
+
+	inline bool isBuilt() const { return m_lengthsSqr != NULL; }
+	inline int nbEdges() const { return m_nbEdges; }
+	inline int nbComponents() const { return m_nbComponents; }
+	inline const int * getLabels() const { return m_labels; }
+	inline int componentSize( const int _idx ) const { return m_sizes[_idx]; }
+	inline float getMaxLengthSqr() const { return m_maxLengthSqr; }
+
+protected:
+	int find( const int );
+
+protected:
+	//Squared lengths of the edges in increasing order and the two molecules of each edge
+	float * m_lengthsSqr;
+	int * m_edges;
+	int m_nbEdges, m_nbMolecules;
+
+	//Union-find of the m_nbUnited shortest edges
+	int * m_parents, * m_labels, * m_sizes;
+	int m_nbUnited, m_nbComponents;
+	//Squared threshold of the last labelling, an edge is kept when its squared length is not above it
+	float m_maxLengthSqr;
+};
+
+#endif // EdgeLengthSegmentation_h__
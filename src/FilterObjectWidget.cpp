@@ -383,6 +383,10 @@ FilterVoronoiDiagramWidget::FilterVoronoiDiagramWidget( ObjectInterface * _data,
 		m_cboxFillPol->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
 		QStringList histogramTypes;
 		histogramTypes << "LocalDensity" << "MeanDistance" << "Area";
+		WrapperVoronoiDiagram * voronoi = dynamic_cast < WrapperVoronoiDiagram * >( _data );
+		if( voronoi != NULL )
+			for( int rank = 2; rank <= voronoi->getMaxDensityRank(); rank++ )
+				histogramTypes << QString( "LocalDensityRank%1" ).arg( rank );
 		m_combo = new QComboBox;
 		m_combo->addItems( histogramTypes );
 		m_combo->setCurrentIndex( _data->whatTypeHistogram() );
@@ -462,6 +466,10 @@ void FilterVoronoiDiagramWidget::setHistogramData( ObjectInterface * _data, Came
 		m_cboxFillPol->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
 		QStringList histogramTypes;
 		histogramTypes << "LocalDensity" << "MeanDistance" << "Area";
+		WrapperVoronoiDiagram * voronoi = dynamic_cast < WrapperVoronoiDiagram * >( _data );
+		if( voronoi != NULL )
+			for( int rank = 2; rank <= voronoi->getMaxDensityRank(); rank++ )
+				histogramTypes << QString( "LocalDensityRank%1" ).arg( rank );
 		m_combo = new QComboBox;
 		m_combo->addItems( histogramTypes );
 		m_combo->setCurrentIndex( _data->whatTypeHistogram() );
@@ -35,6 +35,9 @@
 #include <float.h>
 #include <QDir>
 #include <QFileDialog>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "GeneralTools.hpp"
 #include "ImageViewer.hpp"
@@ -164,7 +167,8 @@ double EquationFit::getFitValues( const double _t )
 	return m_function( _t, m_paramsEqn );
 }
 
-ArrayStatistics GeneralTools::generateArrayStatistics( double * _data, const int _nb )
+template < typename T >
+ArrayStatistics GeneralTools::generateArrayStatistics( const T * _data, const int _nb )
 {
 	double nb = _nb;
 	ArrayStatistics stats;
@@ -194,6 +198,9 @@ ArrayStatistics GeneralTools::generateArrayStatistics( double * _data, const int
 	return stats;
 }
 
+template ArrayStatistics GeneralTools::generateArrayStatistics < float >( const float *, const int );
+template ArrayStatistics GeneralTools::generateArrayStatistics < double >( const double *, const int );
+
 ArrayStatistics GeneralTools::generateInverseArrayStatistics( double * _invData, const int _nb )
 {
 	double nbData = 0.;
@@ -233,6 +240,21 @@ std::ostream & operator<<( std::ostream & _os, const ArrayStatistics & _stats )
 	return _os << "[Mean : " << _stats.m_mean << ", median : " << _stats.m_median << ", std dev : " << _stats.m_stdDev << ", min : " << _stats.m_min << ", max = " << _stats.m_max << "]";
 }
 
+ThrottledProgress::ThrottledProgress( const int _offset, const int _nb ):m_offset( _offset )
+{
+	m_step = _nb / 100;
+	if( m_step < 1 ) m_step = 1;
+}
+
+void ThrottledProgress::update( const int _n )
+{
+	if( _n % m_step != 0 ) return;
+#ifdef _OPENMP
+	if( omp_get_thread_num() != 0 ) return;
+#endif
+	GeneralTools::m_imw->m_progress->setValue( m_offset + _n );
+}
+
 MyTimer::MyTimer()
 {
 	m_time.start();
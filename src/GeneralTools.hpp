@@ -83,13 +83,25 @@ public:
 
 class GeneralTools{
 public:
-	static ArrayStatistics generateArrayStatistics( double *, const int );
+	template < typename T > static ArrayStatistics generateArrayStatistics( const T *, const int );
 	static ArrayStatistics generateInverseArrayStatistics( double *, const int );
 
 public:
 	static ImageViewer * m_imw;
 };
 
+//Progress bar update usable from an OpenMP loop: only the master thread
+//touches the widget and only about every percent of the loop
+class ThrottledProgress{
+public:
+	ThrottledProgress( const int, const int );
+
+	void update( const int );
+
+protected:
+	int m_offset, m_step;
+};
+
 class MyTimer{
 public:
 	MyTimer();
@@ -556,7 +556,7 @@ void HistogramCamera::saveDataHistogram(const QString & _typeHisto, const int _t
 	if (_typeHisto == "Intensity"){
 
 	}
-	if (_typeHisto == "LocalDensity" || _typeHisto == "MeanDistance" || _typeHisto == "Area"){
+	if (_typeHisto.startsWith("LocalDensity") || _typeHisto == "MeanDistance" || _typeHisto == "Area"){
 		WrapperVoronoiDiagram * wv = dynamic_cast <WrapperVoronoiDiagram *>(m_data);
 		if (wv){
 			double nbs = wv->nbMolecules();
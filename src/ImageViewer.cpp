@@ -38,6 +38,7 @@
 #include "GeneralTools.hpp"
 #include "SuperResObject.hpp"
 #include "DetectionSet.hpp"
+#include "LocalizationCache.hpp"
 #ifdef PALM_TRACER
 #include "FilesDeterminator.hpp"
 #endif
@@ -245,7 +246,7 @@ void ImageViewer::openLocalizationDataset()
 	const QString fileName = QFileDialog::getOpenFileName(this,
 		tr("Open File"),
 		QDir::currentPath() + "/Data",
-		tr("Localization Files (*.txt *.csv)"), 0, QFileDialog::DontUseNativeDialog);
+		tr("Localization Files (*.txt *.csv *.srtb)"), 0, QFileDialog::DontUseNativeDialog);
 
 	if (!fileName.isEmpty()) {
 		int index = fileName.lastIndexOf('/');
@@ -254,13 +255,14 @@ void ImageViewer::openLocalizationDataset()
 		dir.replace(index, fileName.size() - index, "");
 		QString name(fileName);
 		name.replace(0, index, "");
-		DetectionSet * detections = new DetectionSet();
-		bool worked = detections->createFile(fileName.toAscii().data());
-		if (!worked){
-			delete detections;
+		DetectionSet * detections = LocalizationCache::openDetectionSet(fileName);
+		if (detections == NULL){
 			std::cout << "Loading of " << fileName.toAscii().data() << " have failed" << std::endl;
 			return;
 		}
+		//Same palette whether the localizations were parsed, loaded by a dedicated loader or reloaded from the cache
+		detections->setPalette(Palette::getStaticLut("InvFire"));
+		detections->regenerateIntensityColorVector();
 		detections->createDisplayPoints(detections->getWidth(), detections->getHeight());
 		SuperResObject * obj = new SuperResObject(dir.toAscii().data(), "Color1", detections->getWidth(), detections->getHeight());
 		obj->setDetectionSet(detections);
@@ -42,15 +42,7 @@ KRipley::KRipley(DetectionSet * _dset, const float _w, const float _h) :m_w(_w),
 	m_results = m_ks = m_ls = m_ts = NULL;
 
 	m_dset = _dset;
-	DetectionPoint * origPoints = _dset->getPoints();
-	m_cloud = new KdPointCloud_D();
-	m_cloud->m_pts.resize(_dset->nbPoints());
-	for (unsigned int n2 = 0; n2 < _dset->nbPoints(); n2++){
-		m_cloud->m_pts[n2].m_x = origPoints[n2].x();
-		m_cloud->m_pts[n2].m_y = origPoints[n2].y();
-	}
-	m_tree = new KdTree_2D_double(2, *m_cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */));
-	m_tree->buildIndex();
+	m_tree = _dset->getSpatialIndex();
 
 	m_density = (double)m_dset->nbPoints() / (double)(m_w * m_h);
 }
@@ -109,19 +101,19 @@ void KRipley::computeKRipley(const double _minR, const double _maxR, const doubl
 
 	//Generation of the localization set inside the ROIs, if not onROIs selected or there is no ROIs, the whole localization set is selected
 	m_pointsInROIs.clear();
-	DetectionPoint * points = m_dset->getPoints();
+	const LocReal * xs = m_dset->getXs(), * ys = m_dset->getYs();
 	if (!_onROIs || (_onROIs && _rois.empty())){
 		m_pointsInROIs.resize(m_dset->nbPoints());
 		for (unsigned int n = 0; n < m_dset->nbPoints(); n++)
-			m_pointsInROIs[n] = &points[n];
+			m_pointsInROIs[n] = n;
 	}
 	else{
 		for (unsigned int n = 0; n < m_dset->nbPoints(); n++){
 			bool found = false;
 			for (RoiList::const_iterator it = _rois.begin(); it != _rois.end() && !found; it++)
-				found = it->inside(points[n].x(), points[n].y());
+				found = it->inside(xs[n], ys[n]);
 			if (found)
-				m_pointsInROIs.push_back(&points[n]);
+				m_pointsInROIs.push_back(n);
 		}
 	}
 
@@ -148,13 +140,14 @@ const double KRipley::computeRipleyFunction( const double _r )
 	double res = 0., divisor = m_density, r2 = _r * _r;// * m_nbPoints;
 	double meanNbNeighbors = 0, nbP = m_dset->nbPoints(), trueMean = 0.;
 	//DetectionPoint * points = m_dset->getPoints();
-	const double search_radius = static_cast<double>(r2);
-	std::vector<std::pair<std::size_t, double> > ret_matches;
+	const LocReal search_radius = static_cast<LocReal>(r2);
+	std::vector<std::pair<std::size_t, LocReal> > ret_matches;
 	nanoflann::SearchParams params;
 	std::size_t nMatches;
 	//for( int n = 0; n < m_dset->nbPoints(); n++ ){
+	const LocReal * xs = m_dset->getXs(), * ys = m_dset->getYs();
 	for (int n = 0; n < m_pointsInROIs.size(); n++){
-		double x = m_pointsInROIs[n]->x(), y = m_pointsInROIs[n]->y();
+		double x = xs[m_pointsInROIs[n]], y = ys[m_pointsInROIs[n]];
 		bool crossBorder = ( x < _r ) || ( y < _r ) || ( x > ( m_w - _r ) ) || ( y > ( m_h - _r ) );
 		double areaDomain = M_PI * _r * _r;
 		double factorArea = ( crossBorder ) ? edgeCorrection( x, y, _r ) : areaDomain;
@@ -162,7 +155,7 @@ const double KRipley::computeRipleyFunction( const double _r )
 
 		double sum = 0.;
 		//NodeElement ** neighbors = ( NodeElement ** )malloc( sizeArray * sizeof( NodeElement * ) );
-		const double queryPt[2] = { x, y };
+		const LocReal queryPt[2] = { xs[m_pointsInROIs[n]], ys[m_pointsInROIs[n]] };
 		nMatches = m_tree->radiusSearch(&queryPt[0], search_radius, ret_matches, params);
 		sum = nMatches - 1;
 		/*for (int i = 0; i < nMatches; i++){
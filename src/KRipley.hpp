@@ -60,10 +60,9 @@ protected:
 protected:
 	double m_minR, m_maxR, m_stepR, m_density, * m_results, m_w, m_h;
 	DetectionSet * m_dset;
-	KdPointCloud_D * m_cloud;
-	KdTree_2D_double * m_tree;
+	KdTree_2D_columns * m_tree;
 
-	std::vector <DetectionPoint *> m_pointsInROIs;
+	std::vector <unsigned int> m_pointsInROIs;
 
 	double * m_ks, *m_ls, * m_ts;
 	unsigned int m_nbSteps;
@@ -30,12 +30,14 @@
 */
 
 #include <float.h>
+#include <string.h>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 
 #include "LoaderDetectionSet.hpp"
+#include "LocalizationFileParser.hpp"
 #include "GeneralTools.hpp"
 
 DetectionSet * LoaderDetectionSet::generateDetectionSetFromVector(const std::vector < DetectionSet * > & _detections)
@@ -43,12 +45,30 @@ DetectionSet * LoaderDetectionSet::generateDetectionSetFromVector(const std::vec
 	return new DetectionSet(_detections);
 }
 
+DetectionSet * LoaderDetectionSet::loadFile(const QString & _filename)
+{
+	MappedFile mapped(_filename.toAscii().data());
+	if (!mapped.isMapped()){
+		std::cout << "Impossible to open " << _filename.toAscii().data() << std::endl;
+		return NULL;
+	}
+	return loadFile(mapped);
+}
+
 LoaderDetectionSet * LoaderDetectionSet::getInstance(const QString & _filename)
 {
-	std::ifstream fs;
-	fs.open(_filename.toAscii().data());
-	std::string s;
-	std::getline(fs, s);
+	MappedFile mapped(_filename.toAscii().data());
+	return getInstance(mapped);
+}
+
+//Only the first line of the mapping is read, the loader can then parse the same mapping
+LoaderDetectionSet * LoaderDetectionSet::getInstance(const MappedFile & _file)
+{
+	if (!_file.isMapped())
+		return NULL;
+	if (BinaryLocalizationHeader::isBinaryFile(_file.begin(), _file.end()))
+		return new LoaderDetectionSetBinary();
+	std::string s(_file.begin(), LocalizationFileParser::endOfLine(_file.begin(), _file.end()));
 	QString firstLine(s.c_str());
 	QString separator;
 	if (firstLine.contains('\t'))
@@ -59,29 +79,48 @@ LoaderDetectionSet * LoaderDetectionSet::getInstance(const QString & _filename)
 		separator = ' ';
 	if (separator.isEmpty())
 		return NULL;
-	if (_filename.endsWith(".txt")){
-		QStringList words = firstLine.split(separator);
-		unsigned int nbWords = 0;
-		for (unsigned int n = 0; n < words.size(); n++)
-			if (!words.at(n).isEmpty())
-				nbWords++;
+	if (QString(_file.filename().c_str()).endsWith(".txt")){
 		if (firstLine.startsWith("Width")){
-			bool palTracer2Dataset = firstLine.contains("Spectral");
-			fs.close();
-			if (palTracer2Dataset)
+			if (firstLine.contains("Spectral"))
 				return new LoaderDetectionSetPalmTracer2(separator);
 		}
-		else if (firstLine.startsWith("2D")){
-			fs.close();
+		else if (firstLine.startsWith("2D"))
 			return new LoaderDetectionSetPALMTracer(separator);
-		}
-		fs.close();
-		return NULL;
 	}
-	fs.close();
 	return NULL;
 }
 
+//Layout of the text files, for the formats with a dedicated loader first and then for the ones handled by DetectionSet
+bool LoaderDetectionSet::describeTextFile(const MappedFile & _file, LocalizationTextLayout & _layout)
+{
+	if (!_file.isMapped() || BinaryLocalizationHeader::isBinaryFile(_file.begin(), _file.end()))
+		return false;
+	LoaderDetectionSet * loader = getInstance(_file);
+	if (loader == NULL)
+		return DetectionSet::describeTextFile(_file, _layout);
+	bool described = loader->describeFile(_file, _layout);
+	delete loader;
+	return described;
+}
+
+LoaderDetectionSetBinary::LoaderDetectionSetBinary() :LoaderDetectionSet(QString())
+{
+}
+
+LoaderDetectionSetBinary::~LoaderDetectionSetBinary()
+{
+}
+
+DetectionSet * LoaderDetectionSetBinary::loadFile(const MappedFile & _file)
+{
+	DetectionSet * dset = new DetectionSet();
+	if (!dset->createFile(_file)){
+		delete dset;
+		return NULL;
+	}
+	return dset;
+}
+
 LoaderDetectionSetPALMTracer::LoaderDetectionSetPALMTracer(const QString & _separator) :LoaderDetectionSet(_separator)
 {
 }
@@ -91,72 +130,63 @@ LoaderDetectionSetPALMTracer::~LoaderDetectionSetPALMTracer()
 
 }
 
-DetectionSet * LoaderDetectionSetPALMTracer::loadFile( const QString & _filename )
+//Detection lines are: index, mean, surface, intensity, perimeter, morpho, maxX, intensityGauss, chi2, y, x, z, binaryY, sigmaX, sigmaY, angleRad, angleDeg
+class PALMTracerLineParser : public LocalizationLineParser{
+public:
+	bool parse(const char * _begin, const char * _end, double * _values) const
+	{
+		static const int slots[11] = { -1, -1, -1, 0, -1, -1, -1, 1, -1, 2, 3 };
+		double tmp[4];
+		if (LocalizationFileParser::parseLine(_begin, _end, ' ', slots, 11, tmp) < 11)
+			return false;
+		//in order to avoid that the correction gives coordinates < 0 or > w | h
+		_values[LocalizationFileParser::ColumnX] = tmp[3] + 2.;
+		_values[LocalizationFileParser::ColumnY] = tmp[2] + 2.;
+		_values[LocalizationFileParser::ColumnIntensity] = (unsigned int)((tmp[1] > 0.) ? tmp[1] : tmp[0]);
+		return true;
+	}
+	bool hasSigma() const { return false; }
+};
+
+DetectionSet * LoaderDetectionSetPALMTracer::loadFile( const MappedFile & _file )
 {
-	std::vector < DetectionPoint > points;
-	std::vector < double > xs, ys;
-	std::vector <unsigned int> intensities;
-	std::vector < unsigned short > times;
-	int nbPoints = 0, nbSlices = 0;
+	LocalizationTextLayout layout;
+	if( !describeFile( _file, layout ) )
+		return NULL;
+	LocalizationFileParser::parseChunks( layout.m_chunks, layout.getParser() );
+	DetectionSet * dset = new DetectionSet( layout.m_chunks, layout.m_nbSlices, false );
+	return dset;
+}
 
-	std::ifstream fs;
-	fs.open( _filename.toAscii().data() );
+bool LoaderDetectionSetPALMTracer::describeFile( const MappedFile & _file, LocalizationTextLayout & _layout )
+{
+	int nbSlices = 0;
+	const char * ptr = _file.begin(), * end = _file.end();
 
-	double index2, mean, surface, perimetrer, morpho, maxX, maxY, chi2, y, x, z, binaryY, sigmaX, sigmaY, angleRad, AngleDeg, intensityGauss, intensity;
-	std::string s;
-	std::getline( fs,s );
+	std::string s( ptr, LocalizationFileParser::endOfLine( ptr, end ) );
 	std::istringstream is( s );
 	std::string tmp;
 	for( int i = 0; i < 4; i++ ){
 		is >> tmp;
 	}
 	is >> nbSlices;
-
-	double xmin = DBL_MAX, xmax = DBL_MIN, ymin = DBL_MAX, ymax = DBL_MIN;
-
-	for(int n = 0; n < nbSlices; n++){
-		std::getline(fs,s);
-		std::istringstream is2(s);
-		std::string tmp;
-		for(int i = 0; i < 11; i++){
-			is2 >> tmp;
-		}
-		double nbDetec;
-		is2 >> nbDetec;
-
-		std::getline( fs, s );
-		for(int j = 0; j < nbDetec; j++){
-			std::getline( fs, s );
-			std::istringstream is3( s );
-			is3 >> index2 >> mean >> surface >> intensity >> perimetrer >> morpho >> maxX >> intensityGauss >> chi2 >> y >> x >> z >> binaryY >> sigmaX >> sigmaY >> angleRad >> AngleDeg;
-
-			//if( chi2 > 0.7 )
-			{
-				//in order to avoid that the correction gives coordinates < 0 or > w | h
-				x += 2.;
-				y += 2.;
-
-				if( x < xmin ) xmin = x;
-				if( x > xmax ) xmax = x;
-				if( y < ymin ) ymin = y;
-				if( y > ymax ) ymax = y;
-
-				points.push_back( DetectionPoint( x, y, /*( z + 1.75 ) * 10000. )*/z ) );
-				xs.push_back(x);
-				ys.push_back(y);
-				if( intensityGauss > 0. ){
-					intensities.push_back( (unsigned int)intensityGauss );
-				}
-				else
-					intensities.push_back((unsigned int)intensity);
-				times.push_back( (unsigned short)n );
-				nbPoints++;
-			}
-		}
+	ptr = LocalizationFileParser::nextLine( ptr, end );
+
+	//The blocks of detections of each slice are located, they are parsed afterward in parallel
+	int slots[12] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0 };
+	for( int n = 0; n < nbSlices && ptr < end; n++ ){
+		double nbDetec = 0.;
+		LocalizationFileParser::parseLine( ptr, LocalizationFileParser::endOfLine( ptr, end ), ' ', slots, 12, &nbDetec );
+		ptr = LocalizationFileParser::nextLine( LocalizationFileParser::nextLine( ptr, end ), end );
+		const char * beginSlice = ptr;
+		for( int j = 0; j < nbDetec && ptr < end; j++ )
+			ptr = LocalizationFileParser::nextLine( ptr, end );
+		if( ptr > beginSlice )
+			_layout.m_chunks.push_back( LocalizationChunk( beginSlice, ptr, n ) );
 	}
-	fs.close();
-	DetectionSet * dset = new DetectionSet( xs, ys, times, intensities, nbSlices, xs.size() );
-	return dset;
+	_layout.m_nbSlices = nbSlices;
+	_layout.setParser( new PALMTracerLineParser() );
+	return true;
 }
 
 LoaderDetectionSetPalmTracer2::LoaderDetectionSetPalmTracer2(const QString & _separator) :LoaderDetectionSet(_separator)
@@ -169,67 +199,39 @@ LoaderDetectionSetPalmTracer2::~LoaderDetectionSetPalmTracer2()
 
 }
 
-DetectionSet * LoaderDetectionSetPalmTracer2::loadFile(const QString & _filename)
+DetectionSet * LoaderDetectionSetPalmTracer2::loadFile(const MappedFile & _file)
+{
+	LocalizationTextLayout layout;
+	if (!describeFile(_file, layout))
+		return NULL;
+	LocalizationFileParser::parseChunks(layout.m_chunks, layout.getParser());
+	DetectionSet * dset = new DetectionSet(layout.m_chunks, layout.m_nbSlices, false);
+	return dset;
+}
+
+bool LoaderDetectionSetPalmTracer2::describeFile(const MappedFile & _file, LocalizationTextLayout & _layout)
 {
-	std::vector < double > xs, ys;
-	std::vector < unsigned int > intensities;
-	std::vector < unsigned short > times;
 	int w, h, nbPoints = 0, nbSlices = 0;
 	double calXY, calTime;
-	unsigned int currentLine = 0;
 
-	std::ifstream fs;
-	fs.open(_filename.toAscii().data());
+	const char * ptr = LocalizationFileParser::nextLine(_file.begin(), _file.end()), * end = _file.end();
 
-	std::string s;
-	std::getline(fs, s);
-	std::getline(fs, s);
+	std::string s(ptr, LocalizationFileParser::endOfLine(ptr, end));
 	std::istringstream is(s);
 	is >> w >> h >> nbSlices >> nbPoints >> calXY >> calTime;
-
-	std::getline(fs, s);
-	double plane, index, x, y, z, mse, sigmaX, sigmaY, id, channel, integratedInt, angle, mseZ, pairD;
-
-	double xmin = DBL_MAX, xmax = -DBL_MAX, ymin = DBL_MAX, ymax = -DBL_MAX, zmin = DBL_MAX, zmax = -DBL_MAX;
-
-	currentLine += 3;
-	int n = 0;
-	//for (int n = 0; n < nbPoints; n++){
-	while (std::getline(fs, s) && n < nbPoints){
-		//std::getline(fs, s);
-		std::istringstream is2(s);
-
-		is2 >> id >> plane >> index >> channel >> integratedInt >> x >> y >> sigmaX >> sigmaY >> angle >> mse >> z >> mseZ >> pairD;
-		z *= 1000.;
-		z /= 160;
-		if (x < xmin) xmin = x;
-		if (x > xmax) xmax = x;
-		if (y < ymin) ymin = y;
-		if (y > ymax) ymax = y;
-		if (z < zmin) zmin = z;
-		if (z > zmax) zmax = z;
-
-		xs.push_back(x);
-		ys.push_back(y);
-		if (integratedInt > 0.){
-			intensities.push_back(integratedInt);
-		}
-		else
-			intensities.push_back(integratedInt);
-		times.push_back((unsigned short)(plane - 1));
-		n++;
-	}
-	xs.resize(n);
-	xs.shrink_to_fit();
-	ys.resize(n);
-	ys.shrink_to_fit();
-	intensities.resize(n);
-	intensities.shrink_to_fit();
-	times.resize(n);
-	times.shrink_to_fit();
-
-	fs.close();
-
-	DetectionSet * dset = new DetectionSet(xs, ys, times, intensities, nbSlices, xs.size());
-	return dset;
-}
\ No newline at end of file
+	ptr = LocalizationFileParser::nextLine(LocalizationFileParser::nextLine(ptr, end), end);
+
+	//Lines are: id, plane, index, channel, integratedInt, x, y, sigmaX, sigmaY, angle, mse, z, mseZ, pairD
+	int indexes[LocalizationFileParser::NB_COLUMNS];
+	indexes[LocalizationFileParser::ColumnX] = 5;
+	indexes[LocalizationFileParser::ColumnY] = 6;
+	indexes[LocalizationFileParser::ColumnIntensity] = 4;
+	indexes[LocalizationFileParser::ColumnFrame] = 1;
+	indexes[LocalizationFileParser::ColumnSigma] = -1;
+	_layout.setParser(new ColumnLineParser(' ', indexes, -1));
+	_layout.m_nbSlices = nbSlices;
+
+	//Only the nbPoints lines announced by the header are localizations
+	LocalizationFileParser::splitInChunks(ptr, LocalizationFileParser::skipLines(ptr, end, nbPoints), _layout.m_chunks);
+	return true;
+}
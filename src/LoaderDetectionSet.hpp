@@ -35,15 +35,21 @@
 #include <QString>
 
 #include "DetectionSet.hpp"
+#include "LocalizationFileParser.hpp"
 
 class LoaderDetectionSet{
 public:
 	virtual ~LoaderDetectionSet(){}
 
-	virtual DetectionSet * loadFile(const QString &) = 0;
+	DetectionSet * loadFile(const QString &);
+	virtual DetectionSet * loadFile(const MappedFile &) = 0;
+	//Locates the localizations of a text file without parsing them, false for the formats that cannot be described
+	virtual bool describeFile(const MappedFile &, LocalizationTextLayout &) { return false; }
 
 	static DetectionSet * generateDetectionSetFromVector(const std::vector < DetectionSet * > &);
 	static LoaderDetectionSet * getInstance(const QString &);
+	static LoaderDetectionSet * getInstance(const MappedFile &);
+	static bool describeTextFile(const MappedFile &, LocalizationTextLayout &);
 
 protected:
 	LoaderDetectionSet(const QString & _separator) :m_separator(_separator){}
@@ -52,12 +58,23 @@ protected:
 	QString m_separator;
 };
 
+class LoaderDetectionSetBinary : public LoaderDetectionSet{
+public:
+	LoaderDetectionSetBinary();
+	~LoaderDetectionSetBinary();
+
+	using LoaderDetectionSet::loadFile;
+	DetectionSet * loadFile(const MappedFile &);
+};
+
 class LoaderDetectionSetPALMTracer : public LoaderDetectionSet{
 public:
 	LoaderDetectionSetPALMTracer(const QString &);
 	~LoaderDetectionSetPALMTracer();
 
-	DetectionSet * loadFile( const QString & );
+	using LoaderDetectionSet::loadFile;
+	DetectionSet * loadFile( const MappedFile & );
+	bool describeFile( const MappedFile &, LocalizationTextLayout & );
 };
 
 class LoaderDetectionSetPalmTracer2 : public LoaderDetectionSet{
@@ -65,7 +82,9 @@ public:
 	LoaderDetectionSetPalmTracer2(const QString &);
 	~LoaderDetectionSetPalmTracer2();
 
-	DetectionSet * loadFile(const QString &);
+	using LoaderDetectionSet::loadFile;
+	DetectionSet * loadFile(const MappedFile &);
+	bool describeFile(const MappedFile &, LocalizationTextLayout &);
 };
 
 #endif // LoaderDetectionSet_h__
\ No newline at end of file
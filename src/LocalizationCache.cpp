@@ -0,0 +1,261 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      LocalizationCache.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDesktopServices>
+
+#include "LocalizationCache.hpp"
+#include "LocalizationFileParser.hpp"
+#include "DetectionSet.hpp"
+#include "LoaderDetectionSet.hpp"
+#include "DetectionSetStream.hpp"
+
+QString LocalizationCache::m_directory;
+bool LocalizationCache::m_directoryInitialized = false;
+bool LocalizationCache::m_enabled = true;
+
+static unsigned long long fnv1a( const char * _data, const qint64 _size, unsigned long long _hash = 14695981039346656037ULL )
+{
+	for( qint64 n = 0; n < _size; n++ ){
+		_hash ^= ( unsigned char )_data[n];
+		_hash *= 1099511628211ULL;
+	}
+	return _hash;
+}
+
+//Parses the file, or reloads its columns from the cache when the source has not changed since the last parsing
+//The source is mapped once, for its fingerprint, the detection of its format and its parsing
+DetectionSet * LocalizationCache::openDetectionSet( const QString & _filename )
+{
+	MappedFile mapped( _filename.toAscii().data() );
+	DetectionSet * detections = NULL;
+	bool cacheable = m_enabled && mapped.isMapped() && !BinaryLocalizationHeader::isBinaryFile( mapped.begin(), mapped.end() );
+	QString cacheName;
+	if( cacheable ){
+		cacheName = cacheFilename( _filename, mapped );
+		detections = loadEntry( cacheName, _filename );
+		if( detections != NULL )
+			return detections;
+	}
+
+	//Formats with a dedicated loader (PALMTracer) are recognized first, the others are handled by DetectionSet
+	LoaderDetectionSet * loader = LoaderDetectionSet::getInstance( mapped );
+	if( loader != NULL ){
+		detections = loader->loadFile( mapped );
+		delete loader;
+		if( detections == NULL )
+			return NULL;
+		QFileInfo info( _filename );
+		detections->setDir( ( info.absolutePath() + "/" ).toAscii().data() );
+		detections->setName( info.fileName().toAscii().data() );
+	}
+	else{
+		detections = new DetectionSet();
+		if( !detections->createFile( mapped ) ){
+			delete detections;
+			return NULL;
+		}
+	}
+	if( cacheable )
+		storeEntry( cacheName, detections );
+	return detections;
+}
+
+DetectionSet * LocalizationCache::load( const QString & _filename )
+{
+	return loadEntry( cacheFilename( _filename ), _filename );
+}
+
+bool LocalizationCache::store( const QString & _filename, const DetectionSet * _detections )
+{
+	return storeEntry( cacheFilename( _filename ), _detections );
+}
+
+DetectionSet * LocalizationCache::loadEntry( const QString & _cacheName, const QString & _filename )
+{
+	if( _cacheName.isEmpty() || !QFileInfo( _cacheName ).exists() )
+		return NULL;
+
+	DetectionSet * detections = new DetectionSet();
+	if( !detections->createFile( _cacheName.toAscii().data() ) ){
+		std::cout << "Cache entry " << _cacheName.toAscii().data() << " is invalid, " << _filename.toAscii().data() << " will be parsed" << std::endl;
+		delete detections;
+		return NULL;
+	}
+	//The dataset keeps the location of its source file, not the one of the cache
+	QFileInfo info( _filename );
+	detections->setDir( ( info.absolutePath() + "/" ).toAscii().data() );
+	detections->setName( info.fileName().toAscii().data() );
+	std::cout << "Localizations of " << _filename.toAscii().data() << " loaded from cache " << _cacheName.toAscii().data() << std::endl;
+	return detections;
+}
+
+bool LocalizationCache::storeEntry( const QString & _cacheName, const DetectionSet * _detections )
+{
+	if( _cacheName.isEmpty() )
+		return false;
+	QDir().mkpath( QFileInfo( _cacheName ).absolutePath() );
+	//Written under a temporary name so that an interrupted write never leaves a truncated entry
+	QString tmpName = _cacheName + ".tmp";
+	if( !_detections->saveBinaryFile( tmpName.toAscii().data() ) ){
+		QFile::remove( tmpName );
+		return false;
+	}
+	QFile::remove( _cacheName );
+	if( !QFile::rename( tmpName, _cacheName ) )
+		return false;
+	removeOlderEntries( _cacheName );
+	return true;
+}
+
+//Cache entry of a text file for the streamed accesses, written by a conversion that does not build the dataset
+//Returns an empty string when the cache is disabled or the entry cannot be written
+QString LocalizationCache::entryForTextFile( const QString & _filename, const MappedFile & _file )
+{
+	if( !m_enabled )
+		return QString();
+	QString cacheName = cacheFilename( _filename, _file );
+	if( cacheName.isEmpty() || QFileInfo( cacheName ).exists() )
+		return cacheName;
+	QDir().mkpath( QFileInfo( cacheName ).absolutePath() );
+	QString tmpName = cacheName + ".tmp";
+	if( !DetectionSetStream::convertTextFile( _file, tmpName ) ){
+		QFile::remove( tmpName );
+		return QString();
+	}
+	QFile::remove( cacheName );
+	if( !QFile::rename( tmpName, cacheName ) ){
+		QFile::remove( tmpName );
+		return QString();
+	}
+	removeOlderEntries( cacheName );
+	return cacheName;
+}
+
+//Binary columnar file already holding the localizations of a source file, the source itself when it is binary or its
+//cache entry when it has been written. Nothing is parsed nor written, returns an empty string when there is none
+QString LocalizationCache::existingBinaryFile( const QString & _filename )
+{
+	MappedFile mapped( _filename.toAscii().data() );
+	if( !mapped.isMapped() )
+		return QString();
+	if( BinaryLocalizationHeader::isBinaryFile( mapped.begin(), mapped.end() ) )
+		return _filename;
+	if( !m_enabled )
+		return QString();
+	QString cacheName = cacheFilename( _filename, mapped );
+	if( cacheName.isEmpty() || !QFileInfo( cacheName ).exists() )
+		return QString();
+	return cacheName;
+}
+
+//The entries of a source file share the name prefix <basename>.<path key>, the ones written for a previous
+//version of the file are removed
+void LocalizationCache::removeOlderEntries( const QString & _cacheName )
+{
+	QFileInfo info( _cacheName );
+	QString name = info.fileName(), prefix = info.completeBaseName();
+	prefix = prefix.left( prefix.lastIndexOf( '.' ) + 1 );
+	QStringList entries = info.absoluteDir().entryList( QStringList( "*.srtb" ), QDir::Files );
+	for( int n = 0; n < entries.size(); n++ ){
+		const QString & entry = entries[n];
+		if( entry == name || !entry.startsWith( prefix ) || entry.indexOf( '.', prefix.size() ) != entry.size() - 5 ) continue;
+		if( QFile::remove( info.absolutePath() + "/" + entry ) )
+			std::cout << "Removed the outdated cache entry " << entry.toAscii().data() << std::endl;
+	}
+}
+
+QString LocalizationCache::cacheFilename( const QString & _filename )
+{
+	MappedFile mapped( _filename.toAscii().data() );
+	if( !mapped.isMapped() )
+		return QString();
+	return cacheFilename( _filename, mapped );
+}
+
+QString LocalizationCache::cacheFilename( const QString & _filename, const MappedFile & _file )
+{
+	QFileInfo info( _filename );
+	if( !info.exists() )
+		return QString();
+
+	QString path = info.absoluteFilePath();
+	QString fingerprint = path + "|" + QString::number( info.size() ) + "|" + QString::number( info.lastModified().toTime_t() );
+	QByteArray bytes = fingerprint.toUtf8();
+	unsigned long long key = fnv1a( bytes.constData(), bytes.size() );
+	key ^= contentHash( _file );
+	key *= 1099511628211ULL;
+
+	//The key of the path distinguishes the sources with the same name in the shared cache directory
+	QByteArray bytesPath = path.toUtf8();
+	unsigned long long keyPath = fnv1a( bytesPath.constData(), bytesPath.size() );
+
+	QString dir = directory().isEmpty() ? info.absolutePath() : directory();
+	return dir + "/" + info.completeBaseName() + "." + QString::number( keyPath, 16 ).rightJustified( 16, '0' ) + "." + QString::number( key, 16 ).rightJustified( 16, '0' ) + ".srtb";
+}
+
+//Hash of the beginning and of the end of the file, enough to detect a rewritten acquisition without reading it entirely
+unsigned long long LocalizationCache::contentHash( const MappedFile & _file )
+{
+	const qint64 sizeBlock = 1 << 20;
+	unsigned long long hash = fnv1a( _file.begin(), std::min( sizeBlock, _file.size() ) );
+	if( _file.size() > sizeBlock ){
+		qint64 start = std::max( sizeBlock, _file.size() - sizeBlock );
+		hash = fnv1a( _file.begin() + start, _file.size() - start, hash );
+	}
+	return hash;
+}
+
+void LocalizationCache::setDirectory( const QString & _dir )
+{
+	m_directory = _dir;
+	m_directoryInitialized = true;
+}
+
+const QString & LocalizationCache::directory()
+{
+	if( !m_directoryInitialized ){
+		m_directory = QString::fromLocal8Bit( qgetenv( "SRTESSELER_CACHE_DIR" ) );
+		//Never next to the data by default, acquisitions are often on read-only shares
+		if( m_directory.isEmpty() ){
+			QString cacheLocation = QDesktopServices::storageLocation( QDesktopServices::CacheLocation );
+			if( !cacheLocation.isEmpty() )
+				m_directory = cacheLocation + "/localizations";
+		}
+		m_directoryInitialized = true;
+	}
+	return m_directory;
+}
@@ -0,0 +1,72 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      LocalizationCache.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef LocalizationCache_h__
+#define LocalizationCache_h__
+
+#include <QString>
+
+class DetectionSet;
+class MappedFile;
+
+//On-disk cache of the parsed localization files, stored with the binary columnar format (.srtb)
+//An entry is keyed by the path, the size, the last modification time and a hash of the content of the source file
+//Entries are written in the user cache location, or in the directory given by setDirectory (or the SRTESSELER_CACHE_DIR variable)
+//Only the last entry of a source file is kept
+class LocalizationCache{
+public:
+	static DetectionSet * openDetectionSet( const QString & );
+
+	static DetectionSet * load( const QString & );
+	static bool store( const QString &, const DetectionSet * );
+	static QString cacheFilename( const QString & );
+	static QString cacheFilename( const QString &, const MappedFile & );
+	static QString entryForTextFile( const QString &, const MappedFile & );
+	static QString existingBinaryFile( const QString & );
+
+	static void setDirectory( const QString & );
+	static const QString & directory();
+	static inline void setEnabled( const bool _val ) { m_enabled = _val; }
+	static inline bool isEnabled() { return m_enabled; }
+
+protected:
+	static DetectionSet * loadEntry( const QString &, const QString & );
+	static bool storeEntry( const QString &, const DetectionSet * );
+	static void removeOlderEntries( const QString & );
+	static unsigned long long contentHash( const MappedFile & );
+
+protected:
+	static QString m_directory;
+	static bool m_directoryInitialized, m_enabled;
+};
+
+#endif // LocalizationCache_h__
@@ -0,0 +1,358 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      LocalizationFileParser.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <string.h>
+#include <float.h>
+#include <algorithm>
+#include <QThread>
+
+#include "LocalizationFileParser.hpp"
+
+MappedFile::MappedFile( const char * _filename ):m_filename( _filename ), m_file( _filename ), m_data( NULL ), m_size( 0 )
+{
+	if( !m_file.open( QIODevice::ReadOnly ) )
+		return;
+	m_size = m_file.size();
+	if( m_size > 0 )
+		m_data = m_file.map( 0, m_size );
+	if( m_data == NULL )
+		m_size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	if( m_data != NULL )
+		m_file.unmap( m_data );
+	m_file.close();
+}
+
+const char BinaryLocalizationHeader::MAGIC[4] = { 'S', 'R', 'T', 'B' };
+
+BinaryLocalizationHeader::BinaryLocalizationHeader():m_version( 0 ), m_flags( 0 ), m_nbPoints( 0 ), m_nbSlices( 0 ), m_w( 0.f ), m_h( 0.f ), m_intensityMin( 0.f ), m_intensityMax( 0.f ), m_reserved( 0 )
+{
+	memset( m_magic, 0, 4 );
+}
+
+BinaryLocalizationHeader::BinaryLocalizationHeader( const unsigned int _nbPoints, const unsigned int _nbSlices, const float _w, const float _h, const float _intensityMin, const float _intensityMax, const bool _hasSigma ):m_version( VERSION ), m_nbPoints( _nbPoints ), m_nbSlices( _nbSlices ), m_w( _w ), m_h( _h ), m_intensityMin( _intensityMin ), m_intensityMax( _intensityMax ), m_reserved( 0 )
+{
+	memcpy( m_magic, MAGIC, 4 );
+	m_flags = _hasSigma ? HasSigma : 0;
+}
+
+bool BinaryLocalizationHeader::isBinaryFile( const char * _begin, const char * _end )
+{
+	return _begin != NULL && _end - _begin >= ( qint64 )sizeof( BinaryLocalizationHeader ) && memcmp( _begin, MAGIC, 4 ) == 0;
+}
+
+qint64 BinaryLocalizationHeader::fileSize( const unsigned int _nbPoints, const unsigned int _nbSlices, const bool _hasSigma )
+{
+	return ( qint64 )sizeof( BinaryLocalizationHeader ) + ( qint64 )_nbPoints * ( _hasSigma ? 4 : 3 ) * sizeof( double ) + ( qint64 )_nbSlices * 2 * sizeof( unsigned int );
+}
+
+const char * LocalizationFileParser::nextLine( const char * _ptr, const char * _end )
+{
+	const char * eol = ( const char * )memchr( _ptr, '\n', _end - _ptr );
+	return ( eol == NULL ) ? _end : eol + 1;
+}
+
+//End of the line starting at _ptr, without the line feed and the carriage return
+const char * LocalizationFileParser::endOfLine( const char * _ptr, const char * _end )
+{
+	const char * eol = ( const char * )memchr( _ptr, '\n', _end - _ptr );
+	if( eol == NULL ) eol = _end;
+	if( eol > _ptr && *( eol - 1 ) == '\r' ) eol--;
+	return eol;
+}
+
+//Beginning of the line following the _nb lines starting at _ptr, _end if the file has less lines
+const char * LocalizationFileParser::skipLines( const char * _ptr, const char * _end, const unsigned int _nb )
+{
+	for( unsigned int n = 0; n < _nb && _ptr < _end; n++ )
+		_ptr = nextLine( _ptr, _end );
+	return _ptr;
+}
+
+//Beginning of the first line of _length characters (line feed and carriage return excluded), _end if there is none
+const char * LocalizationFileParser::findLineOfLength( const char * _ptr, const char * _end, const int _length )
+{
+	while( _ptr < _end ){
+		const char * eol = endOfLine( _ptr, _end );
+		if( eol - _ptr == _length )
+			return _ptr;
+		_ptr = nextLine( eol, _end );
+	}
+	return _end;
+}
+
+//Equivalent of atof on a non null-terminated field, no allocation and no locale involved
+double LocalizationFileParser::toDouble( const char * _ptr, const char * _end )
+{
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	while( _ptr < _end && ( *_ptr == ' ' || *_ptr == '"' ) ) _ptr++;
+	bool negative = false;
+	if( _ptr < _end && ( *_ptr == '-' || *_ptr == '+' ) )
+		negative = *_ptr++ == '-';
+
+	unsigned long long mantissa = 0;
+	int exponent = 0, nbDigits = 0;
+	for( ; _ptr < _end && *_ptr >= '0' && *_ptr <= '9'; _ptr++ ){
+		if( nbDigits < 19 ){
+			mantissa = mantissa * 10 + ( *_ptr - '0' );
+			if( mantissa != 0 ) nbDigits++;
+		}
+		else
+			exponent++;
+	}
+	if( _ptr < _end && *_ptr == '.' ){
+		for( _ptr++; _ptr < _end && *_ptr >= '0' && *_ptr <= '9'; _ptr++ ){
+			if( nbDigits < 19 ){
+				mantissa = mantissa * 10 + ( *_ptr - '0' );
+				exponent--;
+				if( mantissa != 0 ) nbDigits++;
+			}
+		}
+	}
+	if( _ptr < _end && ( *_ptr == 'e' || *_ptr == 'E' ) ){
+		const char * ptrExp = _ptr + 1;
+		bool negativeExp = false;
+		if( ptrExp < _end && ( *ptrExp == '-' || *ptrExp == '+' ) )
+			negativeExp = *ptrExp++ == '-';
+		if( ptrExp < _end && *ptrExp >= '0' && *ptrExp <= '9' ){
+			int valExp = 0;
+			for( ; ptrExp < _end && *ptrExp >= '0' && *ptrExp <= '9'; ptrExp++ )
+				if( valExp < 10000 ) valExp = valExp * 10 + ( *ptrExp - '0' );
+			exponent += negativeExp ? -valExp : valExp;
+		}
+	}
+
+	double value = ( double )mantissa;
+	while( exponent > 22 ){ value *= 1e22; exponent -= 22; }
+	while( exponent < -22 ){ value /= 1e22; exponent += 22; }
+	value = ( exponent < 0 ) ? value / powers[-exponent] : value * powers[exponent];
+	return negative ? -value : value;
+}
+
+//Scans one line [_begin, _end[ and converts only the columns requested by _slots (column index -> slot index or -1)
+//Empty fields are skipped, as the split function used by the stream parsers does, and spaces and tabs are
+//considered equivalent for whitespace separated files
+//Returns the number of fields met, scanning stops after the last requested column
+int LocalizationFileParser::parseLine( const char * _begin, const char * _end, const char _separator, const int * _slots, const int _nbSlots, double * _values )
+{
+	const bool whitespace = _separator == ' ' || _separator == '\t';
+	int nbFields = 0;
+	const char * ptr = _begin;
+	while( ptr < _end && nbFields < _nbSlots ){
+		while( ptr < _end && ( *ptr == _separator || ( whitespace && ( *ptr == ' ' || *ptr == '\t' ) ) ) ) ptr++;
+		if( ptr >= _end ) break;
+		const char * endField = ptr;
+		if( whitespace )
+			while( endField < _end && *endField != ' ' && *endField != '\t' ) endField++;
+		else{
+			endField = ( const char * )memchr( ptr, _separator, _end - ptr );
+			if( endField == NULL ) endField = _end;
+		}
+		if( _slots[nbFields] != -1 )
+			_values[_slots[nbFields]] = toDouble( ptr, endField );
+		nbFields++;
+		ptr = endField;
+	}
+	return nbFields;
+}
+
+//Number of lines estimated from the length of the first lines, used to size the buffers without a counting pass
+unsigned int LocalizationFileParser::estimateNbLines( const char * _begin, const char * _end )
+{
+	if( _begin >= _end ) return 0;
+	const char * ptr = _begin;
+	int nbSampled = 0;
+	for( ; nbSampled < 16 && ptr < _end; nbSampled++ )
+		ptr = nextLine( ptr, _end );
+	return ( unsigned int )( ( double )( _end - _begin ) / ( ptr - _begin ) * nbSampled ) + 1;
+}
+
+int LocalizationFileParser::nbChunksForParsing()
+{
+	//More chunks than threads so that the workers stay busy when the lines have different lengths
+	int nbThreads = QThread::idealThreadCount();
+	return ( nbThreads < 1 ) ? 1 : 4 * nbThreads;
+}
+
+//Splits [_begin, _end[ in chunks of roughly the same size, each chunk starting at the beginning of a line
+void LocalizationFileParser::splitInChunks( const char * _begin, const char * _end, std::vector < LocalizationChunk > & _chunks, const int _nbChunks )
+{
+	if( _begin >= _end ) return;
+	int nbChunks = ( _nbChunks <= 0 ) ? nbChunksForParsing() : _nbChunks;
+	splitInChunksOfSize( _begin, _end, _chunks, ( _end - _begin ) / nbChunks + 1 );
+}
+
+//Splits [_begin, _end[ in chunks of about _sizeChunk bytes, each chunk starting at the beginning of a line
+void LocalizationFileParser::splitInChunksOfSize( const char * _begin, const char * _end, std::vector < LocalizationChunk > & _chunks, const qint64 _sizeChunk, const int _frame )
+{
+	const char * ptr = _begin;
+	while( ptr < _end ){
+		const char * endChunk = ( _end - ptr > _sizeChunk ) ? nextLine( ptr + _sizeChunk, _end ) : _end;
+		_chunks.push_back( LocalizationChunk( ptr, endChunk, _frame ) );
+		ptr = endChunk;
+	}
+}
+
+void LocalizationFileParser::parseChunks( std::vector < LocalizationChunk > & _chunks, const LocalizationLineParser & _parser )
+{
+	int nbChunks = _chunks.size();
+#pragma omp parallel for schedule(dynamic)
+	for( int n = 0; n < nbChunks; n++ ){
+		LocalizationChunk & chunk = _chunks[n];
+		chunk.reserve( estimateNbLines( chunk.m_begin, chunk.m_end ), _parser.hasSigma() );
+		double values[NB_COLUMNS];
+		const char * ptr = chunk.m_begin;
+		while( ptr < chunk.m_end ){
+			const char * eol = endOfLine( ptr, chunk.m_end );
+			values[ColumnFrame] = values[ColumnSigma] = 0.;
+			if( eol > ptr && _parser.parse( ptr, eol, values ) ){
+				int frame = ( chunk.m_frame != -1 ) ? chunk.m_frame : ( int )values[ColumnFrame];
+				chunk.addLocalization( values, ( frame < 0 ) ? 0 : frame, _parser.hasSigma() );
+			}
+			ptr = nextLine( eol, chunk.m_end );
+		}
+	}
+}
+
+LocalizationChunk::LocalizationChunk( const char * _begin, const char * _end, const int _frame ):m_begin( _begin ), m_end( _end ), m_frame( _frame ), m_firstFrame( 0 ), m_maxX( 0. ), m_maxY( 0. ), m_minIntensity( FLT_MAX ), m_maxIntensity( FLT_MIN )
+{
+}
+
+void LocalizationChunk::reserve( const unsigned int _nb, const bool _hasSigma )
+{
+	m_xs.reserve( _nb );
+	m_ys.reserve( _nb );
+	m_intensities.reserve( _nb );
+	if( _hasSigma )
+		m_sigmas.reserve( _nb );
+	m_frames.reserve( _nb );
+}
+
+void LocalizationChunk::addLocalization( const double * _values, const int _frame, const bool _hasSigma )
+{
+	unsigned int frame = _frame;
+	if( m_frames.empty() ){
+		m_firstFrame = frame;
+		m_countsPerFrame.resize( 1, 0 );
+	}
+	else if( frame < m_firstFrame ){
+		m_countsPerFrame.insert( m_countsPerFrame.begin(), m_firstFrame - frame, 0 );
+		m_firstFrame = frame;
+	}
+	else if( frame - m_firstFrame >= m_countsPerFrame.size() )
+		m_countsPerFrame.resize( frame - m_firstFrame + 1, 0 );
+	m_countsPerFrame[frame - m_firstFrame]++;
+
+	double x = _values[LocalizationFileParser::ColumnX], y = _values[LocalizationFileParser::ColumnY], intensity = _values[LocalizationFileParser::ColumnIntensity];
+	m_xs.push_back( x );
+	m_ys.push_back( y );
+	m_intensities.push_back( intensity );
+	if( _hasSigma )
+		m_sigmas.push_back( _values[LocalizationFileParser::ColumnSigma] );
+	m_frames.push_back( frame );
+	if( x > m_maxX ) m_maxX = x;
+	if( y > m_maxY ) m_maxY = y;
+	if( intensity < m_minIntensity ) m_minIntensity = intensity;
+	if( intensity > m_maxIntensity ) m_maxIntensity = intensity;
+}
+
+//Intensities and sigmas of the formats without them, drawn from gaussian distributions (mean 1500 and deviation
+//400 for the intensities, mean 25 and deviation 10 for the sigmas)
+void LocalizationChunk::generateIntensitiesSigmas( std::mt19937 & _gen )
+{
+	std::normal_distribution <> dsigma( 25, 10 ), dintensity( 1500, 400 );
+	m_sigmas.resize( size() );
+	m_minIntensity = FLT_MAX;
+	m_maxIntensity = FLT_MIN;
+	for( unsigned int n = 0; n < size(); n++ ){
+		double val = dintensity( _gen );
+		while( val < 0. ) val = dintensity( _gen );
+		m_intensities[n] = val;
+		val = dsigma( _gen );
+		while( val < 0. ) val = dsigma( _gen );
+		m_sigmas[n] = val;
+		if( m_intensities[n] < m_minIntensity ) m_minIntensity = m_intensities[n];
+		if( m_intensities[n] > m_maxIntensity ) m_maxIntensity = m_intensities[n];
+	}
+}
+
+//_indexes gives the column of each LocalizationFileParser::ColumnType, -1 for the ones not in the file
+ColumnLineParser::ColumnLineParser( const char _separator, const int * _indexes, const int _frameOffset ):m_separator( _separator ), m_frameOffset( _frameOffset )
+{
+	m_nbSlots = m_nbRequired = 0;
+	for( int n = 0; n < LocalizationFileParser::NB_COLUMNS; n++ ){
+		if( _indexes[n] + 1 > m_nbSlots )
+			m_nbSlots = _indexes[n] + 1;
+		if( n != LocalizationFileParser::ColumnSigma && _indexes[n] + 1 > m_nbRequired )
+			m_nbRequired = _indexes[n] + 1;
+	}
+	m_slots = new int[m_nbSlots];
+	std::fill( m_slots, m_slots + m_nbSlots, -1 );
+	for( int n = 0; n < LocalizationFileParser::NB_COLUMNS; n++ )
+		if( _indexes[n] != -1 )
+			m_slots[_indexes[n]] = n;
+	m_hasSigma = _indexes[LocalizationFileParser::ColumnSigma] != -1;
+}
+
+ColumnLineParser::~ColumnLineParser()
+{
+	if( m_slots != NULL )
+		delete [] m_slots;
+}
+
+bool ColumnLineParser::parse( const char * _begin, const char * _end, double * _values ) const
+{
+	if( LocalizationFileParser::parseLine( _begin, _end, m_separator, m_slots, m_nbSlots, _values ) < m_nbRequired )
+		return false;
+	_values[LocalizationFileParser::ColumnFrame] += m_frameOffset;
+	return true;
+}
+
+LocalizationTextLayout::LocalizationTextLayout():m_nbSlices( 0 ), m_generateIntensitiesSigmas( false ), m_parser( NULL )
+{
+}
+
+LocalizationTextLayout::~LocalizationTextLayout()
+{
+	if( m_parser != NULL )
+		delete m_parser;
+}
+
+//The layout takes the ownership of the parser
+void LocalizationTextLayout::setParser( LocalizationLineParser * _parser )
+{
+	if( m_parser != NULL )
+		delete m_parser;
+	m_parser = _parser;
+}
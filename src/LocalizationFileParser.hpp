@@ -0,0 +1,175 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      LocalizationFileParser.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef LocalizationFileParser_h__
+#define LocalizationFileParser_h__
+
+#include <QFile>
+#include <string>
+#include <vector>
+#include <random>
+
+#include "Precision.hpp"
+
+//Read-only mapping of a whole localization file, the bytes are directly scanned by the parsers
+class MappedFile{
+public:
+	MappedFile( const char * );
+	~MappedFile();
+
+	inline bool isMapped() const { return m_data != NULL; }
+	inline const char * begin() const { return (const char *)m_data; }
+	inline const char * end() const { return (const char *)m_data + m_size; }
+	inline qint64 size() const { return m_size; }
+	inline const std::string & filename() const { return m_filename; }
+
+protected:
+	std::string m_filename;
+	QFile m_file;
+	uchar * m_data;
+	qint64 m_size;
+};
+
+//Header of the binary columnar format (.srtb). It is followed by the x, y, intensity and, if any, sigma columns
+//(nbPoints doubles each) and by the first localization and number of localizations of each frame (nbSlices unsigned int each)
+class BinaryLocalizationHeader{
+public:
+	enum { HasSigma = 1 };
+	static const unsigned int VERSION = 1;
+	static const char MAGIC[4];
+
+	BinaryLocalizationHeader();
+	BinaryLocalizationHeader( const unsigned int, const unsigned int, const float, const float, const float, const float, const bool );
+
+	static bool isBinaryFile( const char *, const char * );
+	static qint64 fileSize( const unsigned int, const unsigned int, const bool );
+
+	char m_magic[4];
+	unsigned int m_version, m_flags, m_nbPoints, m_nbSlices;
+	float m_w, m_h, m_intensityMin, m_intensityMax;
+	unsigned int m_reserved;
+};
+
+class LocalizationChunk;
+class LocalizationLineParser;
+
+class LocalizationFileParser{
+public:
+	enum ColumnType
+	{
+		ColumnX = 0,
+		ColumnY = 1,
+		ColumnIntensity = 2,
+		ColumnFrame = 3,
+		ColumnSigma = 4,
+		NB_COLUMNS = 5
+	};
+
+	static const char * nextLine( const char *, const char * );
+	static const char * endOfLine( const char *, const char * );
+	static const char * skipLines( const char *, const char *, const unsigned int );
+	static const char * findLineOfLength( const char *, const char *, const int );
+	static double toDouble( const char *, const char * );
+	static int parseLine( const char *, const char *, const char, const int *, const int, double * );
+
+	static unsigned int estimateNbLines( const char *, const char * );
+	static int nbChunksForParsing();
+	static void splitInChunks( const char *, const char *, std::vector < LocalizationChunk > &, const int = 0 );
+	static void splitInChunksOfSize( const char *, const char *, std::vector < LocalizationChunk > &, const qint64, const int = -1 );
+	static void parseChunks( std::vector < LocalizationChunk > &, const LocalizationLineParser & );
+};
+
+//Part of a file parsed by one worker, the columns are stored per chunk and merged afterward
+class LocalizationChunk{
+public:
+	LocalizationChunk( const char *, const char *, const int = -1 );
+
+	inline unsigned int size() const { return m_frames.size(); }
+	void reserve( const unsigned int, const bool );
+	void addLocalization( const double *, const int, const bool );
+	void generateIntensitiesSigmas( std::mt19937 & );
+
+	const char * m_begin, * m_end;
+	//Frame of all the localizations of the chunk when it is given by the file structure, -1 otherwise
+	int m_frame;
+	std::vector < LocReal > m_xs, m_ys, m_intensities, m_sigmas;
+	std::vector < unsigned int > m_frames;
+	//Number of localizations per frame, starting at m_firstFrame
+	std::vector < unsigned int > m_countsPerFrame, m_offsetsPerFrame;
+	unsigned int m_firstFrame;
+	double m_maxX, m_maxY, m_minIntensity, m_maxIntensity;
+};
+
+class LocalizationLineParser{
+public:
+	virtual ~LocalizationLineParser(){}
+	//Fills the values (ordered as LocalizationFileParser::ColumnType) of one line, returns false if the line has to be discarded
+	virtual bool parse( const char *, const char *, double * ) const = 0;
+	virtual bool hasSigma() const = 0;
+};
+
+//Parser for the formats with one localization per line and the columns given by their indexes
+class ColumnLineParser : public LocalizationLineParser{
+public:
+	ColumnLineParser( const char, const int *, const int = 0 );
+	~ColumnLineParser();
+
+	bool parse( const char *, const char *, double * ) const;
+	inline bool hasSigma() const { return m_hasSigma; }
+
+protected:
+	char m_separator;
+	int * m_slots, m_nbSlots, m_nbRequired, m_frameOffset;
+	bool m_hasSigma;
+};
+
+//Parts of a text file holding the localizations and the parser of their lines, determined from the header of the
+//file without parsing the localizations. The chunks are not parsed yet, they only give the ranges and the frames
+class LocalizationTextLayout{
+public:
+	LocalizationTextLayout();
+	~LocalizationTextLayout();
+
+	void setParser( LocalizationLineParser * );
+	inline const LocalizationLineParser & getParser() const { return *m_parser; }
+	inline bool hasSigma() const { return m_parser->hasSigma() || m_generateIntensitiesSigmas; }
+
+	std::vector < LocalizationChunk > m_chunks;
+	int m_nbSlices;
+	//The file has neither intensities nor sigmas, they are generated once the chunks are parsed
+	bool m_generateIntensitiesSigmas;
+
+protected:
+	LocalizationLineParser * m_parser;
+};
+
+#endif // LocalizationFileParser_h__
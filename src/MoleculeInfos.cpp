@@ -29,29 +29,64 @@
  * GNU General Public License for more details.
  */
 
+#include <algorithm>
+
 #include "MoleculeInfos.hpp"
 
-MoleculeInfos::MoleculeInfos()
+MoleculeInfos::MoleculeInfos():m_molecules( NULL ), m_nb( 0 )
+{
+}
+
+MoleculeInfos::~MoleculeInfos()
+{
+	clear();
+}
+
+void MoleculeInfos::clear()
 {
+	for( unsigned int n = 0; n < m_data.size(); n++ ){
+		delete [] m_data[n];
+		delete [] m_dataLog[n];
+	}
+	m_data.clear();
+	m_dataLog.clear();
+	if( m_molecules != NULL )
+		delete [] m_molecules;
+	m_molecules = NULL;
+	m_nb = 0;
+}
 
+void MoleculeInfos::swap( MoleculeInfos & _other )
+{
+	m_data.swap( _other.m_data );
+	m_dataLog.swap( _other.m_dataLog );
+	std::swap( m_molecules, _other.m_molecules );
+	std::swap( m_nb, _other.m_nb );
 }
 
-MoleculeInfos::MoleculeInfos( const MoleculeInfos & _o )
+//Allocates the molecules and the features of Type, the values are left uninitialized
+void MoleculeInfos::resize( const int _nb )
 {
-	m_molecule = _o.m_molecule;
-	for( int n = 0; n < MoleculeInfos::NB_DATATYPE; n++ )
-		m_data[n] = _o.m_data[n];
-	for( int n = 0; n < MoleculeInfos::NB_DATATYPE; n++ )
-		m_dataLog[n] = _o.m_dataLog[n];
+	clear();
+	m_nb = _nb;
+	m_molecules = new VertHandle[m_nb];
+	for( int n = 0; n < 3; n++ )
+		addFeature();
 }
 
-void MoleculeInfos::setNeighborsInfos( EdgeCirc * _edges, const int _nbEdges )
+int MoleculeInfos::addFeature()
 {
-	setEdges( _edges );
-	setNbEdges( _nbEdges );
+	m_data.push_back( new LocReal[m_nb] );
+	m_dataLog.push_back( new LocReal[m_nb] );
+	return ( int )m_data.size() - 1;
 }
 
-VertHandle MoleculeInfos::getNeighbor( const int _idx ) const
+//Log values are only computed once a feature column has been fully written
+void MoleculeInfos::computeLog( const int _type )
 {
-	return m_edges[_idx]->first->vertex( m_edges[_idx]->first->ccw( m_edges[_idx]->second ) );
-}
\ No newline at end of file
+	const LocReal * values = m_data[_type];
+	LocReal * logs = m_dataLog[_type];
+#pragma omp parallel for
+	for( int n = 0; n < m_nb; n++ )
+		logs[n] = MiscFunction::log10Custom( values[n] );
+}
@@ -32,39 +32,60 @@
 #ifndef MoleculeInfos_h__
 #define MoleculeInfos_h__
 
+#include <vector>
+
 #include "ObjectInterface.hpp"
+#include "Precision.hpp"
 
+//Per-molecule features of the Voronoi diagram stored by columns: one contiguous array per feature and one for its log.
+//The three first features are the ones of Type, other ones can be appended with addFeature
 class MoleculeInfos{
 public:
 	enum Type {Area = 2, MeanDistance = 1, LocalDensity = 0, Mean = 0, Median = 1, StdDev = 2, Delta = 3};
 
 	MoleculeInfos();
-	MoleculeInfos( const MoleculeInfos & );
+	~MoleculeInfos();
+
+	void resize( const int );
+	void clear();
+	void swap( MoleculeInfos & );
+	int addFeature();
+	void computeLog( const int );
+
+	inline void setData( const int _type, const int _idx, const float _val ){m_data[_type][_idx] = _val;}
+	inline double getData( const int _type, const int _idx ) const {return m_data[_type][_idx];}
+	inline double getDataLog( const int _type, const int _idx ) const {return m_dataLog[_type][_idx];}
+	inline LocReal * getColumn( const int _type ) {return m_data[_type];}
+	inline const LocReal * getColumn( const int _type ) const {return m_data[_type];}
+	inline const LocReal * getLogColumn( const int _type ) const {return m_dataLog[_type];}
+	inline void setMolecule( const int _idx, VertHandle _mol ) {m_molecules[_idx] = _mol;}
+	inline VertHandle getMolecule( const int _idx ) const {return m_molecules[_idx];}
+	inline int nbFeatures() const {return ( int )m_data.size();}
+	inline int size() const {return m_nb;}
 
-	void setNeighborsInfos( EdgeCirc *, const int );
-	VertHandle getNeighbor( const int ) const;
+protected:
+	std::vector < LocReal * > m_data, m_dataLog;
+	VertHandle * m_molecules;
+	int m_nb;
 
-	inline void setData( const int _idx, const float _val ){m_data[_idx] = _val;}
-	inline double getData( const int _idx ) const {return m_data[_idx];}
-	inline void setDataLog( const int _idx, const float _val ){m_dataLog[_idx] = _val;}
-	inline double getDataLog( const int _idx ) const {return m_dataLog[_idx];}
-	inline void setMolecule( VertHandle _mol) {m_molecule = _mol;}
-	inline VertHandle getMolecule() const {return m_molecule;}
-	inline void setEdges( EdgeCirc * _neighs ){m_edges = _neighs;}
-	inline void setNbEdges( const int _nb ){m_nbEdges = _nb;}
-	inline EdgeCirc * getEdges() const {return m_edges;}
-	inline EdgeCirc getEdge( const int _idx ) const {return m_edges[_idx];}
-	inline const int nbEdges() const {return m_nbEdges;}
+private:
+	MoleculeInfos( const MoleculeInfos & );
+	MoleculeInfos & operator=( const MoleculeInfos & );
+};
 
+//Feature of each molecule, either all of them or only the ones listed by the indexes, as read by BitMask::selectInRange
+class MoleculeDataValues{
 public:
-	static unsigned short NB_DATATYPE;
+	MoleculeDataValues( const MoleculeInfos & _infos, const unsigned int * _indexes, const int _type, const bool _log ):m_values( ( _log ) ? _infos.getLogColumn( _type ) : _infos.getColumn( _type ) ), m_indexes( _indexes ){}
+
+	inline double operator()( const size_t _idx ) const
+	{
+		return m_values[( m_indexes != NULL ) ? m_indexes[_idx] : _idx];
+	}
 
 protected:
-	double m_data[3];
-	double m_dataLog[3];
-	VertHandle m_molecule;
-	EdgeCirc * m_edges;
-	int m_nbEdges;
+	const LocReal * m_values;
+	const unsigned int * m_indexes;
 };
 
 #endif // MoleculeInfos_h__
\ No newline at end of file
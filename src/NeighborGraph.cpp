@@ -0,0 +1,86 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      NeighborGraph.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "NeighborGraph.hpp"
+#include "MoleculeInfos.hpp"
+
+NeighborGraph::NeighborGraph():m_offsets( NULL ), m_neighbors( NULL ), m_nbNodes( 0 )
+{
+}
+
+NeighborGraph::~NeighborGraph()
+{
+	clear();
+}
+
+void NeighborGraph::clear()
+{
+	if( m_offsets != NULL )
+		delete [] m_offsets;
+	if( m_neighbors != NULL )
+		delete [] m_neighbors;
+	m_offsets = m_neighbors = NULL;
+	m_nbNodes = 0;
+}
+
+//The info of each finite vertex has to be its molecule index, the infinite vertex is skipped
+void NeighborGraph::build( const Delaunay_triangulation_2 & _delau, const MoleculeInfos & _infos )
+{
+	clear();
+	m_nbNodes = _infos.size();
+	m_offsets = new int[m_nbNodes + 1];
+	m_offsets[0] = 0;
+#pragma omp parallel for schedule(dynamic, 256)
+	for( int n = 0; n < m_nbNodes; n++ ){
+		int nb = 0;
+		Delaunay_triangulation_2::Vertex_circulator first = _delau.incident_vertices( _infos.getMolecule( n ) ), current = first;
+		do{
+			if( !_delau.is_infinite( current ) )
+				nb++;
+			current++;
+		}while( current != first );
+		m_offsets[n + 1] = nb;
+	}
+	for( int n = 0; n < m_nbNodes; n++ )
+		m_offsets[n + 1] += m_offsets[n];
+
+	m_neighbors = new int[m_offsets[m_nbNodes]];
+#pragma omp parallel for schedule(dynamic, 256)
+	for( int n = 0; n < m_nbNodes; n++ ){
+		int * ptr = m_neighbors + m_offsets[n];
+		Delaunay_triangulation_2::Vertex_circulator first = _delau.incident_vertices( _infos.getMolecule( n ) ), current = first;
+		do{
+			if( !_delau.is_infinite( current ) )
+				*ptr++ = current->info();
+			current++;
+		}while( current != first );
+	}
+}
@@ -0,0 +1,62 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      NeighborGraph.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef NeighborGraph_h__
+#define NeighborGraph_h__
+
+#include "ObjectInterface.hpp"
+
+class MoleculeInfos;
+
+//Delaunay neighbors of the molecules in compressed sparse row form: the neighbors of molecule i
+//are m_neighbors[m_offsets[i]] to m_neighbors[m_offsets[i + 1] - 1], given by their molecule index
+class NeighborGraph{
+public:
+	NeighborGraph();
+	~NeighborGraph();
+
+	void build( const Delaunay_triangulation_2 &, const MoleculeInfos & );
+	void clear();
+
+	inline int nbNodes() const { return m_nbNodes; }
+	inline int nbEdges() const { return ( m_offsets != NULL ) ? m_offsets[m_nbNodes] : 0; }
+	inline int nbNeighbors( const int _idx ) const { return m_offsets[_idx + 1] - m_offsets[_idx]; }
+	inline const int * neighbors( const int _idx ) const { return m_neighbors + m_offsets[_idx]; }
+	inline const int * getOffsets() const { return m_offsets; }
+	inline const int * getNeighbors() const { return m_neighbors; }
+
+protected:
+	int * m_offsets, * m_neighbors;
+	int m_nbNodes;
+};
+
+#endif // NeighborGraph_h__
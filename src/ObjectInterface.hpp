@@ -54,6 +54,7 @@
 #include "Palette.hpp"
 #include "Histogram.hpp"
 #include "GeneralTools.hpp"
+#include "BitMask.hpp"
 
 typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
 typedef K::Point_2 Point_2;
@@ -112,8 +113,8 @@ public:
 
 	inline void setSelected(const bool _s) {m_selected = _s;}
 	inline bool isSelected() const {return m_selected;}
-	inline bool isDataSelected( const int index ){return m_selection[index];}
-	inline bool * getSelection() const { return m_selection; }
+	inline bool isDataSelected( const int index ){return m_selection.test( index );}
+	inline const BitMask & getSelection() const { return m_selection; }
 	inline void setPalette( Palette * _palette ){if( m_palette != NULL ) delete m_palette; m_palette = _palette;}
 	inline Palette * getPalette() const {return m_palette;}
 	inline void determineCorrectColorTime( const int _colorNb );
@@ -143,7 +144,8 @@ public:
 	virtual void forceRegenerateSelection() = 0;
 
 public:
-	bool m_selected, * m_selection;
+	bool m_selected;
+	BitMask m_selection;
 	uint m_totalNumObjects, m_nbSelection;
 	int m_mode, m_nbFiles, m_nbHisto, m_typeHistogram;
 	std::string m_colorTime;
@@ -158,11 +160,10 @@ ObjectInterface::ObjectInterface():m_selected( true ), m_totalNumObjects( 0 ), m
 	m_typeHistogram = ObjectInterface::IntensityHistogram;
 	m_histograms = NULL;
 	m_palette = NULL;
-	m_selection = NULL;
 	m_stats = NULL;
 }
 
-ObjectInterface::ObjectInterface( const ObjectInterface & _o ):m_selected(_o.m_selected), m_totalNumObjects(_o.m_totalNumObjects), m_nbSelection(_o.m_nbSelection), m_mode(_o.m_mode), m_colorTime(_o.m_colorTime), m_nbFiles(_o.m_nbFiles), m_nbHisto(_o.m_nbHisto), m_typeHistogram(_o.m_typeHistogram)
+ObjectInterface::ObjectInterface( const ObjectInterface & _o ):m_selected(_o.m_selected), m_selection(_o.m_selection), m_totalNumObjects(_o.m_totalNumObjects), m_nbSelection(_o.m_nbSelection), m_mode(_o.m_mode), m_colorTime(_o.m_colorTime), m_nbFiles(_o.m_nbFiles), m_nbHisto(_o.m_nbHisto), m_typeHistogram(_o.m_typeHistogram)
 {
 	m_palette = new Palette( *(_o.m_palette) );
 	m_histograms = new Histogram*[m_nbHisto];
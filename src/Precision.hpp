@@ -0,0 +1,101 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      Precision.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef Precision_h__
+#define Precision_h__
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+//Storage precision of the localizations (coordinates, intensities, sigmas) and of the per-molecule features.
+//Float is enough for ~10 nm precision on a field of view below 100 um and halves the memory, double is kept for validation
+template < bool _single >
+struct StoragePrecision{
+	typedef double Real;
+};
+
+template < >
+struct StoragePrecision < true >{
+	typedef float Real;
+};
+
+#ifdef SRTESSELER_SINGLE_PRECISION
+typedef StoragePrecision < true >::Real LocReal;
+#else
+typedef StoragePrecision < false >::Real LocReal;
+#endif
+
+//Copy and write of a column between two precisions, a plain memcpy/write when both are the same
+template < typename TDst, typename TSrc >
+struct ColumnConverter{
+	static void copy( TDst * _dst, const TSrc * _src, const size_t _nb )
+	{
+		std::copy( _src, _src + _nb, _dst );
+	}
+	static void write( std::ostream & _os, const TSrc * _src, const size_t _nb )
+	{
+		const size_t BLOCK = 4096;
+		TDst buffer[BLOCK];
+		for( size_t n = 0; n < _nb; n += BLOCK ){
+			size_t nb = std::min( BLOCK, _nb - n );
+			std::copy( _src + n, _src + n + nb, buffer );
+			_os.write( ( const char * )buffer, nb * sizeof( TDst ) );
+		}
+	}
+};
+
+template < typename T >
+struct ColumnConverter < T, T >{
+	static void copy( T * _dst, const T * _src, const size_t _nb )
+	{
+		memcpy( _dst, _src, _nb * sizeof( T ) );
+	}
+	static void write( std::ostream & _os, const T * _src, const size_t _nb )
+	{
+		_os.write( ( const char * )_src, _nb * sizeof( T ) );
+	}
+};
+
+template < typename TDst, typename TSrc >
+inline void copyColumn( TDst * _dst, const TSrc * _src, const size_t _nb )
+{
+	ColumnConverter < TDst, TSrc >::copy( _dst, _src, _nb );
+}
+
+template < typename TDst, typename TSrc >
+inline void writeColumn( std::ostream & _os, const TSrc * _src, const size_t _nb )
+{
+	ColumnConverter < TDst, TSrc >::write( _os, _src, _nb );
+}
+
+#endif // Precision_h__
@@ -30,6 +30,7 @@
  */
 
 #include <fstream>
+#include <set>
 #include <QFileDialog>
 #include <QColorDialog>
 
@@ -142,6 +143,16 @@ void SuperResObject::addNeuronObjects( const NeuronObjectList & _objects )
 	m_voronoiObjects.insert( m_voronoiObjects.end(), _objects.begin(), _objects.end() );
 }
 
+//The current objects that are not part of the new ones are deleted
+void SuperResObject::replaceNeuronObjects( const NeuronObjectList & _objects )
+{
+	std::set < NeuronObject * > kept( _objects.begin(), _objects.end() );
+	for( NeuronObjectList::iterator it = m_voronoiObjects.begin(); it != m_voronoiObjects.end(); it++ )
+		if( kept.find( *it ) == kept.end() )
+			delete *it;
+	m_voronoiObjects = _objects;
+}
+
 const std::string & SuperResObject::getDir() const
 {
 	return m_dir;
@@ -217,9 +228,9 @@ void SuperResObject::exportIDLocalizations(const bool _inClusters) const
 		}
 	}
 
-	MoleculeInfos * infos = m_voronoiDiagram->getMoleculeInfos();
+	const MoleculeInfos * infos = m_voronoiDiagram->getMoleculeInfos();
 	for (unsigned int n = 0; n < m_voronoiDiagram->nbMolecules(); n++)
-		fs << n << "\t" << ids[n] << "\t" << infos[n].getMolecule()->point().x() << "\t" << infos[n].getMolecule()->point().y() << std::endl;
+		fs << n << "\t" << ids[n] << "\t" << infos->getMolecule( n )->point().x() << "\t" << infos->getMolecule( n )->point().y() << std::endl;
 
 	delete[] ids;
 	fs.close();
@@ -244,7 +255,7 @@ void SuperResObject::setDetectionCleaner( DetectionCleaner * _dcleaner )
 
 void SuperResObject::setVoronoiDiagram( WrapperVoronoiDiagram * _wrapper )
 {
-	if( m_voronoiDiagram != NULL )
+	if( m_voronoiDiagram != NULL && m_voronoiDiagram != _wrapper )
 		delete m_voronoiDiagram;
 	for( unsigned int n = 0; n < m_voronoiObjects.size(); n++ )
 		delete m_voronoiObjects[n];
@@ -57,6 +57,7 @@ public:
 
 	const std::string & getDir() const;
 	void addNeuronObjects( const NeuronObjectList & );
+	void replaceNeuronObjects( const NeuronObjectList & );
 	void exportStats( const double = -1., const int = -1 ) const;
 	void addPointToRoi( const double, const double );
 	bool addRoiToList();
@@ -0,0 +1,271 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      TiledDelaunay.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <QThread>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <map>
+#include <iostream>
+
+#include "TiledDelaunay.hpp"
+#include "GeneralTools.hpp"
+
+bool TiledDelaunay::m_enabled = true;
+
+//Regular grid over the bounding box of the points, with the points binned per tile
+class TileGrid{
+public:
+	TileGrid( const std::vector < std::pair < Point_2, int > > &, const int );
+
+	inline int tileX( const double _x ) const { return std::max( 0, std::min( m_nbX - 1, ( int )( ( _x - m_minX ) / m_tileW ) ) ); }
+	inline int tileY( const double _y ) const { return std::max( 0, std::min( m_nbY - 1, ( int )( ( _y - m_minY ) / m_tileH ) ) ); }
+
+	double m_minX, m_minY, m_maxX, m_maxY, m_tileW, m_tileH, m_spacing;
+	int m_nbX, m_nbY;
+	std::vector < unsigned int > m_firsts, m_indexes;
+};
+
+TileGrid::TileGrid( const std::vector < std::pair < Point_2, int > > & _points, const int _nbTiles )
+{
+	m_minX = m_minY = DBL_MAX;
+	m_maxX = m_maxY = -DBL_MAX;
+	for( size_t n = 0; n < _points.size(); n++ ){
+		const Point_2 & p = _points[n].first;
+		m_minX = std::min( m_minX, p.x() );
+		m_minY = std::min( m_minY, p.y() );
+		m_maxX = std::max( m_maxX, p.x() );
+		m_maxY = std::max( m_maxY, p.y() );
+	}
+	double w = std::max( m_maxX - m_minX, DBL_MIN ), h = std::max( m_maxY - m_minY, DBL_MIN );
+	m_spacing = sqrt( ( w * h ) / ( double )_points.size() );
+	m_nbX = std::max( 1, ( int )floor( sqrt( _nbTiles * w / h ) + 0.5 ) );
+	m_nbY = std::max( 1, ( int )ceil( ( double )_nbTiles / ( double )m_nbX ) );
+	m_tileW = w / m_nbX;
+	m_tileH = h / m_nbY;
+
+	int nbTiles = m_nbX * m_nbY;
+	std::vector < unsigned int > tiles( _points.size() );
+	m_firsts.assign( nbTiles + 1, 0 );
+	for( size_t n = 0; n < _points.size(); n++ ){
+		tiles[n] = tileY( _points[n].first.y() ) * m_nbX + tileX( _points[n].first.x() );
+		m_firsts[tiles[n] + 1]++;
+	}
+	for( int t = 0; t < nbTiles; t++ )
+		m_firsts[t + 1] += m_firsts[t];
+	std::vector < unsigned int > cursors( m_firsts.begin(), m_firsts.end() - 1 );
+	m_indexes.resize( _points.size() );
+	for( size_t n = 0; n < _points.size(); n++ )
+		m_indexes[cursors[tiles[n]]++] = n;
+}
+
+bool TiledDelaunay::build( Delaunay_triangulation_2 & _delau, const std::vector < std::pair < Point_2, int > > & _points )
+{
+	int nbThreads = QThread::idealThreadCount();
+	if( !m_enabled || nbThreads < 2 || _points.size() < MIN_NB_POINTS ) return false;
+
+	MyTimer timer;
+	TileGrid grid( _points, TILES_PER_THREAD * nbThreads );
+	double halo = 10. * grid.m_spacing;
+	for( int attempt = 0; attempt < NB_ATTEMPTS; attempt++, halo *= 4. ){
+		std::vector < std::vector < int > > facesPerTile;
+		//Duplicated points are merged by CGAL, the tiles can't agree on which one is kept
+		if( !triangulateTiles( _points, grid, halo, facesPerTile ) ) break;
+		if( stitch( _delau, _points, facesPerTile ) ){
+			std::cout << "Tiled Delaunay construction on " << grid.m_nbX << "x" << grid.m_nbY << " tiles, time elapsed " << timer.getTimeElapsed().toAscii().data() << std::endl;
+			return true;
+		}
+		std::cout << "Tiled Delaunay construction: halo of " << halo << " is too small" << std::endl;
+	}
+	_delau.clear();
+	std::cout << "Tiled Delaunay construction failed, falling back to the serial construction" << std::endl;
+	return false;
+}
+
+bool TiledDelaunay::triangulateTiles( const std::vector < std::pair < Point_2, int > > & _points, const TileGrid & _grid, const double _halo, std::vector < std::vector < int > > & _facesPerTile )
+{
+	int nbTiles = _grid.m_nbX * _grid.m_nbY;
+	bool duplicates = false;
+	_facesPerTile.clear();
+	_facesPerTile.resize( nbTiles );
+#pragma omp parallel for schedule(dynamic)
+	for( int t = 0; t < nbTiles; t++ ){
+		int tx = t % _grid.m_nbX, ty = t / _grid.m_nbX;
+		double x0 = _grid.m_minX + tx * _grid.m_tileW, y0 = _grid.m_minY + ty * _grid.m_tileH;
+		//The cores partition the plane, the outer tiles extend to infinity
+		double coreMinX = ( tx == 0 ) ? -DBL_MAX : x0, coreMaxX = ( tx == _grid.m_nbX - 1 ) ? DBL_MAX : x0 + _grid.m_tileW;
+		double coreMinY = ( ty == 0 ) ? -DBL_MAX : y0, coreMaxY = ( ty == _grid.m_nbY - 1 ) ? DBL_MAX : y0 + _grid.m_tileH;
+		double exMinX = x0 - _halo, exMaxX = x0 + _grid.m_tileW + _halo, exMinY = y0 - _halo, exMaxY = y0 + _grid.m_tileH + _halo;
+
+		std::vector < std::pair < Point_2, int > > local;
+		for( int ty2 = _grid.tileY( exMinY ); ty2 <= _grid.tileY( exMaxY ); ty2++ )
+			for( int tx2 = _grid.tileX( exMinX ); tx2 <= _grid.tileX( exMaxX ); tx2++ ){
+				int t2 = ty2 * _grid.m_nbX + tx2;
+				for( unsigned int n = _grid.m_firsts[t2]; n < _grid.m_firsts[t2 + 1]; n++ ){
+					const std::pair < Point_2, int > & p = _points[_grid.m_indexes[n]];
+					if( exMinX <= p.first.x() && p.first.x() <= exMaxX && exMinY <= p.first.y() && p.first.y() <= exMaxY )
+						local.push_back( p );
+				}
+			}
+
+		Delaunay_triangulation_2 delau;
+		delau.insert( local.begin(), local.end() );
+		if( delau.number_of_vertices() != local.size() ){
+#pragma omp critical
+			duplicates = true;
+			continue;
+		}
+
+		std::vector < int > & faces = _facesPerTile[t];
+		for( Delaunay_triangulation_2::Finite_faces_iterator it = delau.finite_faces_begin(); it != delau.finite_faces_end(); it++ ){
+			Point_2 c = CGAL::circumcenter( it->vertex( 0 )->point(), it->vertex( 1 )->point(), it->vertex( 2 )->point() );
+			if( c.x() < coreMinX || c.x() >= coreMaxX || c.y() < coreMinY || c.y() >= coreMaxY ) continue;
+			for( int i = 0; i < 3; i++ )
+				faces.push_back( it->vertex( i )->info() );
+		}
+	}
+	return !duplicates;
+}
+
+bool TiledDelaunay::stitch( Delaunay_triangulation_2 & _delau, const std::vector < std::pair < Point_2, int > > & _points, const std::vector < std::vector < int > > & _facesPerTile )
+{
+	_delau.clear();
+	int nbPoints = _points.size();
+	std::vector < int > faces;
+	size_t total = 0;
+	for( size_t t = 0; t < _facesPerTile.size(); t++ )
+		total += _facesPerTile[t].size();
+	faces.reserve( total );
+	for( size_t t = 0; t < _facesPerTile.size(); t++ )
+		faces.insert( faces.end(), _facesPerTile[t].begin(), _facesPerTile[t].end() );
+	int nbFaces = faces.size() / 3;
+
+	//Faces incident to each point
+	std::vector < unsigned int > firsts( nbPoints + 1, 0 ), incidents( faces.size() );
+	for( size_t n = 0; n < faces.size(); n++ )
+		firsts[faces[n] + 1]++;
+	for( int n = 0; n < nbPoints; n++ ){
+		if( firsts[n + 1] == 0 ) return false;
+		firsts[n + 1] += firsts[n];
+	}
+	std::vector < unsigned int > cursors( firsts.begin(), firsts.end() - 1 );
+	for( size_t n = 0; n < faces.size(); n++ )
+		incidents[cursors[faces[n]]++] = n / 3;
+
+	//Neighbor across each edge: the face having the same edge in the reverse orientation, -1 on the convex hull.
+	//A directed edge shared by two faces or an edge shared by more than two faces means the tiles disagreed
+	std::vector < int > neighbors( faces.size(), -1 );
+	bool valid = true;
+#pragma omp parallel for
+	for( int f = 0; f < nbFaces; f++ ){
+		for( int i = 0; i < 3; i++ ){
+			int a = faces[3 * f + ( i + 1 ) % 3], b = faces[3 * f + ( i + 2 ) % 3], nbFound = 0;
+			for( unsigned int k = firsts[a]; k < firsts[a + 1]; k++ ){
+				int g = incidents[k];
+				if( g == f ) continue;
+				for( int j = 0; j < 3; j++ ){
+					int a2 = faces[3 * g + ( j + 1 ) % 3], b2 = faces[3 * g + ( j + 2 ) % 3];
+					if( a2 == b && b2 == a ){
+						neighbors[3 * f + i] = g;
+						nbFound++;
+					}
+					else if( a2 == a && b2 == b )
+						nbFound = 2;
+				}
+			}
+			if( nbFound > 1 ){
+#pragma omp critical
+				valid = false;
+			}
+		}
+	}
+	if( !valid ) return false;
+
+	Tds & tds = _delau.tds();
+	std::vector < VertHandle > vertices( nbPoints );
+	for( int n = 0; n < nbPoints; n++ ){
+		vertices[n] = tds.create_vertex();
+		vertices[n]->set_point( _points[n].first );
+		vertices[n]->info() = _points[n].second;
+	}
+	std::vector < FaceHandle > handles( nbFaces );
+	for( int f = 0; f < nbFaces; f++ ){
+		handles[f] = tds.create_face( vertices[faces[3 * f]], vertices[faces[3 * f + 1]], vertices[faces[3 * f + 2]] );
+		handles[f]->info() = -1;
+		for( int i = 0; i < 3; i++ )
+			vertices[faces[3 * f + i]]->set_face( handles[f] );
+	}
+
+	//Infinite faces (b, a, infinite) closing the hull edges a->b, indexed by b
+	VertHandle infinite = _delau.infinite_vertex();
+	std::map < int, std::pair < FaceHandle, int > > hull;
+	for( int f = 0; f < nbFaces && valid; f++ ){
+		for( int i = 0; i < 3; i++ ){
+			if( neighbors[3 * f + i] >= 0 ){
+				handles[f]->set_neighbor( i, handles[neighbors[3 * f + i]] );
+				continue;
+			}
+			int a = faces[3 * f + ( i + 1 ) % 3], b = faces[3 * f + ( i + 2 ) % 3];
+			FaceHandle g = tds.create_face( vertices[b], vertices[a], infinite );
+			g->info() = -1;
+			g->set_neighbor( 2, handles[f] );
+			handles[f]->set_neighbor( i, g );
+			valid = hull.insert( std::make_pair( b, std::make_pair( g, a ) ) ).second;
+		}
+	}
+	valid = valid && hull.size() >= 3;
+	for( std::map < int, std::pair < FaceHandle, int > >::iterator it = hull.begin(); it != hull.end() && valid; it++ ){
+		std::map < int, std::pair < FaceHandle, int > >::iterator next = hull.find( it->second.second );
+		valid = ( next != hull.end() );
+		if( valid ){
+			it->second.first->set_neighbor( 0, next->second.first );
+			next->second.first->set_neighbor( 1, it->second.first );
+		}
+	}
+	if( valid ){
+		//The hull has to be a single cycle, a hole in the stitching creates a second one
+		FaceHandle first = hull.begin()->second.first, current = first;
+		size_t nb = 0;
+		do{
+			current = current->neighbor( 0 );
+			nb++;
+		}while( current != first && nb <= hull.size() );
+		valid = ( nb == hull.size() );
+	}
+	if( valid ){
+		infinite->set_face( hull.begin()->second.first );
+		tds.set_dimension( 2 );
+		valid = _delau.is_valid();
+	}
+	if( !valid )
+		_delau.clear();
+	return valid;
+}
@@ -0,0 +1,63 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      TiledDelaunay.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef TiledDelaunay_h__
+#define TiledDelaunay_h__
+
+#include <vector>
+
+#include "ObjectInterface.hpp"
+
+class TileGrid;
+
+//Parallel construction of a Delaunay triangulation: the field is split in tiles triangulated concurrently with a halo of
+//neighboring points, each tile keeps the triangles whose circumcenter lies in its core and these triangles are stitched
+//in the triangulation data structure. The stitched triangulation is validated and the construction is retried with a
+//larger halo if a tile missed some neighbors. The info of each point has to be its index in the vector.
+class TiledDelaunay{
+public:
+	static bool build( Delaunay_triangulation_2 &, const std::vector < std::pair < Point_2, int > > & );
+
+	static inline void setEnabled( const bool _val ) { m_enabled = _val; }
+	static inline bool isEnabled() { return m_enabled; }
+
+protected:
+	static bool triangulateTiles( const std::vector < std::pair < Point_2, int > > &, const TileGrid &, const double, std::vector < std::vector < int > > & );
+	static bool stitch( Delaunay_triangulation_2 &, const std::vector < std::pair < Point_2, int > > &, const std::vector < std::vector < int > > & );
+
+protected:
+	static const unsigned int MIN_NB_POINTS = 200000;
+	static const int TILES_PER_THREAD = 2, NB_ATTEMPTS = 3;
+	static bool m_enabled;
+};
+
+#endif // TiledDelaunay_h__
@@ -0,0 +1,125 @@
+/*
+ * Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+ *
+ * File:      VoronoiCellBuilder.cpp
+ *
+ * Copyright: Florian Levet (2010-2019)
+ *
+ * License:   GPL v3
+ * 
+ * Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+ *
+ *
+ * SR-Tesseler is a free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version, provided that this entire notice
+ * is included in all copies of any software which is or includes a copy
+ * or modification of this software and in all copies of the supporting
+ * documentation for such software.
+ *
+ * The algorithms that underlie SR-Tesseler have required considerable
+ * development. They are described in the original SR-Tesseler paper,
+ * doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a 
+ * scientific publication, please include a citation to the original paper.
+ *
+ * SR-Tesseler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+
+#include "VoronoiCellBuilder.hpp"
+
+VoronoiCellBuilder::VoronoiCellBuilder( const Delaunay_triangulation_2 & _delau, const std::vector < FaceHandle > & _faces, const double _w, const double _h ):m_delau( _delau ), m_w( _w ), m_h( _h )
+{
+	m_nbFaces = ( int )_faces.size();
+	m_circumcenters = new double[2 * m_nbFaces];
+#pragma omp parallel for
+	for( int n = 0; n < m_nbFaces; n++ ){
+		const Point_2 & a = _faces[n]->vertex( 0 )->point(), & b = _faces[n]->vertex( 1 )->point(), & c = _faces[n]->vertex( 2 )->point();
+		double bx = b.x() - a.x(), by = b.y() - a.y(), cx = c.x() - a.x(), cy = c.y() - a.y();
+		double d = 2. * ( bx * cy - by * cx ), b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+		m_circumcenters[2 * n] = a.x() + ( cy * b2 - by * c2 ) / d;
+		m_circumcenters[2 * n + 1] = a.y() + ( bx * c2 - cx * b2 ) / d;
+	}
+}
+
+VoronoiCellBuilder::~VoronoiCellBuilder()
+{
+	if( m_circumcenters != NULL )
+		delete [] m_circumcenters;
+}
+
+//The cell is the cycle of the circumcenters of the finite faces around the vertex, in counterclockwise order.
+//For a vertex of the convex hull the unbounded part is closed by the segment joining the two extreme circumcenters.
+//Returns the number of vertices written in _cell, _faces receives the face of each vertex or -1 for the vertices
+//created by the clipping. _scratch is a buffer reused between calls by the same thread
+int VoronoiCellBuilder::computeCell( VertHandle _v, Vec2mf * _cell, int * _faces, std::vector < double > & _scratch ) const
+{
+	int nbFaces = 0;
+	bool inside = true;
+	Delaunay_triangulation_2::Face_circulator first = m_delau.incident_faces( _v ), current = first;
+	do{
+		if( !m_delau.is_infinite( current ) ){
+			int index = current->info();
+			double x = m_circumcenters[2 * index], y = m_circumcenters[2 * index + 1];
+			if( ( int )_scratch.size() < 3 * ( nbFaces + 1 ) )
+				_scratch.resize( 6 * ( nbFaces + 1 ) );
+			_scratch[3 * nbFaces] = x;
+			_scratch[3 * nbFaces + 1] = y;
+			_scratch[3 * nbFaces + 2] = index;
+			inside = inside && x > 0. && x < m_w && y > 0. && y < m_h;
+			nbFaces++;
+		}
+		current++;
+	}while( current != first );
+
+	int nb = nbFaces;
+	double * in = &_scratch[0];
+	if( !inside ){
+		//Sutherland-Hodgman against the four sides of the field, ping-ponging between the two halves of the buffer
+		int capacity = nbFaces + MAX_ADDED_BY_CLIPPING;
+		if( ( int )_scratch.size() < 6 * capacity )
+			_scratch.resize( 6 * capacity );
+		in = &_scratch[0];
+		double * out = &_scratch[3 * capacity];
+		for( int side = 0; side < 4 && nb > 0; side++ ){
+			nb = clipEdge( in, nb, out, capacity, side, side < 2 ? 0. : ( side == 2 ? m_w : m_h ) );
+			std::swap( in, out );
+		}
+	}
+	for( int n = 0; n < nb; n++ ){
+		_cell[n].set( in[3 * n], in[3 * n + 1] );
+		_faces[n] = ( int )in[3 * n + 2];
+	}
+	return nb;
+}
+
+//Clips the polygon against one side of the field: 0 is x >= val, 1 is y >= val, 2 is x <= val and 3 is y <= val.
+//The cells are convex so each side adds at most one vertex, the capacity only guards against round-off
+int VoronoiCellBuilder::clipEdge( const double * _in, const int _nb, double * _out, const int _capacity, const int _side, const double _val ) const
+{
+	int axis = _side % 2, nbOut = 0;
+	double sign = _side < 2 ? 1. : -1.;
+	for( int n = 0; n < _nb; n++ ){
+		const double * cur = _in + 3 * n, * prev = _in + 3 * ( ( n + _nb - 1 ) % _nb );
+		double dCur = sign * ( cur[axis] - _val ), dPrev = sign * ( prev[axis] - _val );
+		if( ( dCur >= 0. ) != ( dPrev >= 0. ) && nbOut < _capacity ){
+			double t = dPrev / ( dPrev - dCur );
+			_out[3 * nbOut] = prev[0] + t * ( cur[0] - prev[0] );
+			_out[3 * nbOut + 1] = prev[1] + t * ( cur[1] - prev[1] );
+			_out[3 * nbOut + 2] = -1.;
+			nbOut++;
+		}
+		if( dCur >= 0. && nbOut < _capacity ){
+			_out[3 * nbOut] = cur[0];
+			_out[3 * nbOut + 1] = cur[1];
+			_out[3 * nbOut + 2] = cur[2];
+			nbOut++;
+		}
+	}
+	return nbOut;
+}
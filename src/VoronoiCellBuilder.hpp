@@ -0,0 +1,67 @@
+/*
+* Software:  SR-Tesseler (Multiscale segmentation of localization-based super-resolution microscopy data with polygons)
+*
+* File:      VoronoiCellBuilder.hpp
+*
+* Copyright: Florian Levet (2010-2019)
+*
+* License:   GPL v3
+*
+* Homepage:  http://www.iins.u-bordeaux.fr/team-sibarita-SR-Tesseler
+*
+*
+* SR-Tesseler is a free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version, provided that this entire notice
+* is included in all copies of any software which is or includes a copy
+* or modification of this software and in all copies of the supporting
+* documentation for such software.
+*
+* The algorithms that underlie SR-Tesseler have required considerable
+* development. They are described in the original SR-Tesseler paper,
+* doi:10.1038/nmeth.3579. If you use SR-Tesseler as part of work towards a
+* scientific publication, please include a citation to the original paper.
+*
+* SR-Tesseler is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+
+#ifndef VoronoiCellBuilder_h__
+#define VoronoiCellBuilder_h__
+
+#include <vector>
+
+#include "ObjectInterface.hpp"
+#include "Vec2.hpp"
+
+//Voronoi cells of a Delaunay triangulation built from a flat array of the face circumcenters, computed once per face
+//and addressed by the face info, clipped against the field rectangle with Sutherland-Hodgman.
+//The info of each finite face has to be its index in the vector given to the constructor.
+class VoronoiCellBuilder{
+public:
+	VoronoiCellBuilder( const Delaunay_triangulation_2 &, const std::vector < FaceHandle > &, const double, const double );
+	~VoronoiCellBuilder();
+
+	int computeCell( VertHandle, Vec2mf *, int *, std::vector < double > & ) const;
+
+	inline const double * getCircumcenters() const { return m_circumcenters; }
+	inline int nbFaces() const { return m_nbFaces; }
+
+	//A cell of a vertex with n incident faces has at most n + MAX_ADDED_BY_CLIPPING vertices once clipped
+	static const int MAX_ADDED_BY_CLIPPING = 4;
+
+protected:
+	int clipEdge( const double *, const int, double *, const int, const int, const double ) const;
+
+protected:
+	const Delaunay_triangulation_2 & m_delau;
+	double * m_circumcenters;
+	int m_nbFaces;
+	double m_w, m_h;
+};
+
+#endif // VoronoiCellBuilder_h__
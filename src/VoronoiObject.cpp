@@ -111,11 +111,11 @@ void VoronoiCluster::setMolecules( unsigned int * _molecules, const int _nb )
 	double nbTmp = m_nbMolecules, x = 0., y = 0.;
 	for( int n = 0; n < m_nbMolecules; n++ ){
 		int index = m_molecules[n];
-		VertHandle v = m_parent->m_infos[index].getMolecule();
+		VertHandle v = m_parent->m_infos.getMolecule( index );
 		x += ( v->point().x() / nbTmp );
 		y += ( v->point().y() / nbTmp );
-		m_data[VoronoiCluster::Area] += m_parent->m_infos[index].getData( VoronoiCluster::Area );
-		m_data[VoronoiCluster::MeanDistance] += ( m_parent->m_infos[index].getData( VoronoiCluster::MeanDistance ) / nbTmp );
+		m_data[VoronoiCluster::Area] += m_parent->m_infos.getData( VoronoiCluster::Area, index );
+		m_data[VoronoiCluster::MeanDistance] += ( m_parent->m_infos.getData( VoronoiCluster::MeanDistance, index ) / nbTmp );
 	}
 	m_data[VoronoiCluster::LocalDensity] = nbTmp / m_data[VoronoiCluster::Area];
 	m_barycenter.set( x, y );
@@ -133,7 +133,7 @@ void VoronoiCluster::fitEllipsePCA()
 	std::vector < KernelPoint > points;
 	for( int n = 0; n < m_nbMolecules; n++ ){
 		unsigned int index = m_molecules[n];
-		VertHandle v = m_parent->m_infos[index].getMolecule();
+		VertHandle v = m_parent->m_infos.getMolecule( index );
 		points.push_back( KernelPoint( v->point().x(), v->point().y() ) );
 	}
 	KernelPoint centroid = CGAL::centroid( points.begin(), points.end(), CGAL::Dimension_tag < 0 >() );
@@ -230,7 +230,7 @@ void VoronoiCluster::fitBoundingEllipse()
 	CartesianPoint * pts = new CartesianPoint[m_nbMolecules];
 	for (int n = 0; n < m_nbMolecules; n++){
 		int index = m_molecules[n];
-		VertHandle v = m_parent->m_infos[index].getMolecule();
+		VertHandle v = m_parent->m_infos.getMolecule( index );
 		pts[n] = CartesianPoint(v->point().x(), v->point().y());
 	}
 	Min_ellipse me2(pts, pts + m_nbMolecules, true);
@@ -367,8 +367,8 @@ void VoronoiClusterList::generateDisplay()
 		m_nbMolClusters += cluster->m_nbMolecules;
 		for( int n = 0; n < cluster->m_nbMolecules; n++ ){
 			int index = cluster->m_molecules[n];
-			VertHandle v = cluster->m_parent->m_infos[index].getMolecule();
-			m_nbVertForTriangles += cluster->m_parent->m_sizeVerticesTriangle[index];
+			VertHandle v = cluster->m_parent->m_infos.getMolecule( index );
+			m_nbVertForTriangles += cluster->m_parent->nbCellTriangleVertices( index );
 		}
 	}
 
@@ -383,10 +383,9 @@ void VoronoiClusterList::generateDisplay()
 		for( int n = 0; n < cluster->m_nbMolecules; n++, cptCell++ ){
 			int index = cluster->m_molecules[n];
 			m_firstVerticesTriangle[cptCell] = cptT;
-			m_sizeVerticesTriangle[cptCell] = cluster->m_parent->m_sizeVerticesTriangle[index];
-			for( int i = cluster->m_parent->m_firstVerticesTriangle[index]; i < cluster->m_parent->m_firstVerticesTriangle[index] + cluster->m_parent->m_sizeVerticesTriangle[index]; i++ ){
-				( *ptrT++ ).set( cluster->m_parent->m_trianglesCell[i].x(), cluster->m_parent->m_trianglesCell[i].y() );
-			}
+			m_sizeVerticesTriangle[cptCell] = cluster->m_parent->nbCellTriangleVertices( index );
+			cluster->m_parent->getCellTriangles( index, ptrT );
+			ptrT += m_sizeVerticesTriangle[cptCell];
 			cptT += m_sizeVerticesTriangle[cptCell];
 		}
 	}
@@ -408,7 +407,7 @@ void VoronoiClusterList::determineClusters( VoronoiCluster * _src, unsigned int
 	//Determination of the molecules selected by the threshold
 	for( int n = 0; n < _src->nbMolecules(); n++ ){
 		int index = _src->m_molecules[n];
-		double val = voronoi->m_infos[index].getData( MoleculeInfos::LocalDensity );
+		double val = voronoi->m_infos.getData( MoleculeInfos::LocalDensity, index );
 		moleculesAboveThreshold[index] = val > _threshold;
 		if( moleculesAboveThreshold[index] )
 			_molecules[nbMol++] = index;
@@ -417,8 +416,7 @@ void VoronoiClusterList::determineClusters( VoronoiCluster * _src, unsigned int
 	memset( _selectionTriangles, 0, voronoi->getNbFiniteTriangles() * sizeof( bool ) );
 	//Determination of the triangles selected with respect to the molecules
 	for( int n = 0; n < nbMol; n++ ){
-		MoleculeInfos * mi = &voronoi->m_infos[_molecules[n]];
-		VertHandle molecule = mi->getMolecule();
+		VertHandle molecule = voronoi->m_infos.getMolecule( _molecules[n] );
 		Delaunay_triangulation_2::Face_circulator firstFace = voronoi->m_delau.incident_faces( molecule );
 		Delaunay_triangulation_2::Face_circulator currentFace = firstFace;
 		do{
@@ -449,7 +447,7 @@ void VoronoiClusterList::determineClusters( VoronoiCluster * _src, unsigned int
 		//Now, we have a merging of triangles (not necessary all the selected triangles
 		for( int i = 0; i < indexQueue; i++ ){
 			FaceHandle f = allFaces[i];
-			area += Geometry::getTriangleArea( f->vertex( 0 ), f->vertex( 1 ), f->vertex( 2 ) );
+			area += voronoi->getFaceArea( f->info() );
 			int i0 = f->vertex( 0 )->info(), i1 = f->vertex( 1 )->info(), i2 = f->vertex( 2 )->info();
 			unsigned int total = 0;
 			if( !_selectionMolecules[i0] ){
@@ -525,7 +523,7 @@ void VoronoiClusterList::determineClusters(WrapperVoronoiDiagram * _voronoi, boo
 		double area = 0;
 		for( int i = 0; i < indexQueue; i++ ){
 			FaceHandle f = allFaces[i];
-			area += Geometry::getTriangleArea( f->vertex( 0 ), f->vertex( 1 ), f->vertex( 2 ) );
+			area += _voronoi->getFaceArea( f->info() );
 			i0 = f->vertex( 0 )->info();
 			i1 = f->vertex( 1 )->info();
 			i2 = f->vertex( 2 )->info();
@@ -638,9 +636,9 @@ VoronoiObject::VoronoiObject(const VoronoiObject & _o) :ObjectInterface(_o), Vor
 	memcpy( m_firstVerticesTriangle, _o.m_firstVerticesTriangle, m_nbMolecules * sizeof( int ) );
 	m_sizeVerticesTriangle = new int[m_nbMolecules];
 	memcpy( m_sizeVerticesTriangle, _o.m_sizeVerticesTriangle, m_nbMolecules * sizeof( int ) );
-	m_selection = new bool[m_nbMolecules];
-	m_stats = new ArrayStatistics[MoleculeInfos::NB_DATATYPE];
-	for( int i = 0; i < MoleculeInfos::NB_DATATYPE; i++ )
+	m_selection.resize( m_nbMolecules );
+	m_stats = new ArrayStatistics[m_parent->m_infos.nbFeatures()];
+	for( int i = 0; i < m_parent->m_infos.nbFeatures(); i++ )
 		m_stats[i] = _o.m_stats[i];
 
 	m_palette = Palette::getMonochromePalette( 80, 120, 249 );
@@ -738,19 +736,13 @@ void VoronoiObject::determineSelection( const bool _resetSelectionByUser /*= fal
 	if( _resetSelectionByUser )
 		m_histograms[m_typeHistogram]->resetBounds();
 	bool isLog = m_histograms[m_typeHistogram]->isLog();
-	for( int n = 0; n < m_nbMolecules; n++ ){
-		MoleculeInfos * m = &m_parent->m_infos[m_molecules[n]];
-		double val1 = ( isLog ) ? m->getDataLog( m_typeHistogram ) : m->getData( m_typeHistogram );
-		m_selection[n] = ( m_histograms[m_typeHistogram]->getMin() <= val1 && val1 <= m_histograms[m_typeHistogram]->getMax() );
-		if( m_selection[n] )
-			m_nbSelection++;
-	}
+	m_selection.selectInRange( MoleculeDataValues( m_parent->m_infos, m_molecules, m_typeHistogram, isLog ), m_histograms[m_typeHistogram]->getMin(), m_histograms[m_typeHistogram]->getMax() );
+	m_nbSelection = m_selection.count();
 }
 
 void VoronoiObject::resetDataSelection()
 {
-	for( uint i = 0; i < m_nbMolecules; i++ )
-		m_selection[i] = false;
+	m_selection.clearAll();
 }
 
 void VoronoiObject::regenerateIntensityColorVector()
@@ -783,12 +775,12 @@ void VoronoiObject::regenerateIntensityColorVector()
 
 double VoronoiObject::getInfosData( const int _typeHisto, const int _idx ) const
 {
-	return m_parent->m_infos[m_molecules[_idx]].getData( _typeHisto );
+	return m_parent->m_infos.getData( _typeHisto, m_molecules[_idx] );
 }
 
 double VoronoiObject::getInfosDataLog( const int _typeHisto, const int _idx ) const
 {
-	return m_parent->m_infos[m_molecules[_idx]].getDataLog( _typeHisto );
+	return m_parent->m_infos.getDataLog( _typeHisto, m_molecules[_idx] );
 
 }
 
@@ -808,9 +800,9 @@ void VoronoiObject::generateDisplay()
 	m_positionMolecules = new Vec2mf[m_nbMolecules];
 	for( int n = 0; n < m_nbMolecules; n++ ){
 		int index = m_molecules[n];
-		VertHandle v = m_parent->m_infos[index].getMolecule();
+		VertHandle v = m_parent->m_infos.getMolecule( index );
 		m_positionMolecules[n].set( v->point().x(), v->point().y() );
-		m_nbVertForTriangles += m_parent->m_sizeVerticesTriangle[index];
+		m_nbVertForTriangles += m_parent->nbCellTriangleVertices( index );
 	}
 
 	//creation of the display for the voronoi cells part of the object
@@ -822,14 +814,13 @@ void VoronoiObject::generateDisplay()
 	for( int n = 0; n < m_nbMolecules; n++ ){
 		int index = m_molecules[n];
 		m_firstVerticesTriangle[n] = cptT;
-		m_sizeVerticesTriangle[n] = m_parent->m_sizeVerticesTriangle[index];
-		for( int i = m_parent->m_firstVerticesTriangle[index]; i < m_parent->m_firstVerticesTriangle[index] + m_parent->m_sizeVerticesTriangle[index]; i++ ){
-			( *ptrT++ ).set( m_parent->m_trianglesCell[i].x(), m_parent->m_trianglesCell[i].y() );
-		}
+		m_sizeVerticesTriangle[n] = m_parent->nbCellTriangleVertices( index );
+		m_parent->getCellTriangles( index, ptrT );
+		ptrT += m_sizeVerticesTriangle[n];
 		cptT += m_sizeVerticesTriangle[n];
 	}
 
-	m_selection = new bool[m_nbMolecules];
+	m_selection.resize( m_nbMolecules );
 	m_nbHisto = 3;
 	m_histograms = new Histogram *[m_nbHisto];
 	m_histograms[0] = m_histograms[1] = m_histograms[2] = NULL;
@@ -843,19 +834,20 @@ void VoronoiObject::generateDisplay()
 
 void VoronoiObject::generateStats()
 {
-	double ** datas = new double *[MoleculeInfos::NB_DATATYPE];
-	for( int n = 0; n < MoleculeInfos::NB_DATATYPE; n++ )
+	int nbFeatures = m_parent->m_infos.nbFeatures();
+	double ** datas = new double *[nbFeatures];
+	for( int n = 0; n < nbFeatures; n++ )
 		datas[n] = new double[m_nbMolecules];
 
 	//Creation of the display of the molecules part of the object
 	for( int n = 0; n < m_nbMolecules; n++ ){
 		int index = m_molecules[n];
-		for( int i = 0; i < MoleculeInfos::NB_DATATYPE; i++ )
-			datas[i][n] = m_parent->m_infos[n].getData( i );
+		for( int i = 0; i < nbFeatures; i++ )
+			datas[i][n] = m_parent->m_infos.getData( i, n );
 	}
 
-	m_stats = new ArrayStatistics[MoleculeInfos::NB_DATATYPE];
-	for( int i = 0; i < MoleculeInfos::NB_DATATYPE; i++ ){
+	m_stats = new ArrayStatistics[nbFeatures];
+	for( int i = 0; i < nbFeatures; i++ ){
 		m_stats[i] = GeneralTools::generateArrayStatistics( datas[i], m_nbMolecules );
 		delete [] datas[i];
 	}
@@ -65,12 +65,19 @@ VoronoiWidget::VoronoiWidget( Camera2D * _camera, QWidget* _parent /*= 0*/ ):QTa
 	QButtonGroup * groupBox = new QButtonGroup;
 	groupBox->addButton( m_cboxdsetCleaner );
 	groupBox->addButton( m_cboxdset );
+	QLabel * maxDensityRankLbl = new QLabel( "Max density rank: " );
+	maxDensityRankLbl->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
+	m_maxDensityRankLEdit = new QLineEdit( QString::number( WrapperVoronoiDiagram::getMaxDensityRankParam() ) );
+	m_maxDensityRankLEdit->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
+	m_maxDensityRankLEdit->setToolTip( "Local densities are computed up to this rank of neighbors (1 for the first rank only)" );
 	m_buttonCreation = new QPushButton( "Create polygons" );
 	m_buttonCreation->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
 	QGridLayout * layoutConstruction= new QGridLayout;
 	int columnCount = 0;
 	layoutConstruction->addWidget( m_cboxdsetCleaner, 0, columnCount, 1, 1 );
 	layoutConstruction->addWidget( m_cboxdset, 1, columnCount++, 1, 1 );
+	layoutConstruction->addWidget( maxDensityRankLbl, 0, columnCount, 1, 1 );
+	layoutConstruction->addWidget( m_maxDensityRankLEdit, 1, columnCount++, 1, 1 );
 	layoutConstruction->addWidget( m_buttonCreation, 0, columnCount++, 2, 1 );
 	groupConstruction->setLayout( layoutConstruction );
 
@@ -84,6 +91,23 @@ VoronoiWidget::VoronoiWidget( Camera2D * _camera, QWidget* _parent /*= 0*/ ):QTa
 	applyDensityFacor->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
 	QPushButton * applySegmentationBtn = new QPushButton( "Create objects" );
 	applySegmentationBtn->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
+	m_sweepFactorsLEdit = new QLineEdit( "0.5:0.5:5" );
+	m_sweepFactorsLEdit->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
+	m_sweepFactorsLEdit->setToolTip( "Density factors of the sweep, as min:step:max or as a list separated by commas" );
+	QPushButton * sweepFactorsBtn = new QPushButton( "Sweep factors" );
+	sweepFactorsBtn->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
+	QLabel * edgeLengthLbl = new QLabel( "Max edge length: " );
+	edgeLengthLbl->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
+	m_edgeLengthLEdit = new QLineEdit( "0.05" );
+	m_edgeLengthLEdit->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
+	m_edgeLengthSlider = new QSlider( Qt::Horizontal );
+	m_edgeLengthSlider->setRange( 0, 1000 );
+	m_edgeLengthSlider->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
+	m_edgeLengthSlider->setToolTip( "Quantile of the Delaunay edge lengths used as max edge length" );
+	QPushButton * selectEdgeLengthBtn = new QPushButton( "Select by edge length" );
+	selectEdgeLengthBtn->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
+	QPushButton * segmentEdgeLengthBtn = new QPushButton( "Objects by edge length" );
+	segmentEdgeLengthBtn->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
 	m_cboxMinAreaObjs = new QCheckBox( "Min area: " );
 	m_cboxMinAreaObjs->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
 	m_cboxMinAreaObjs->setChecked( true );
@@ -194,6 +218,8 @@ VoronoiWidget::VoronoiWidget( Camera2D * _camera, QWidget* _parent /*= 0*/ ):QTa
 	layoutSegmentation->addWidget(m_maxAreaObjectsLEdit, 2, 1, 1, 1);
 	layoutSegmentation->addWidget(m_cboxMaxLocsObjs, 2, 2, 1, 1);
 	layoutSegmentation->addWidget(m_maxLocsObjectsLEdit, 2, 3, 1, 1);
+	layoutSegmentation->addWidget(sweepFactorsBtn, 2, 4, 1, 1);
+	layoutSegmentation->addWidget(m_sweepFactorsLEdit, 2, 5, 1, 1);
 	layoutSegmentation->addWidget(m_cboxPCAEllipse, 2, 6, 1, 1);
 	layoutSegmentation->addWidget(m_cboxBoundingEllipse, 2, 7, 1, 1);
 	m_groupSegmentation->setLayout(layoutSegmentation);
@@ -205,6 +231,11 @@ VoronoiWidget::VoronoiWidget( Camera2D * _camera, QWidget* _parent /*= 0*/ ):QTa
 		layoutSegmentation->addWidget(m_nbLocsWatershedLEdit, 3, 3, 1, 1);
 		layoutSegmentation->addWidget(m_cboxWatershed, 3, 4, 1, 1);
 	}
+	layoutSegmentation->addWidget( edgeLengthLbl, 4, 0, 1, 1 );
+	layoutSegmentation->addWidget( m_edgeLengthLEdit, 4, 1, 1, 1 );
+	layoutSegmentation->addWidget( m_edgeLengthSlider, 4, 2, 1, 2 );
+	layoutSegmentation->addWidget( selectEdgeLengthBtn, 4, 4, 1, 1 );
+	layoutSegmentation->addWidget( segmentEdgeLengthBtn, 4, 5, 1, 1 );
 
 	m_groupVoronoi = new QGroupBox( QObject::tr( "Voronoi" ) );
 	m_groupVoronoi->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Maximum );
@@ -489,6 +520,10 @@ VoronoiWidget::VoronoiWidget( Camera2D * _camera, QWidget* _parent /*= 0*/ ):QTa
 
 	QObject::connect( applyDensityFacor, SIGNAL( pressed() ), this, SLOT( applyDensityFactor() ) );
 	QObject::connect( applySegmentationBtn, SIGNAL( pressed() ), this, SLOT( segmentVoronoi() ) );
+	QObject::connect( sweepFactorsBtn, SIGNAL( pressed() ), this, SLOT( sweepDensityFactors() ) );
+	QObject::connect( m_edgeLengthSlider, SIGNAL( valueChanged( int ) ), this, SLOT( changeEdgeLengthQuantile( int ) ) );
+	QObject::connect( selectEdgeLengthBtn, SIGNAL( pressed() ), this, SLOT( applyEdgeLength() ) );
+	QObject::connect( segmentEdgeLengthBtn, SIGNAL( pressed() ), this, SLOT( segmentEdgeLength() ) );
 	QObject::connect( exportStatsBtn, SIGNAL( pressed() ), this, SLOT( exportStatsClustersObjects() ) );
 	QObject::connect( exportStatsObjectsBtn, SIGNAL( pressed() ), this, SLOT( exportStatsObjects() ) );
 	QObject::connect(clipboardObjectsBtn, SIGNAL(pressed()), this, SLOT(exportObjectsToClipboard()));
@@ -645,11 +680,13 @@ void VoronoiWidget::segmentVoronoi()
 	WrapperVoronoiDiagram * voronoi = m_currentCamera->getVoronoiDiagram();
 	if( voronoi == NULL )return;
 	SuperResObject * sobj = m_currentCamera->getSuperResObject();
-	if( m_cboxObjectOnROIs->isChecked() )
+	if( m_cboxObjectOnROIs->isChecked() ){
 		sobj->removeObjectsInsideROIs( sobj->getRois() );
+		sobj->addNeuronObjects( voronoi->createVoronoiObjects( minArea, minLocs, maxArea, maxLocs, m_cboxCutDistObjs->isChecked(), cutD, m_cboxPCAEllipse->isChecked(), watershed, radiusWatershed, nbLocsWatershed ) );
+	}
+	//The objects still accepted by the filters are given back by the diagram, the other ones are deleted
 	else
-		sobj->removeObjectsInsideROIs( RoiList() );
-	sobj->addNeuronObjects( voronoi->createVoronoiObjects( minArea, minLocs, maxArea, maxLocs, m_cboxCutDistObjs->isChecked(), cutD, m_cboxPCAEllipse->isChecked(), watershed, radiusWatershed, nbLocsWatershed ) );
+		sobj->replaceNeuronObjects( voronoi->createVoronoiObjects( minArea, minLocs, maxArea, maxLocs, m_cboxCutDistObjs->isChecked(), cutD, m_cboxPCAEllipse->isChecked(), watershed, radiusWatershed, nbLocsWatershed, sobj->getNeuronObjects() ) );
 	int elapsedTime = time.elapsed();
 	time.restart();
 	QTime test = QTime();
@@ -659,6 +696,128 @@ void VoronoiWidget::segmentVoronoi()
 	updateObjectsList();
 }
 
+//Object statistics for a list of density factors computed in a single pass and saved in a file, the objects
+//are filtered as in segmentVoronoi but neither the ROIs nor the watershed are taken into account
+void VoronoiWidget::sweepDensityFactors()
+{
+	WrapperVoronoiDiagram * voronoi = m_currentCamera->getVoronoiDiagram();
+	if( voronoi == NULL )return;
+	std::vector < double > factors;
+	bool ok;
+	QString text = m_sweepFactorsLEdit->text();
+	if( text.contains( ':' ) ){
+		QStringList range = text.split( ':' );
+		if( range.size() != 3 ) return;
+		double minF = range[0].toDouble(), stepF = range[1].toDouble(), maxF = range[2].toDouble();
+		if( stepF <= 0. ) return;
+		for( double factor = minF; factor <= maxF + 0.5 * stepF; factor += stepF )
+			factors.push_back( factor );
+	}
+	else{
+		QStringList values = text.split( ',', QString::SkipEmptyParts );
+		for( int n = 0; n < values.size(); n++ ){
+			double factor = values[n].toDouble( &ok );
+			if( ok ) factors.push_back( factor );
+		}
+	}
+	if( factors.empty() ) return;
+
+	double minArea = 0., cutD = DBL_MAX, maxArea = DBL_MAX;
+	double tmp = m_minAreaObjectsLEdit->text().toDouble( &ok );
+	if( ok && m_cboxMinAreaObjs->isChecked() ) minArea = tmp;
+	tmp = m_maxAreaObjectsLEdit->text().toDouble(&ok);
+	if (ok && m_cboxMaxAreaObjs->isChecked()) maxArea = tmp;
+	tmp = m_cutDistObjectsLEdit->text().toDouble(&ok);
+	if( ok && m_cboxCutDistObjs->isChecked() ) cutD = tmp * tmp;
+	unsigned int minLocs = 1, maxLocs = UINT_MAX;
+	unsigned int tmp2 = m_minLocsObjectsLEdit->text().toUInt( &ok );
+	if( ok && m_cboxMinLocsObjs->isChecked() ) minLocs = tmp2;
+	tmp2 = m_maxLocsObjectsLEdit->text().toUInt(&ok);
+	if (ok && m_cboxMaxLocsObjs->isChecked()) maxLocs = tmp2;
+
+	QTime time;
+	time.start();
+	std::vector < DensitySweep::Threshold > thresholds = voronoi->sweepDensityFactors( factors, minArea, minLocs, maxArea, maxLocs, m_cboxCutDistObjs->isChecked(), cutD );
+	QTime test = QTime();
+	test = test.addMSecs( time.elapsed() );
+	std::cout << "Elapsed time for the sweep of " << factors.size() << " density factors [" << test.hour() << ":" << test.minute() << ":" << test.second() << ":" << test.msec() << "] (h:min:s:ms)" << std::endl;
+
+	QString nameXls( m_currentCamera->getSuperResObject()->getDir().c_str() );
+	nameXls.append( "/DensityFactorsSweep.xls" );
+	nameXls = QFileDialog::getSaveFileName( NULL, QObject::tr( "Save sweep..." ), nameXls, QObject::tr( "Stats files (*.xls)" ), 0, QFileDialog::DontUseNativeDialog );
+	if( nameXls.isEmpty() ) return;
+	std::ofstream fs( nameXls.toAscii().data() );
+	if( !fs ){
+		std::cout << "System failed to open " << nameXls.toAscii().data() << std::endl;
+		return;
+	}
+	fs << "Density factor\tDensity threshold\t# objects\tTotal area\tMean area\t# detections\tMean # detections\t# connected components" << std::endl;
+	for( int n = ( int )thresholds.size() - 1; n >= 0; n-- ){
+		const DensitySweep::Threshold & t = thresholds[n];
+		fs << t.m_factor << "\t" << t.m_threshold << "\t" << t.m_nbObjects << "\t" << t.m_area << "\t" << t.m_meanArea << "\t" << t.m_nbLocalizations << "\t" << t.m_meanLocalizations << "\t" << t.m_nbComponents << std::endl;
+	}
+	fs.close();
+}
+
+//The slider gives a quantile of the Delaunay edge lengths, the selection follows it
+void VoronoiWidget::changeEdgeLengthQuantile( int _val )
+{
+	WrapperVoronoiDiagram * voronoi = m_currentCamera->getVoronoiDiagram();
+	if( voronoi == NULL )return;
+	double length = voronoi->getEdgeLengthQuantile( ( double )_val / ( double )m_edgeLengthSlider->maximum() );
+	m_edgeLengthLEdit->setText( QString::number( length ) );
+	applyEdgeLength();
+}
+
+//Selects the molecules connected by Delaunay edges not longer than the max edge length, in components of more than
+//the min # locs
+void VoronoiWidget::applyEdgeLength()
+{
+	WrapperVoronoiDiagram * voronoi = m_currentCamera->getVoronoiDiagram();
+	if( voronoi == NULL )return;
+	bool ok;
+	double length = m_edgeLengthLEdit->text().toDouble( &ok );
+	if( !ok ) return;
+	unsigned int minLocs = 1;
+	unsigned int tmp2 = m_minLocsObjectsLEdit->text().toUInt( &ok );
+	if( ok && m_cboxMinLocsObjs->isChecked() ) minLocs = tmp2;
+	voronoi->applyEdgeLengthThreshold( length, minLocs );
+	m_currentCamera->updateGL();
+}
+
+//Objects made of the Delaunay edges not longer than the max edge length, filtered as in segmentVoronoi. Neither the
+//density, the ROIs nor the watershed are taken into account
+void VoronoiWidget::segmentEdgeLength()
+{
+	WrapperVoronoiDiagram * voronoi = m_currentCamera->getVoronoiDiagram();
+	if( voronoi == NULL )return;
+	bool ok;
+	double length = m_edgeLengthLEdit->text().toDouble( &ok );
+	if( !ok ) return;
+	m_groupVoronoiClusters->setVisible( false );
+	m_emptyForClusters->setVisible( true );
+
+	double minArea = 0., maxArea = DBL_MAX;
+	double tmp = m_minAreaObjectsLEdit->text().toDouble( &ok );
+	if( ok && m_cboxMinAreaObjs->isChecked() ) minArea = tmp;
+	tmp = m_maxAreaObjectsLEdit->text().toDouble(&ok);
+	if (ok && m_cboxMaxAreaObjs->isChecked()) maxArea = tmp;
+	unsigned int minLocs = 1, maxLocs = UINT_MAX;
+	unsigned int tmp2 = m_minLocsObjectsLEdit->text().toUInt( &ok );
+	if( ok && m_cboxMinLocsObjs->isChecked() ) minLocs = tmp2;
+	tmp2 = m_maxLocsObjectsLEdit->text().toUInt(&ok);
+	if (ok && m_cboxMaxLocsObjs->isChecked()) maxLocs = tmp2;
+
+	QTime time;
+	time.start();
+	SuperResObject * sobj = m_currentCamera->getSuperResObject();
+	sobj->replaceNeuronObjects( voronoi->createEdgeLengthObjects( length, minArea, minLocs, maxArea, maxLocs, m_cboxPCAEllipse->isChecked() ) );
+	QTime test = QTime();
+	test = test.addMSecs( time.elapsed() );
+	std::cout << "\nElapsed time for creation of the edge length objects [" << test.hour() << ":" << test.minute() << ":" << test.second() << ":" << test.msec() << "] (h:min:s:ms)" << std::endl;
+	m_currentCamera->updateGL();
+	updateObjectsList();
+}
 
 void VoronoiWidget::createClusters()
 {
@@ -695,7 +854,7 @@ void VoronoiWidget::createClusters()
 	if (ok && m_cboxMaxLocsClusters->isChecked()) maxLocs = tmp2;
 
 	WrapperVoronoiDiagram * voronoi = m_currentCamera->getVoronoiDiagram();
-	MoleculeInfos * infos = voronoi->getMoleculeInfos();
+	const MoleculeInfos * infos = voronoi->getMoleculeInfos();
 	int nbMolVoro = voronoi->nbMolecules(), nbTrianglesDelau = voronoi->getNbFiniteTriangles();
 	NeuronObjectList objects = m_currentCamera->getNeuronObjects();
 
@@ -735,7 +894,7 @@ void VoronoiWidget::createClusters()
 
 			nbPolygonsROIsBefore = nbPolygonsROIs;
 			if( m_cboxDeltaClustersROIs->isChecked() || m_cboxClustersOnROIs->isChecked() ){
-				VertHandle v = infos[index].getMolecule();
+				VertHandle v = infos->getMolecule( index );
 				insideROIs = false;
 				currentRoi = 1;
 				for( RoiList::const_iterator it2 = rois.begin(); it2 != rois.end() && !insideROIs; it2++, currentRoi++ ){
@@ -769,7 +928,7 @@ void VoronoiWidget::createClusters()
 	double delta = 0., areaInsideROIs = 0.;
 	for( unsigned int n = 0; n < nbMolVoro; n++ )
 		if( correctPolygonsSelected[n] )
-			areaInsideROIs += infos[n].getData( MoleculeInfos::Area );
+			areaInsideROIs += infos->getData( MoleculeInfos::Area, n );
 	delta = ( double )nbCorrectPolygonsSelected / areaInsideROIs;
 
 	if( m_cboxClustersOnObject->isChecked() )
@@ -859,6 +1018,13 @@ void VoronoiWidget::exportStatsObjects()
 
 void VoronoiWidget::createVoronoi()
 {
+	//The rank is read by the diagram when it is built, a diagram built with another rank is not updated but rebuilt
+	bool ok = false;
+	int maxRank = m_maxDensityRankLEdit->text().toInt( &ok );
+	if( ok && maxRank >= 1 )
+		WrapperVoronoiDiagram::setMaxDensityRank( maxRank );
+	else
+		m_maxDensityRankLEdit->setText( QString::number( WrapperVoronoiDiagram::getMaxDensityRankParam() ) );
 	m_currentCamera->createVoronoiDiagram( m_cboxdsetCleaner->isChecked() );
 	setWrapperVoronoi( m_currentCamera->getVoronoiDiagram() );
 	m_currentCamera->updateGL();
@@ -42,6 +42,7 @@
 #include <QComboBox>
 #include <QButtonGroup>
 #include <QTableWidget>
+#include <QSlider>
 
 #include "FilterObjectWidget.hpp"
 
@@ -74,6 +75,10 @@ protected:
 protected slots:
 	void applyDensityFactor();
 	void segmentVoronoi();
+	void sweepDensityFactors();
+	void changeEdgeLengthQuantile( int );
+	void applyEdgeLength();
+	void segmentEdgeLength();
 	void createClusters();
 	void exportStatsClustersObjects();
 	void exportStatsObjects();
@@ -96,13 +101,15 @@ protected:
 	//Construction
 	QGroupBox * m_groupVoronoi;
 	QCheckBox * m_cboxdsetCleaner, * m_cboxdset;
+	QLineEdit * m_maxDensityRankLEdit;
 	QPushButton * m_buttonCreation;
 	FilterObjectWidget * m_filterVoronoiWidget;
 	
 	//Object
 	QGroupBox * m_groupSegmentation, * m_groupVoronoiObjects;
 	QCheckBox * m_cboxObjectOnDiagram, *m_cboxObjectOnROIs, *m_cboxDeltaObjectDiagram, *m_cboxDeltaObjectROIs, *m_cboxDisplayObjLabels, *m_cboxMinAreaObjs, *m_cboxMinLocsObjs, *m_cboxCutDistObjs, *m_cboxPCAEllipse, *m_cboxBoundingEllipse, *m_cboxWatershed, *m_cboxMaxAreaObjs, *m_cboxMaxLocsObjs;
-	QLineEdit * m_factorDensityObjectLEdit, *m_minAreaObjectsLEdit, *m_minLocsObjectsLEdit, *m_cutDistObjectsLEdit, *m_radiusWatershedLEdit, *m_nbLocsWatershedLEdit, *m_maxAreaObjectsLEdit, *m_maxLocsObjectsLEdit;
+	QLineEdit * m_factorDensityObjectLEdit, *m_minAreaObjectsLEdit, *m_minLocsObjectsLEdit, *m_cutDistObjectsLEdit, *m_radiusWatershedLEdit, *m_nbLocsWatershedLEdit, *m_maxAreaObjectsLEdit, *m_maxLocsObjectsLEdit, *m_sweepFactorsLEdit, *m_edgeLengthLEdit;
+	QSlider * m_edgeLengthSlider;
 	QButtonGroup * m_buttonGroupObjectsOnWhat, * m_buttonGroupEllipse;
 	QWidget * m_emptyForObjects;
 	QTableWidget * m_tableObjs;
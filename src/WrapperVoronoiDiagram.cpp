@@ -36,6 +36,7 @@
 #include <math.h>
 #include <fstream>
 #include <algorithm>
+#include <queue>
 #include <CGAL/ch_graham_andrew.h>
 #include <qmath.h>
 #include <QTime>
@@ -46,8 +47,12 @@
 #include "Geometry.hpp"
 #include "ImageViewer.hpp"
 #include "nanoflann.hpp"
+#include "DetectionSet.hpp"
+#include "TiledDelaunay.hpp"
+#include "VoronoiCellBuilder.hpp"
+#include "NeighborGraph.hpp"
+#include "DensitySweep.hpp"
 
-unsigned short MoleculeInfos::NB_DATATYPE = 3;
 
 bool sortVoronoiObjects( VoronoiObject * _v1, VoronoiObject * _v2 ){
 	return _v1->getArea() > _v2->getArea();
@@ -57,18 +62,33 @@ bool sortNeuronbjects( NeuronObject * _o1, NeuronObject * _o2 ){
 	return _o1->getObject()->getArea() > _o2->getObject()->getArea();
 }
 
-WrapperVoronoiDiagram::WrapperVoronoiDiagram( DetectionPoint * _ps, const int _nb, const double _w, const double _h ):m_nbMolecules( _nb ), m_originalWidth( _w ), m_originalHeight( _h ), m_factorDensity( 2. ), m_filled( false )
+
+int WrapperVoronoiDiagram::m_maxDensityRankParam = 1;
+
+WrapperVoronoiDiagram::WrapperVoronoiDiagram( DetectionSet * _dset, const double _w, const double _h ):m_nbMolecules( _dset->getNbPoints() ), m_originalWidth( _w ), m_originalHeight( _h ), m_factorDensity( 2. ), m_filled( false ), m_maxDensityRank( m_maxDensityRankParam )
 {
 	std::cout << "Beginning creation of the voronoi diagram" << std::endl;
 	double areaImage = _w * _h;
-	double nbMolecules = _nb;
+	const LocReal * xs = _dset->getXs(), * ys = _dset->getYs();
+	int nb = _dset->getNbPoints();
+	double nbMolecules = nb;
 	m_avgDensity = nbMolecules / areaImage;
 
-	m_linesCell = m_trianglesCell = NULL;
-	m_firstVerticesLine = m_sizeVerticesLine = m_firstVerticesTriangle = m_sizeVerticesTriangle = NULL;
-	m_infos = NULL;
+	m_voronoiVertices = NULL;
+	m_cellIndexes = m_lineIndexes = m_triangleIndexes = NULL;
+	m_firstCellVertex = m_sizeCell = NULL;
+	m_nbVoronoiVertices = m_nbCellVertices = 0;
+	m_previousNbFaces = 0;
+	m_kdColumns = NULL;
+	m_kdTree = NULL;
 
 	m_stats = NULL;
+	m_faceAreas = m_faceMaxEdgesSqr = NULL;
+	m_faceMinDensities = NULL;
+	m_maxArea = 0.;
+	m_segmentationNeighbors = NULL;
+	m_segmentationCached = m_cachedCutD = m_cachedPca = false;
+	m_cachedCutDSqr = 0.;
 
 	QTime timer;
 	timer.start();
@@ -76,25 +96,27 @@ WrapperVoronoiDiagram::WrapperVoronoiDiagram( DetectionPoint * _ps, const int _n
 
 	std::vector < std::pair< Point_2, int > > points;
 	std::list < Point_2 > pointsHull;
-	//std::cout << "# pts for voronoi: " << _nb << std::endl;
-	m_nbOriginalPoints = _nb;
-	points.reserve( _nb );
-	for( int n = 0; n < _nb; n++ ){
-		Point_2 tmp( _ps[n].x(), _ps[n].y() );
+	//std::cout << "# pts for voronoi: " << nb << std::endl;
+	m_nbOriginalPoints = nb;
+	points.reserve( nb );
+	for( int n = 0; n < nb; n++ ){
+		Point_2 tmp( xs[n], ys[n] );
 		points.push_back( std::make_pair( tmp, n ) );
 		pointsHull.push_back( tmp );
 	}
-	m_delau.insert( points.begin(), points.end() );
+	if( !TiledDelaunay::build( m_delau, points ) )
+		m_delau.insert( points.begin(), points.end() );
 	for( Delaunay_triangulation_2::All_faces_iterator it = m_delau.all_faces_begin(); it != m_delau.all_faces_end(); it++ )
 		it->info() = -1;
 	generateDisplay();
 	/*std::ofstream fs("d:/test_locs.txt");
 	for (unsigned int n = 0; n < _nb; n++)
-		fs << m_infos[n].getMolecule()->point().x() << "\t" << m_infos[n].getMolecule()->point().y() << std::endl;
+		fs << m_infos.getMolecule( n )->point().x() << "\t" << m_infos.getMolecule( n )->point().y() << std::endl;
 	fs.close();*/
-	m_nbHisto = 3;
+	m_nbHisto = m_infos.nbFeatures();
 	m_histograms = new Histogram *[m_nbHisto];
-	m_histograms[0] = m_histograms[1] = m_histograms[2] = NULL;
+	for( int n = 0; n < m_nbHisto; n++ )
+		m_histograms[n] = NULL;
 	computeHistograms();
 	m_palette = Palette::getStaticLut("InvFire");
 	m_palette->setAutoscale( true );
@@ -108,55 +130,271 @@ WrapperVoronoiDiagram::WrapperVoronoiDiagram( DetectionPoint * _ps, const int _n
 
 WrapperVoronoiDiagram::~WrapperVoronoiDiagram()
 {
-	if( m_infos != NULL )
-		delete [] m_infos;
 	if( m_stats != NULL )
 		delete [] m_stats;
-	if( m_linesCell != NULL )
-		delete [] m_linesCell;
-	if( m_firstVerticesLine != NULL )
-		delete [] m_firstVerticesLine;
-	if( m_sizeVerticesLine != NULL )
-		delete [] m_sizeVerticesLine;
-	if( m_trianglesCell != NULL )
-		delete [] m_trianglesCell;
-	if( m_firstVerticesTriangle != NULL )
-		delete [] m_firstVerticesTriangle;
-	if( m_sizeVerticesTriangle != NULL )
-		delete [] m_sizeVerticesTriangle;
+	if( m_voronoiVertices != NULL )
+		delete [] m_voronoiVertices;
+	if( m_cellIndexes != NULL )
+		delete [] m_cellIndexes;
+	if( m_lineIndexes != NULL )
+		delete [] m_lineIndexes;
+	if( m_triangleIndexes != NULL )
+		delete [] m_triangleIndexes;
+	if( m_firstCellVertex != NULL )
+		delete [] m_firstCellVertex;
+	if( m_sizeCell != NULL )
+		delete [] m_sizeCell;
+	if( m_faceAreas != NULL )
+		delete [] m_faceAreas;
+	if( m_faceMaxEdgesSqr != NULL )
+		delete [] m_faceMaxEdgesSqr;
+	if( m_faceMinDensities != NULL )
+		delete [] m_faceMinDensities;
+	m_stats = NULL;
+	clearSegmentationCache();
+	releaseSpatialIndex();
+}
+
+//Releases everything generateDisplay allocates and the cached segmentation, the triangulation and the histograms are kept
+void WrapperVoronoiDiagram::releaseDisplay()
+{
+	clearSegmentationCache();
+	releaseSpatialIndex();
+	m_edgeSegmentation.clear();
+	if( m_stats != NULL )
+		delete [] m_stats;
+	if( m_voronoiVertices != NULL )
+		delete [] m_voronoiVertices;
+	if( m_cellIndexes != NULL )
+		delete [] m_cellIndexes;
+	if( m_lineIndexes != NULL )
+		delete [] m_lineIndexes;
+	if( m_triangleIndexes != NULL )
+		delete [] m_triangleIndexes;
+	if( m_firstCellVertex != NULL )
+		delete [] m_firstCellVertex;
+	if( m_sizeCell != NULL )
+		delete [] m_sizeCell;
+	if( m_faceAreas != NULL )
+		delete [] m_faceAreas;
+	if( m_faceMaxEdgesSqr != NULL )
+		delete [] m_faceMaxEdgesSqr;
+	if( m_faceMinDensities != NULL )
+		delete [] m_faceMinDensities;
 	m_stats = NULL;
+	m_voronoiVertices = NULL;
+	m_cellIndexes = m_lineIndexes = m_triangleIndexes = NULL;
+	m_firstCellVertex = m_sizeCell = NULL;
+	m_faceAreas = m_faceMaxEdgesSqr = NULL;
+	m_faceMinDensities = NULL;
+	m_nbVoronoiVertices = m_nbCellVertices = 0;
+}
+
+//The molecule coordinates are copied from the vertices, so the index does not depend on the detection set the diagram
+//was built from
+const KdTree_2D_columns * WrapperVoronoiDiagram::getSpatialIndex()
+{
+	if( m_kdTree != NULL ) return m_kdTree;
+	m_moleculeXs.resize( m_nbMolecules );
+	m_moleculeYs.resize( m_nbMolecules );
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		VertHandle molecule = m_infos.getMolecule( n );
+		m_moleculeXs[n] = molecule->point().x();
+		m_moleculeYs[n] = molecule->point().y();
+	}
+	m_kdColumns = new KdColumns_L( &m_moleculeXs[0], &m_moleculeYs[0], m_nbMolecules );
+	m_kdTree = new KdTree_2D_columns( 2, *m_kdColumns, nanoflann::KDTreeSingleIndexAdaptorParams( 10 /* max leaf */ ) );
+	m_kdTree->buildIndex();
+	return m_kdTree;
+}
+
+void WrapperVoronoiDiagram::releaseSpatialIndex()
+{
+	if( m_kdTree != NULL )
+		delete m_kdTree;
+	if( m_kdColumns != NULL )
+		delete m_kdColumns;
+	m_kdTree = NULL;
+	m_kdColumns = NULL;
+	std::vector < LocReal >().swap( m_moleculeXs );
+	std::vector < LocReal >().swap( m_moleculeYs );
+}
+
+//Result set of the spatial index counting the neighbors that belong to a component, without storing them. The
+//neighbors can also be marked, by their index in the component
+class ComponentNeighbors{
+public:
+	ComponentNeighbors( const LocReal _radius, const int * _moleculeComponents, const int _component, const int * _moleculeIndexes = NULL, char * _marks = NULL ):m_radius( _radius ), m_moleculeComponents( _moleculeComponents ), m_component( _component ), m_moleculeIndexes( _moleculeIndexes ), m_marks( _marks ), m_count( 0 ){}
+
+	inline std::size_t size() const { return m_count; }
+	inline bool full() const { return true; }
+	inline LocReal worstDist() const { return m_radius; }
+	inline void addPoint( const LocReal _dist, const std::size_t _index ){
+		if( _dist >= m_radius ) return;
+		if( m_moleculeComponents[_index] != m_component ) return;
+		m_count++;
+		if( m_marks != NULL )
+			m_marks[m_moleculeIndexes[_index]] = 1;
+	}
+
+protected:
+	LocReal m_radius;
+	const int * m_moleculeComponents;
+	int m_component;
+	const int * m_moleculeIndexes;
+	char * m_marks;
+	std::size_t m_count;
+};
+
+bool sortPointIndexes( const std::pair < Point_2, int > & _p1, const std::pair < Point_2, int > & _p2 ){
+	return _p1.first < _p2.first;
+}
+
+//Updates the diagram for a new set of localizations (after a cleaning or a crop) by removing the vertices that are not
+//part of it anymore and inserting the new ones, instead of triangulating everything again. The localizations are matched
+//by their exact coordinates, and only the cells and densities around the changed ones are computed again. Returns false,
+//and leaves the diagram untouched, when too many of them changed for the update to be worth it; the caller then has to
+//create a new diagram
+bool WrapperVoronoiDiagram::update( DetectionSet * _dset )
+{
+	if( _dset == NULL || _dset->getXs() == NULL || m_maxDensityRank != m_maxDensityRankParam ) return false;
+	QTime timer;
+	timer.start();
+	const LocReal * xs = _dset->getXs(), * ys = _dset->getYs();
+	int nb = _dset->getNbPoints();
+
+	std::vector < std::pair< Point_2, int > > points;
+	points.reserve( nb );
+	for( int n = 0; n < nb; n++ )
+		points.push_back( std::make_pair( Point_2( xs[n], ys[n] ), n ) );
+	std::sort( points.begin(), points.end(), sortPointIndexes );
+
+	//A vertex is kept when a localization lies at its position, its info becomes the index of the first one of them
+	std::vector < VertHandle > removed;
+	std::vector < int > pointToPrevious( nb, -1 );
+	std::vector < bool > matched( nb, false );
+	std::vector < int > newPointOfMolecule( m_nbMolecules, -1 );
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		VertHandle v = m_infos.getMolecule( n );
+		std::pair < Point_2, int > key( v->point(), 0 );
+		std::vector < std::pair< Point_2, int > >::const_iterator first = std::lower_bound( points.begin(), points.end(), key, sortPointIndexes );
+		std::vector < std::pair< Point_2, int > >::const_iterator last = std::upper_bound( first, points.end(), key, sortPointIndexes );
+		if( first == last ){
+			removed.push_back( v );
+			continue;
+		}
+		int point = first->second;
+		for( ; first != last; first++ ){
+			matched[first->second] = true;
+			point = std::min( point, first->second );
+		}
+		newPointOfMolecule[n] = point;
+		pointToPrevious[point] = n;
+	}
+	std::vector < int > inserted;
+	for( int n = 0; n < nb; n++ )
+		if( !matched[n] )
+			inserted.push_back( n );
+	if( 4 * ( removed.size() + inserted.size() ) > ( unsigned int )m_nbMolecules ){
+		std::cout << "Too many localizations changed [" << removed.size() << " removed, " << inserted.size() << " added], the voronoi diagram is created again" << std::endl;
+		return false;
+	}
+	std::cout << "Beginning update of the voronoi diagram [" << removed.size() << " removed, " << inserted.size() << " added]" << std::endl;
+
+	//The molecules whose Delaunay neighbors change are the neighbors of the removed and inserted vertices
+	std::vector < bool > changed( nb, false );
+	for( unsigned int n = 0; n < removed.size(); n++ ){
+		Delaunay_triangulation_2::Vertex_circulator first = m_delau.incident_vertices( removed[n] ), current = first;
+		do{
+			if( !m_delau.is_infinite( current ) && newPointOfMolecule[current->info()] >= 0 )
+				changed[newPointOfMolecule[current->info()]] = true;
+			current++;
+		}while( current != first );
+	}
+	for( int n = 0; n < m_nbMolecules; n++ )
+		if( newPointOfMolecule[n] >= 0 )
+			m_infos.getMolecule( n )->info() = newPointOfMolecule[n];
+	for( unsigned int n = 0; n < removed.size(); n++ )
+		m_delau.remove( removed[n] );
+	std::vector < VertHandle > insertedVertices;
+	for( unsigned int n = 0; n < inserted.size(); n++ ){
+		int before = m_delau.number_of_vertices();
+		VertHandle v = m_delau.insert( Point_2( xs[inserted[n]], ys[inserted[n]] ) );
+		//A duplicate of a localization inserted just before
+		if( ( int )m_delau.number_of_vertices() == before ) continue;
+		v->info() = inserted[n];
+		changed[inserted[n]] = true;
+		insertedVertices.push_back( v );
+	}
+	for( unsigned int n = 0; n < insertedVertices.size(); n++ ){
+		Delaunay_triangulation_2::Vertex_circulator first = m_delau.incident_vertices( insertedVertices[n] ), current = first;
+		do{
+			if( !m_delau.is_infinite( current ) )
+				changed[current->info()] = true;
+			current++;
+		}while( current != first );
+	}
+	//The faces incident to a molecule whose neighbors did not change were not touched by the removals and insertions,
+	//they keep their previous index. The other ones are new
+	for( Delaunay_triangulation_2::All_faces_iterator it = m_delau.all_faces_begin(); it != m_delau.all_faces_end(); it++ ){
+		bool kept = false;
+		if( !m_delau.is_infinite( it ) )
+			for( int j = 0; j < 3 && !kept; j++ )
+				kept = !changed[it->vertex( j )->info()];
+		if( !kept )
+			it->info() = -1;
+	}
+
+	m_nbOriginalPoints = nb;
+	m_avgDensity = ( double )nb / ( m_originalWidth * m_originalHeight );
+	m_previousCellIndexes.assign( m_cellIndexes, m_cellIndexes + m_nbCellVertices );
+	m_previousFirstCellVertex.assign( m_firstCellVertex, m_firstCellVertex + m_nbMolecules );
+	m_previousSizeCell.assign( m_sizeCell, m_sizeCell + m_nbMolecules );
+	m_previousNbFaces = m_nbFiniteTriangles;
+	releaseDisplay();
+	m_previousInfos.swap( m_infos );
+	m_pointToPrevious.swap( pointToPrevious );
+	m_changedPoints.swap( changed );
+	generateDisplay();
+	m_previousInfos.clear();
+	m_pointToPrevious.clear();
+	m_changedPoints.clear();
+	std::vector < unsigned int >().swap( m_previousCellIndexes );
+	std::vector < int >().swap( m_previousFirstCellVertex );
+	std::vector < int >().swap( m_previousSizeCell );
+	m_ptsLocalMax.clear();
+
+	computeHistograms();
+	forceRegenerateSelection();
+	QTime test = QTime();
+	test = test.addMSecs( timer.elapsed() );
+	std::cout << "Ending update of the voronoi diagram, elapsed time [" << test.hour() << ":" << test.minute() << ":" << test.second() << ":" << test.msec() << "] (h:min:s:ms)" << std::endl;
+	return true;
 }
 
 void WrapperVoronoiDiagram::draw() const
 {
+	if( m_triangleIndexes == NULL )
+		generateDisplayBuffers();
 	glPushMatrix();
 	if( m_selected ){
 		glDisable( GL_CULL_FACE );
-		if( m_filled ){
-			glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
-			glEnable(GL_BLEND);
-			glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-			glEnableClientState( GL_VERTEX_ARRAY );
-			glEnableClientState( GL_COLOR_ARRAY );
-			glVertexPointer( 2, GL_FLOAT, 0, m_trianglesCell );
-			glColorPointer( 4, GL_FLOAT, 0, m_colorsTriangle );
-			glDrawArrays( GL_TRIANGLES, 0, m_nbVertForTriangles );
-			glDisableClientState( GL_VERTEX_ARRAY );
-			glDisableClientState( GL_COLOR_ARRAY );
-			glDisable(GL_BLEND);
-		}
-		else{
-			glEnable(GL_BLEND);
-			glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-			glEnableClientState( GL_VERTEX_ARRAY );
-			glEnableClientState( GL_COLOR_ARRAY );
-			glVertexPointer( 2, GL_FLOAT, 0, m_linesCell );
-			glColorPointer( 4, GL_FLOAT, 0, m_colorsLine );
-			glDrawArrays( GL_LINES, 0, m_nbVertForLines );
-			glDisableClientState( GL_VERTEX_ARRAY );
-			glDisableClientState( GL_COLOR_ARRAY );
-			glDisable(GL_BLEND);
+		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+		glEnable(GL_BLEND);
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, 0, m_voronoiVertices );
+		//One draw call per color level, the unselected cells are not part of the index buffers
+		const unsigned int * indexes = ( m_filled ) ? m_triangleIndexes : m_lineIndexes;
+		const int * firstLevel = ( m_filled ) ? m_firstTriangleLevel : m_firstLineLevel;
+		for( int n = 0; n < NB_COLOR_LEVELS; n++ ){
+			int nb = firstLevel[n + 1] - firstLevel[n];
+			if( nb == 0 ) continue;
+			glColor4fv( m_levelColors[n].ptr() );
+			glDrawElements( ( m_filled ) ? GL_TRIANGLES : GL_LINES, nb, GL_UNSIGNED_INT, indexes + firstLevel[n] );
 		}
+		glDisableClientState( GL_VERTEX_ARRAY );
+		glDisable(GL_BLEND);
 
 		glColor3ub(0, 255, 0);
 		glBegin(GL_POINTS);
@@ -171,14 +409,20 @@ void WrapperVoronoiDiagram::draw() const
 void WrapperVoronoiDiagram::generateDisplay()
 {
 	m_nbMolecules = 0;
-	for( Delaunay_triangulation_2::Finite_vertices_iterator it = m_delau.finite_vertices_begin(); it != m_delau.finite_vertices_end(); it++, m_nbMolecules++ )
+	m_moleculeToPoint.resize( m_delau.number_of_vertices() );
+	m_pointToMolecule.assign( m_nbOriginalPoints, -1 );
+	m_infos.resize( m_delau.number_of_vertices() );
+	for( Delaunay_triangulation_2::Finite_vertices_iterator it = m_delau.finite_vertices_begin(); it != m_delau.finite_vertices_end(); it++, m_nbMolecules++ ){
+		m_moleculeToPoint[m_nbMolecules] = it->info();
+		m_pointToMolecule[it->info()] = m_nbMolecules;
 		it->info() = m_nbMolecules;
-	if( m_infos != NULL )
-		delete [] m_infos;
-	m_infos = new MoleculeInfos[m_nbMolecules];
+		m_infos.setMolecule( m_nbMolecules, it );
+	}
 
+	//Once the molecules are indexed, every pass below is independent per molecule and runs in parallel,
+	//the progress bar is only updated by the master thread
 	unsigned int cptProgressB = 0;
-	GeneralTools::m_imw->m_progress->setMaximum( 7 * m_nbMolecules );
+	GeneralTools::m_imw->m_progress->setMaximum( 8 * m_nbMolecules );
 	GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
 
 	double ww = m_originalWidth, hh = m_originalHeight;
@@ -187,221 +431,409 @@ void WrapperVoronoiDiagram::generateDisplay()
 	m_delau.infinite_vertex()->info() = -1;
 	//for( Delaunay_triangulation_2::All_vertices_iterator it = m_delau.all_vertices_begin(); it != m_delau.all_vertices_end(); it++ )
 		//it->info() = -1;
-	int cpt = 0, nbNeighbors = 0;
-	for( Delaunay_triangulation_2::Finite_vertices_iterator it = m_delau.finite_vertices_begin(); it != m_delau.finite_vertices_end(); it++, cpt++ ){
-		GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
-		//it->info() = cpt;
-		Delaunay_triangulation_2::Edge_circulator first = m_delau.incident_edges( it ), current = first;
-		do{
-			nbNeighbors++;
-			current++;
-		}while( current != first );
-	}
-	//std::cout << "True nb = " << cpt;
-	m_edgesVoronoiPolygons = new EdgeCirc[nbNeighbors];
-	int realNbNeighs = 0;
-	EdgeCirc * ptrN = m_edgesVoronoiPolygons;
-	cpt = 1;
-	for( Delaunay_triangulation_2::Finite_vertices_iterator it = m_delau.finite_vertices_begin(); it != m_delau.finite_vertices_end(); it++, cpt++ ){
-		GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
-		int nb = 0;
-		Delaunay_triangulation_2::Edge_circulator first = m_delau.incident_edges( it ), current = first;
-		do{
-			Delaunay_triangulation_2::Edge e = *current;
-			if( !m_delau.is_infinite( *current ) ){
-				ptrN[nb++] = current;
-			}
-			current++;
-		}while( current != first );
-		unsigned int index = it->info();
-		m_infos[index].setNeighborsInfos(ptrN, nb);
-		realNbNeighs += nb;
-		ptrN += nb;
-	}
+	m_neighborGraph.build( m_delau, m_infos );
+	const int * firstNeighbors = m_neighborGraph.getOffsets();
+	int nbTotalNeighbors = m_neighborGraph.nbEdges();
+	//After an update, the molecules farther than the maximum rank from a changed one keep their previous densities
+	std::vector < int > previous;
+	if( !m_pointToPrevious.empty() )
+		findUnchangedMolecules( previous );
+	GeneralTools::m_imw->m_progress->setValue( cptProgressB += 2 * m_nbMolecules );
 
-	int trueTotal = 0;
-	Iso_rectangle_2 bbox( 0, 0, ww, hh );
+	//A cell has at most one vertex per neighbor plus the ones added by the clipping
 	int * firstVertexVoronoi = new int[m_nbMolecules];
 	int * sizeVerticesVoronoi = new int[m_nbMolecules];
-
-	m_selection = new bool[m_nbMolecules];
 	for( int n = 0; n < m_nbMolecules; n++ )
-		m_selection[n] = true;
+		firstVertexVoronoi[n] = firstNeighbors[n] + n * VoronoiCellBuilder::MAX_ADDED_BY_CLIPPING;
+
+	m_selection.resize( m_nbMolecules, true );
 
-	Vec2mf * verticesTmp = new Vec2mf[4 * ( 3*m_nbMolecules-6 )];
-	int initialSizeArrayForLines = 2 * 4 * ( 3*m_nbMolecules-6 );
-	Vec2mf * ptr = verticesTmp;
-	int nbTotalVertexVoronoi = 0;
+	Vec2mf * verticesTmp = new Vec2mf[nbTotalNeighbors + m_nbMolecules * VoronoiCellBuilder::MAX_ADDED_BY_CLIPPING];
+	int * facesTmp = new int[nbTotalNeighbors + m_nbMolecules * VoronoiCellBuilder::MAX_ADDED_BY_CLIPPING];
 	m_nbFiniteTriangles = m_delau.number_of_faces();
-	m_areaTriangles = new double[m_nbFiniteTriangles];
-	cpt = 0;
+	m_faceAreas = new float[m_nbFiniteTriangles];
+	m_faceMaxEdgesSqr = new float[m_nbFiniteTriangles];
+	m_faceMinDensities = new LocReal[m_nbFiniteTriangles];
+	std::vector < FaceHandle > faces( m_nbFiniteTriangles );
+	//After an update, new index of the faces of the previous triangulation that were kept (see update)
+	std::vector < int > newFaces;
+	if( !m_pointToPrevious.empty() )
+		newFaces.assign( m_previousNbFaces, -1 );
+	int cpt = 0;
 	for( Delaunay_triangulation_2::Finite_faces_iterator it = m_delau.finite_faces_begin(); it != m_delau.finite_faces_end(); it++, cpt++ ){
-		GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
+		if( !newFaces.empty() && it->info() >= 0 && it->info() < m_previousNbFaces )
+			newFaces[it->info()] = cpt;
 		it->info() = cpt;
-		m_areaTriangles[cpt] = Geometry::getTriangleArea( it->vertex( 0 ), it->vertex( 1 ), it->vertex(2 ) );
+		faces[cpt] = it;
 	}
-	cpt = 0;
-	double maxArea = 0., maxMeanD = 0.;
-	for( Delaunay_triangulation_2::Finite_vertices_iterator it = m_delau.finite_vertices_begin(); it != m_delau.finite_vertices_end(); it++/*, cpt++*/ ){
-		GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
-		cpt = it->info();
-		MoleculeInfos * info = &m_infos[cpt];
-		firstVertexVoronoi[cpt] = nbTotalVertexVoronoi;
-		int nbFaces = 0;
-		const K::Segment_2 * segment_ptr;
-		float area = 0.f, meanDistance = 0.;
-		for( int n = 0; n < m_infos[cpt].nbEdges(); n++ ){
-			CGAL::Object dual = m_delau.dual( *info->getEdge( n ) );
-			if ( ( segment_ptr = CGAL::object_cast < typename K::Segment_2 >( &dual ) ) ){
-				if( !bbox.has_on_bounded_side( segment_ptr->source() ) || ! bbox.has_on_bounded_side( segment_ptr->target() ) ){
-					CGAL::Object obj = CGAL::intersection( *segment_ptr, bbox );
-					const Segment_2 * s = CGAL::object_cast < Segment_2 >( &obj );
-					if( s ){
-						( *ptr++ ).set( s->target().x(), s->target().y() );
-						trueTotal++;
-						nbFaces++;
-					}
-				}
-				else{
-					( *ptr++ ).set( segment_ptr->target().x(), segment_ptr->target().y() );
-					trueTotal++;
-					nbFaces++;
+#pragma omp parallel for
+	for( int n = 0; n < m_nbFiniteTriangles; n++ ){
+		const Point_2 & p0 = faces[n]->vertex( 0 )->point(), & p1 = faces[n]->vertex( 1 )->point(), & p2 = faces[n]->vertex( 2 )->point();
+		m_faceAreas[n] = Geometry::getTriangleArea( faces[n]->vertex( 0 ), faces[n]->vertex( 1 ), faces[n]->vertex( 2 ) );
+		m_faceMaxEdgesSqr[n] = std::max( CGAL::squared_distance( p0, p1 ), std::max( CGAL::squared_distance( p0, p2 ), CGAL::squared_distance( p1, p2 ) ) );
+	}
+	GeneralTools::m_imw->m_progress->setValue( cptProgressB += m_nbMolecules );
+
+	//After an update, the molecules whose neighbors did not change keep their cell, area and mean distance
+	VoronoiCellBuilder cells( m_delau, faces, ww, hh );
+	ThrottledProgress progressCells( cptProgressB, m_nbMolecules );
+	int nbKeptCells = 0;
+#pragma omp parallel
+	{
+		std::vector < double > scratch;
+#pragma omp for schedule(dynamic, 256) reduction(+:nbKeptCells)
+		for( int cpt = 0; cpt < m_nbMolecules; cpt++ ){
+			progressCells.update( cpt );
+			if( !newFaces.empty() && !m_changedPoints[m_moleculeToPoint[cpt]] ){
+				int previous = m_pointToPrevious[m_moleculeToPoint[cpt]];
+				if( previous >= 0 && copyPreviousCell( previous, newFaces, cells.getCircumcenters(), verticesTmp + firstVertexVoronoi[cpt], facesTmp + firstVertexVoronoi[cpt] ) ){
+					sizeVerticesVoronoi[cpt] = m_previousSizeCell[previous];
+					m_infos.setData( MoleculeInfos::Area, cpt, m_previousInfos.getData( MoleculeInfos::Area, previous ) );
+					m_infos.setData( MoleculeInfos::MeanDistance, cpt, m_previousInfos.getData( MoleculeInfos::MeanDistance, previous ) );
+					nbKeptCells++;
+					continue;
 				}
 			}
+			VertHandle molecule = m_infos.getMolecule( cpt );
+			float area = 0.f, meanDistance = 0.;
+			sizeVerticesVoronoi[cpt] = cells.computeCell( molecule, verticesTmp + firstVertexVoronoi[cpt], facesTmp + firstVertexVoronoi[cpt], scratch );
+			double xc = molecule->point().x(), yc = molecule->point().y();
+			for( int n = 0; n < sizeVerticesVoronoi[cpt]; n++ ){
+				int index1 = firstVertexVoronoi[cpt] + n, index2 = firstVertexVoronoi[cpt] + ( ( n + 1 ) % sizeVerticesVoronoi[cpt] );
+				area += Geometry::getTriangleArea( xc, yc, verticesTmp[index1].x(), verticesTmp[index1].y(), verticesTmp[index2].x(), verticesTmp[index2].y() );
+				meanDistance += sqrt( ( verticesTmp[index1].x() - xc ) * ( verticesTmp[index1].x() - xc ) + ( verticesTmp[index1].y() - yc ) * ( verticesTmp[index1].y() - yc ) );
+			}
+			if( sizeVerticesVoronoi[cpt] > 0 )
+				meanDistance /= ( float )sizeVerticesVoronoi[cpt];
+			m_infos.setData( MoleculeInfos::Area, cpt, area );
+			m_infos.setData( MoleculeInfos::MeanDistance, cpt, meanDistance );
 		}
-		sizeVerticesVoronoi[cpt] = nbFaces;
-		nbTotalVertexVoronoi += nbFaces;
-		double xc = it->point().x(), yc = it->point().y();
-		for( int n = 0; n < sizeVerticesVoronoi[cpt]; n++ ){
-			int index1 = firstVertexVoronoi[cpt] + n, index2 = firstVertexVoronoi[cpt] + ( ( n + 1 ) % sizeVerticesVoronoi[cpt] );
-			area += Geometry::getTriangleArea( xc, yc, verticesTmp[index1].x(), verticesTmp[index1].y(), verticesTmp[index2].x(), verticesTmp[index2].y() );
-			meanDistance += sqrt( ( verticesTmp[index1].x() - xc ) * ( verticesTmp[index1].x() - xc ) + ( verticesTmp[index1].y() - yc ) * ( verticesTmp[index1].y() - yc ) );
-		}
-		meanDistance /= ( float )sizeVerticesVoronoi[cpt];
-		info->setData( MoleculeInfos::Area, area );
-		info->setData( MoleculeInfos::MeanDistance, meanDistance );
-		info->setDataLog( MoleculeInfos::Area, MiscFunction::log10Custom( area ) );
-		info->setDataLog( MoleculeInfos::MeanDistance, MiscFunction::log10Custom( meanDistance ) );
-		info->setMolecule( it );
-		if( area > maxArea )
-			maxArea = area;
-		if( meanDistance > maxMeanD )
-			maxMeanD = meanDistance;
-	}
-	m_area = 0.;
-	for( Delaunay_triangulation_2::Finite_vertices_iterator it = m_delau.finite_vertices_begin(); it != m_delau.finite_vertices_end(); it++ ){
-		GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
-		int currentMolecule = it->info();
-		if( m_infos[currentMolecule].getData( MoleculeInfos::Area ) == 0. ){
-			m_infos[currentMolecule].setData( MoleculeInfos::Area, maxArea );
-			m_infos[currentMolecule].setDataLog( MoleculeInfos::Area, MiscFunction::log10Custom( maxArea ) );
-		}
-		if( m_infos[currentMolecule].getData( MoleculeInfos::MeanDistance ) == 0. ){
-			m_infos[currentMolecule].setData( MoleculeInfos::MeanDistance, maxMeanD );
-			m_infos[currentMolecule].setDataLog( MoleculeInfos::MeanDistance, MiscFunction::log10Custom( maxMeanD ) );
-		}
-		m_area += m_infos[currentMolecule].getData( MoleculeInfos::Area );
 	}
+	cptProgressB += m_nbMolecules;
+	if( !newFaces.empty() )
+		std::cout << "Cells kept for " << nbKeptCells << " of the " << m_nbMolecules << " molecules" << std::endl;
+	double maxArea = 0., maxMeanD = 0.;
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		if( m_infos.getData( MoleculeInfos::Area, n ) > maxArea )
+			maxArea = m_infos.getData( MoleculeInfos::Area, n );
+		if( m_infos.getData( MoleculeInfos::MeanDistance, n ) > maxMeanD )
+			maxMeanD = m_infos.getData( MoleculeInfos::MeanDistance, n );
+	}
+	double area = 0.;
+#pragma omp parallel for reduction(+:area)
+	for( int currentMolecule = 0; currentMolecule < m_nbMolecules; currentMolecule++ ){
+		if( m_infos.getData( MoleculeInfos::Area, currentMolecule ) == 0. )
+			m_infos.setData( MoleculeInfos::Area, currentMolecule, maxArea );
+		if( m_infos.getData( MoleculeInfos::MeanDistance, currentMolecule ) == 0. )
+			m_infos.setData( MoleculeInfos::MeanDistance, currentMolecule, maxMeanD );
+		area += m_infos.getData( MoleculeInfos::Area, currentMolecule );
+	}
+	m_area = area;
+	//The empty cells take the maximum area, the densities can only be kept if it did not change
+	const int * previousMolecules = ( !previous.empty() && maxArea == m_maxArea ) ? &previous[0] : NULL;
+	m_maxArea = maxArea;
+	m_infos.computeLog( MoleculeInfos::Area );
+	m_infos.computeLog( MoleculeInfos::MeanDistance );
+	GeneralTools::m_imw->m_progress->setValue( cptProgressB += m_nbMolecules );
 
 	double delta = ( double )m_nbMolecules / ( m_originalWidth * m_originalHeight );
 
 	// Version of local density: adding all area of the seed and its rank-1 neighbors
-	for( Delaunay_triangulation_2::Finite_vertices_iterator it = m_delau.finite_vertices_begin(); it != m_delau.finite_vertices_end(); it++ ){
-		GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
-		MoleculeInfos * info = &m_infos[it->info()];
-		Delaunay_triangulation_2::Edge_circulator first = m_delau.incident_edges( it ), current = first;
-		double totalArea = info->getData( MoleculeInfos::Area ), nb = 1. + info->nbEdges();
-		for( int n = 0; n < info->nbEdges(); n++ ){
-			VertHandle other = info->getNeighbor( n );
-			totalArea += m_infos[other->info()].getData( MoleculeInfos::Area );
+	ThrottledProgress progressDensity( cptProgressB, m_nbMolecules );
+#pragma omp parallel for schedule(dynamic, 256)
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		progressDensity.update( n );
+		if( previousMolecules != NULL && previousMolecules[n] >= 0 ){
+			m_infos.setData( MoleculeInfos::LocalDensity, n, m_previousInfos.getData( MoleculeInfos::LocalDensity, previousMolecules[n] ) );
+			continue;
 		}
-		double localD = nb / totalArea;
-		info->setData( MoleculeInfos::LocalDensity, localD );
-		info->setDataLog( MoleculeInfos::LocalDensity, MiscFunction::log10Custom( localD ) );
-	}
-
-	Vec2mf * verticesDelaunay;
-	if( trueTotal == nbTotalVertexVoronoi )
-		verticesDelaunay = verticesTmp;
-	else{
-		verticesDelaunay = new Vec2mf[trueTotal];
-		memcpy( verticesDelaunay, verticesTmp, trueTotal * sizeof( Vec2mf ) );
-		delete [] verticesTmp;
-		nbTotalVertexVoronoi = trueTotal;
-	}
-
-	for( int n = 0; n < nbTotalVertexVoronoi; n++ )
-		verticesDelaunay[n].set( verticesDelaunay[n].x() / m_originalWidth, verticesDelaunay[n].y() / m_originalHeight );
-
-	m_nbVertForLines = nbTotalVertexVoronoi*2;
-	m_linesCell = new Vec2mf[m_nbVertForLines];
-	m_firstVerticesLine = new int[m_nbMolecules];
-	m_sizeVerticesLine = new int[m_nbMolecules];
-	m_nbVertForTriangles = nbTotalVertexVoronoi*3;
-	m_trianglesCell = new Vec2mf[m_nbVertForTriangles];
-	m_firstVerticesTriangle = new int[m_nbMolecules];
-	m_sizeVerticesTriangle = new int[m_nbMolecules];
-	int cptTriangle = 0;
-	cpt = 0;
-	Vec2mf * ptrLine = m_linesCell, * ptrTriangle = m_trianglesCell;
+		const LocReal * areas = m_infos.getColumn( MoleculeInfos::Area );
+		const int * neighbors = m_neighborGraph.neighbors( n );
+		int nbNeighbors = m_neighborGraph.nbNeighbors( n );
+		double totalArea = areas[n], nb = 1. + nbNeighbors;
+		for( int i = 0; i < nbNeighbors; i++ )
+			totalArea += areas[neighbors[i]];
+		m_infos.setData( MoleculeInfos::LocalDensity, n, nb / totalArea );
+	}
+	m_infos.computeLog( MoleculeInfos::LocalDensity );
+	const LocReal * densities = m_infos.getColumn( MoleculeInfos::LocalDensity );
+#pragma omp parallel for
+	for( int n = 0; n < m_nbFiniteTriangles; n++ ){
+		int i0 = faces[n]->vertex( 0 )->info(), i1 = faces[n]->vertex( 1 )->info(), i2 = faces[n]->vertex( 2 )->info();
+		m_faceMinDensities[n] = std::min( densities[i0], std::min( densities[i1], densities[i2] ) );
+	}
+	cptProgressB += m_nbMolecules;
+
+	generateRankDensities( cptProgressB, previousMolecules );
+	cptProgressB += m_nbMolecules;
+
+	//The cells are kept as indexes in a mesh of unique Voronoi vertices: the circumcenters of the faces, then the
+	//vertices created by the clipping and then the molecules, used as the center of the triangle fans
+	int * firstClipped = new int[m_nbMolecules + 1];
+	firstClipped[0] = 0;
+	m_firstCellVertex = new int[m_nbMolecules];
+	m_sizeCell = sizeVerticesVoronoi;
+	m_nbCellVertices = 0;
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		m_firstCellVertex[n] = m_nbCellVertices;
+		m_nbCellVertices += m_sizeCell[n];
+		int nbClipped = 0;
+		for( int i = 0; i < m_sizeCell[n]; i++ )
+			if( facesTmp[firstVertexVoronoi[n] + i] < 0 )
+				nbClipped++;
+		firstClipped[n + 1] = firstClipped[n] + nbClipped;
+	}
+	m_nbVoronoiVertices = m_nbFiniteTriangles + firstClipped[m_nbMolecules] + m_nbMolecules;
+	m_voronoiVertices = new Vec2mf[m_nbVoronoiVertices];
+	m_cellIndexes = new unsigned int[m_nbCellVertices];
+	const double * circumcenters = cells.getCircumcenters();
+#pragma omp parallel for
+	for( int n = 0; n < m_nbFiniteTriangles; n++ )
+		m_voronoiVertices[n].set( circumcenters[2 * n] / m_originalWidth, circumcenters[2 * n + 1] / m_originalHeight );
+#pragma omp parallel for schedule(dynamic, 256)
 	for( int n = 0; n < m_nbMolecules; n++ ){
-		GeneralTools::m_imw->m_progress->setValue( cptProgressB++ );
-		m_firstVerticesLine[n] = cpt;
-		m_firstVerticesTriangle[n] = cptTriangle;
-		double x = m_infos[n].getMolecule()->point().x() / m_originalWidth, y = m_infos[n].getMolecule()->point().y() / m_originalHeight;
-		for( int i = 0; i < sizeVerticesVoronoi[n]; i++ ){
-			int indexC = firstVertexVoronoi[n] + i, indexN = firstVertexVoronoi[n] + ( ( i + 1 ) % sizeVerticesVoronoi[n] );
-			( *ptrLine++ ).set( verticesDelaunay[indexC].x(), verticesDelaunay[indexC].y() );
-			( *ptrLine++ ).set( verticesDelaunay[indexN].x(), verticesDelaunay[indexN].y() );
-			( *ptrTriangle++ ).set( verticesDelaunay[indexC].x(), verticesDelaunay[indexC].y() );
-			( *ptrTriangle++ ).set( verticesDelaunay[indexN].x(), verticesDelaunay[indexN].y() );
-			( *ptrTriangle++ ).set( x, y );
+		int clipped = m_nbFiniteTriangles + firstClipped[n];
+		for( int i = 0; i < m_sizeCell[n]; i++ ){
+			int index = facesTmp[firstVertexVoronoi[n] + i];
+			if( index < 0 ){
+				const Vec2mf & v = verticesTmp[firstVertexVoronoi[n] + i];
+				m_voronoiVertices[clipped].set( v.x() / m_originalWidth, v.y() / m_originalHeight );
+				index = clipped++;
+			}
+			m_cellIndexes[m_firstCellVertex[n] + i] = index;
 		}
-		cpt += sizeVerticesVoronoi[n] * 2;
-		m_sizeVerticesLine[n] = sizeVerticesVoronoi[n] * 2;
-		cptTriangle += sizeVerticesVoronoi[n] * 3;
-		m_sizeVerticesTriangle[n] = sizeVerticesVoronoi[n] * 3;
+		VertHandle molecule = m_infos.getMolecule( n );
+		m_voronoiVertices[getSeedVertex( n )].set( molecule->point().x() / m_originalWidth, molecule->point().y() / m_originalHeight );
 	}
-	m_colorsLine = new Color4D[m_nbVertForLines];
-	m_colorsTriangle = new Color4D[m_nbVertForTriangles];
+	GeneralTools::m_imw->m_progress->setValue( cptProgressB += m_nbMolecules );
 
-	delete [] verticesDelaunay;
+	delete [] verticesTmp;
+	delete [] facesTmp;
+	delete [] firstClipped;
 	delete [] firstVertexVoronoi;
-	delete [] sizeVerticesVoronoi;
 
 	/******* Computation of the stats for the moleculeInfos ************/
-	m_stats = new ArrayStatistics[MoleculeInfos::NB_DATATYPE];
-	double ** datas = new double *[MoleculeInfos::NB_DATATYPE];
-	for( int n = 0; n < MoleculeInfos::NB_DATATYPE; n++ )
-		datas[n] = new double[m_nbMolecules];
-	for( int n = 0; n < MoleculeInfos::NB_DATATYPE; n++ )
-		for( int i = 0; i < m_nbMolecules; i++ )
-			datas[n][i] = m_infos[i].getData( n );
-	for( int n = 0; n < MoleculeInfos::NB_DATATYPE; n++ ){
-		m_stats[n] = GeneralTools::generateArrayStatistics( datas[n], m_nbMolecules );
-		delete [] datas[n];
-	}
-	delete [] datas;
+	m_stats = new ArrayStatistics[m_infos.nbFeatures()];
+	for( int n = 0; n < m_infos.nbFeatures(); n++ )
+		m_stats[n] = GeneralTools::generateArrayStatistics( m_infos.getColumn( n ), m_nbMolecules );
 	/******************************************************************/
 }
 
-void WrapperVoronoiDiagram::regenerateIntensityColorVector()
+//Set of molecule indexes with open addressing and linear probing, sized by the molecules reached from one seed and
+//not by the diagram: only the slots used are cleared between two seeds
+class MoleculeSet{
+public:
+	MoleculeSet():m_table( 64, -1 ){}
+
+	bool insert( const int _idx )
+	{
+		if( 2 * ( m_used.size() + 1 ) > m_table.size() )
+			grow();
+		unsigned int mask = m_table.size() - 1, slot = ( ( unsigned int )_idx * 2654435761u ) & mask;
+		while( m_table[slot] != -1 ){
+			if( m_table[slot] == _idx ) return false;
+			slot = ( slot + 1 ) & mask;
+		}
+		m_table[slot] = _idx;
+		m_used.push_back( slot );
+		return true;
+	}
+	void clear()
+	{
+		for( unsigned int n = 0; n < m_used.size(); n++ )
+			m_table[m_used[n]] = -1;
+		m_used.clear();
+	}
+
+protected:
+	void grow()
+	{
+		std::vector < int > values;
+		for( unsigned int n = 0; n < m_used.size(); n++ )
+			values.push_back( m_table[m_used[n]] );
+		m_table.assign( 2 * m_table.size(), -1 );
+		m_used.clear();
+		for( unsigned int n = 0; n < values.size(); n++ )
+			insert( values[n] );
+	}
+
+protected:
+	std::vector < int > m_table;
+	std::vector < unsigned int > m_used;
+};
+
+//Local density of rank k: number of molecules reached in at most k steps in the neighbor graph, seed included, divided
+//by the sum of their areas. All the ranks above 1 are accumulated by a single bounded BFS per molecule, the molecules
+//visited from a seed are kept in a small set of the thread, cleared for the next seed. Nothing is done at the default
+//maximum rank of 1, the higher ranks are only computed when asked for in the construction panel
+void WrapperVoronoiDiagram::generateRankDensities( const int _offsetProgress, const int * _previous )
+{
+	if( m_maxDensityRank < 2 ) return;
+	for( int rank = 2; rank <= m_maxDensityRank; rank++ )
+		m_infos.addFeature();
+	const LocReal * areas = m_infos.getColumn( MoleculeInfos::Area );
+	ThrottledProgress progress( _offsetProgress, m_nbMolecules );
+#pragma omp parallel
+	{
+		MoleculeSet visited;
+		std::vector < int > frontier, next;
+#pragma omp for schedule(dynamic, 256)
+		for( int n = 0; n < m_nbMolecules; n++ ){
+			progress.update( n );
+			if( _previous != NULL && _previous[n] >= 0 ){
+				for( int rank = 2; rank <= m_maxDensityRank; rank++ )
+					m_infos.setData( getDensityFeature( rank ), n, m_previousInfos.getData( getDensityFeature( rank ), _previous[n] ) );
+				continue;
+			}
+			visited.clear();
+			visited.insert( n );
+			frontier.assign( 1, n );
+			double nb = 1., totalArea = areas[n];
+			for( int rank = 1; rank <= m_maxDensityRank; rank++ ){
+				next.clear();
+				for( unsigned int i = 0; i < frontier.size(); i++ ){
+					const int * neighbors = m_neighborGraph.neighbors( frontier[i] );
+					for( int j = 0; j < m_neighborGraph.nbNeighbors( frontier[i] ); j++ ){
+						int other = neighbors[j];
+						if( !visited.insert( other ) ) continue;
+						next.push_back( other );
+						totalArea += areas[other];
+					}
+				}
+				nb += next.size();
+				if( rank >= 2 )
+					m_infos.setData( getDensityFeature( rank ), n, nb / totalArea );
+				frontier.swap( next );
+			}
+		}
+	}
+	for( int rank = 2; rank <= m_maxDensityRank; rank++ )
+		m_infos.computeLog( getDensityFeature( rank ) );
+}
+
+//Cell of a molecule of the previous diagram whose Delaunay neighbors did not change: its faces are the same, only their
+//indexes changed. Returns false for the empty and the clipped cells, they are computed again
+bool WrapperVoronoiDiagram::copyPreviousCell( const int _previous, const std::vector < int > & _newFaces, const double * _circumcenters, Vec2mf * _cell, int * _faces ) const
+{
+	int nb = m_previousSizeCell[_previous];
+	if( nb == 0 ) return false;
+	const unsigned int * cell = &m_previousCellIndexes[m_previousFirstCellVertex[_previous]];
+	for( int n = 0; n < nb; n++ ){
+		if( cell[n] >= ( unsigned int )m_previousNbFaces || _newFaces[cell[n]] < 0 ) return false;
+		int face = _newFaces[cell[n]];
+		_cell[n].set( _circumcenters[2 * face], _circumcenters[2 * face + 1] );
+		_faces[n] = face;
+	}
+	return true;
+}
+
+//Multi-source BFS from the molecules whose Delaunay neighbors changed during an update, bounded by the maximum rank of
+//the densities. The molecules it does not reach get their previous index, the other ones -1
+void WrapperVoronoiDiagram::findUnchangedMolecules( std::vector < int > & _previous ) const
 {
-	Color4D * ptrCLine = m_colorsLine, * ptrCTriangle = m_colorsTriangle;
-	long current = 0;
+	int depth = std::max( 1, m_maxDensityRank );
+	std::vector < int > frontier, next;
+	std::vector < bool > reached( m_nbMolecules, false );
+	for( int n = 0; n < m_nbMolecules; n++ )
+		if( m_changedPoints[m_moleculeToPoint[n]] ){
+			reached[n] = true;
+			frontier.push_back( n );
+		}
+	for( int rank = 1; rank <= depth && !frontier.empty(); rank++ ){
+		next.clear();
+		for( unsigned int i = 0; i < frontier.size(); i++ ){
+			const int * neighbors = m_neighborGraph.neighbors( frontier[i] );
+			for( int j = 0; j < m_neighborGraph.nbNeighbors( frontier[i] ); j++ ){
+				if( reached[neighbors[j]] ) continue;
+				reached[neighbors[j]] = true;
+				next.push_back( neighbors[j] );
+			}
+		}
+		frontier.swap( next );
+	}
+	_previous.assign( m_nbMolecules, -1 );
+	int nbUnchanged = 0;
+	for( int n = 0; n < m_nbMolecules; n++ )
+		if( !reached[n] ){
+			_previous[n] = m_pointToPrevious[m_moleculeToPoint[n]];
+			nbUnchanged++;
+		}
+	std::cout << "Densities kept for " << nbUnchanged << " of the " << m_nbMolecules << " molecules" << std::endl;
+}
+
+//Triangles of the cell of a molecule in normalized coordinates, three vertices per side of the cell
+void WrapperVoronoiDiagram::getCellTriangles( const int _idx, Vec2mf * _triangles ) const
+{
+	const unsigned int * cell = m_cellIndexes + m_firstCellVertex[_idx];
+	int nb = m_sizeCell[_idx];
+	const Vec2mf & seed = m_voronoiVertices[getSeedVertex( _idx )];
+	for( int i = 0; i < nb; i++ ){
+		*_triangles++ = m_voronoiVertices[cell[i]];
+		*_triangles++ = m_voronoiVertices[cell[( i + 1 ) % nb]];
+		*_triangles++ = seed;
+	}
+}
+
+void WrapperVoronoiDiagram::generateDisplayBuffers() const
+{
+	m_lineIndexes = new unsigned int[2 * m_nbCellVertices];
+	m_triangleIndexes = new unsigned int[3 * m_nbCellVertices];
+	regenerateIntensityColorVector();
+}
+
+//The cells are sorted by color level in the index buffers, so a color update is one pass over the cells
+void WrapperVoronoiDiagram::regenerateIntensityColorVector() const
+{
+	if( m_triangleIndexes == NULL ) return;
 	double minI = m_histograms[m_typeHistogram]->getMinH(), inter = m_histograms[m_typeHistogram]->getMaxH() - minI;
-	double sizeImage = 500.;
 	bool logHist = m_histograms[m_typeHistogram]->isLog();
+	//Palette::getColor gives the first color outside of [0, 1], as the first level
+	for( int n = 0; n < NB_COLOR_LEVELS; n++ ){
+		QColor color_tmp = m_palette->getColor( ( double )n / ( double )( NB_COLOR_LEVELS - 1 ) );
+		m_levelColors[n].set( color_tmp.redF(), color_tmp.greenF(), color_tmp.blueF(), color_tmp.alphaF() );
+	}
+	std::vector < int > levels( m_nbMolecules );
+#pragma omp parallel for
 	for( int n = 0; n < m_nbMolecules; n++ ){
-		MoleculeInfos * mi = &m_infos[n];
-		double val = ( logHist ) ? mi->getDataLog( m_typeHistogram ) : mi->getData( m_typeHistogram );
+		if( !m_selection[n] ){
+			levels[n] = -1;
+			continue;
+		}
+		double val = ( logHist ) ? m_infos.getDataLog( m_typeHistogram, n ) : m_infos.getData( m_typeHistogram, n );
 		val = ( val - minI ) / inter;
-		QColor color_tmp = m_palette->getColor( val );
-		float alpha = ( m_selection[n] ) ? color_tmp.alphaF() : 0.f;
-		for( int nc = 0; nc < m_sizeVerticesLine[n]; nc++ )
-			( *ptrCLine++ ).set( color_tmp.redF(), color_tmp.greenF(), color_tmp.blueF(), alpha );
-		for( int nc = 0; nc < m_sizeVerticesTriangle[n]; nc++ )
-			( *ptrCTriangle++ ).set( color_tmp.redF(), color_tmp.greenF(), color_tmp.blueF(), alpha );
+		levels[n] = ( val >= 0. && val <= 1. ) ? ( int )( val * ( NB_COLOR_LEVELS - 1 ) + 0.5 ) : 0;
+	}
+	int nbCellVertices[NB_COLOR_LEVELS + 1];
+	memset( nbCellVertices, 0, ( NB_COLOR_LEVELS + 1 ) * sizeof( int ) );
+	for( int n = 0; n < m_nbMolecules; n++ )
+		if( levels[n] >= 0 )
+			nbCellVertices[levels[n] + 1] += m_sizeCell[n];
+	for( int n = 0; n < NB_COLOR_LEVELS; n++ )
+		nbCellVertices[n + 1] += nbCellVertices[n];
+	for( int n = 0; n <= NB_COLOR_LEVELS; n++ ){
+		m_firstLineLevel[n] = 2 * nbCellVertices[n];
+		m_firstTriangleLevel[n] = 3 * nbCellVertices[n];
+	}
+	std::vector < int > firstInLevel( m_nbMolecules );
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		if( levels[n] < 0 ) continue;
+		firstInLevel[n] = nbCellVertices[levels[n]];
+		nbCellVertices[levels[n]] += m_sizeCell[n];
+	}
+#pragma omp parallel for schedule(dynamic, 256)
+	for( int n = 0; n < m_nbMolecules; n++ ){
+		if( levels[n] < 0 ) continue;
+		const unsigned int * cell = m_cellIndexes + m_firstCellVertex[n];
+		unsigned int * ptrLine = m_lineIndexes + 2 * firstInLevel[n], * ptrTriangle = m_triangleIndexes + 3 * firstInLevel[n];
+		int nb = m_sizeCell[n];
+		for( int i = 0; i < nb; i++ ){
+			unsigned int current = cell[i], next = cell[( i + 1 ) % nb];
+			*ptrLine++ = current;
+			*ptrLine++ = next;
+			*ptrTriangle++ = current;
+			*ptrTriangle++ = next;
+			*ptrTriangle++ = getSeedVertex( n );
+		}
 	}
 }
 
@@ -421,19 +853,13 @@ void WrapperVoronoiDiagram::determineSelection( const bool resetSelectionByUser
 		m_histograms[m_typeHistogram]->resetBounds();
 	
 	bool isLog = m_histograms[m_typeHistogram]->isLog();
-	for( int n = 0; n < m_nbMolecules; n++ ){
-		MoleculeInfos * m = &m_infos[n];
-		double val1 = ( isLog ) ? m->getDataLog( m_typeHistogram ) : m->getData( m_typeHistogram );
-		m_selection[n] = ( m_histograms[m_typeHistogram]->getMin() <= val1 && val1 <= m_histograms[m_typeHistogram]->getMax() );
-		if( m_selection[n] )
-			m_nbSelection++;
-	}
+	m_selection.selectInRange( MoleculeDataValues( m_infos, NULL, m_typeHistogram, isLog ), m_histograms[m_typeHistogram]->getMin(), m_histograms[m_typeHistogram]->getMax() );
+	m_nbSelection = m_selection.count();
 }
 
 void WrapperVoronoiDiagram::resetDataSelection()
 {
-	for( uint i = 0; i < m_nbMolecules; i++ )
-		m_selection[i] = false;
+	m_selection.clearAll();
 }
 
 void WrapperVoronoiDiagram::forceRegenerateSelection()
@@ -464,274 +890,446 @@ void WrapperVoronoiDiagram::iterativeAddCells( FaceHandle _f, FaceHandle * _allF
 	}
 }
 
-NeuronObjectList WrapperVoronoiDiagram::createVoronoiObjects(const double _minArea, const unsigned int _minLocs, const double _maxArea, const unsigned int _maxLocs, const bool _applyCutD, const double _cutDSqr, const bool _pca, const bool _watershed, const double _radiusWatershed, const double _nbLocsWatershed)
+//The objects are the connected components of the selected faces. Their area and molecules are aggregated in parallel,
+//one component per iteration, the molecules of a component being the sorted and deduplicated vertices of its faces.
+//They are kept with the selection and the cut distance they were computed for
+void WrapperVoronoiDiagram::computeSegmentationComponents( const bool _applyCutD, const double _cutDSqr )
 {
-	std::ofstream fs("d:/testV1.txt");
-
-	NeuronObjectList neuronObjects;
-	m_ptsLocalMax.clear();
-
-	bool * selectionFaces = new bool[m_delau.number_of_faces()];
-	memset( selectionFaces, 0, m_delau.number_of_faces() * sizeof( bool ) );
+	clearSegmentationCache();
+	int nbFaces = m_delau.number_of_faces();
+	bool * selectionFaces = new bool[nbFaces];
+	m_segmentationNeighbors = new int[3 * nbFaces];
+	m_segmentationFaces.resize( nbFaces );
 	int cpt = 0;
 	for( Delaunay_triangulation_2::Finite_faces_iterator it = m_delau.finite_faces_begin(); it != m_delau.finite_faces_end(); it++, cpt++ ){
 		it->info() = cpt;
-		int i0 = it->vertex( 0 )->info(), i1 = it->vertex( 1 )->info(), i2 = it->vertex( 2 )->info();
-		selectionFaces[cpt] = m_selection[i0] && m_selection[i1] && m_selection[i2];
-		if( selectionFaces[cpt] && _applyCutD ){
-			VertHandle v0 = m_infos[i0].getMolecule(), v1 = m_infos[i1].getMolecule(), v2 = m_infos[i2].getMolecule();
-			double d0 = CGAL::squared_distance( v0->point(), v1->point() ), d1 = CGAL::squared_distance( v0->point(), v2->point() ), d2 = CGAL::squared_distance( v1->point(), v2->point() );
-			selectionFaces[cpt] = !( d0 > _cutDSqr || d1 > _cutDSqr || d2 > _cutDSqr );
-		}
+		m_segmentationFaces[cpt] = it;
+	}
+#pragma omp parallel for
+	for( int n = 0; n < nbFaces; n++ ){
+		FaceHandle f = m_segmentationFaces[n];
+		int i0 = f->vertex( 0 )->info(), i1 = f->vertex( 1 )->info(), i2 = f->vertex( 2 )->info();
+		selectionFaces[n] = m_selection[i0] && m_selection[i1] && m_selection[i2];
+		if( selectionFaces[n] && _applyCutD )
+			selectionFaces[n] = m_faceMaxEdgesSqr[n] <= _cutDSqr;
+		for( int j = 0; j < 3; j++ )
+			m_segmentationNeighbors[3 * n + j] = f->neighbor( j )->info();
 	}
-	bool * selectionFacesOriginal = new bool[m_delau.number_of_faces()], *selectionFacesForOutline = new bool[m_delau.number_of_faces()];
-	memcpy( selectionFacesOriginal, selectionFaces, m_delau.number_of_faces() * sizeof( bool ) );
-	memset(selectionFacesForOutline, 0, m_delau.number_of_faces() * sizeof(bool));
-
-	FaceHandle * allFaces = new FaceHandle[m_delau.number_of_faces()], *facesWatershed = new FaceHandle[m_delau.number_of_faces()];
-	bool * selectionMolecules = new bool[m_nbMolecules];
-	memset( selectionMolecules, 0, m_nbMolecules * sizeof( bool ) );
-	unsigned int * molecules = new unsigned int[m_nbMolecules], *moleculesWaterhshed = new unsigned int[m_nbMolecules], nbMolsWatershed, nbFacesWatershed;
-
-	memset( m_selection, 0, m_nbMolecules * sizeof( bool ) );
 
-	printf("Creation of 0 Voronoi objects.");
-	for (Delaunay_triangulation_2::Finite_faces_iterator it = m_delau.finite_faces_begin(); it != m_delau.finite_faces_end(); it++){
-		int index = it->info();
-		if( !selectionFaces[index] ) continue;
-		int indexQueue = 0;
-		iterativeAddCells( it, allFaces, indexQueue, selectionFaces );
-
-		int nbMol = 0, i0, i1, i2;
-		//Now, we have a merging of triangles (not necessary all the selected triangles
-		double area = 0;
-		for( int i = 0; i < indexQueue; i++ ){
-			FaceHandle f = allFaces[i];
-			area += Geometry::getTriangleArea( f->vertex( 0 ), f->vertex( 1 ), f->vertex( 2 ) );
-			i0 = f->vertex( 0 )->info();
-			i1 = f->vertex( 1 )->info();
-			i2 = f->vertex( 2 )->info();
-			if( !selectionMolecules[i0] ){
-				selectionMolecules[i0] = true;
-				molecules[nbMol++] = i0;
-			}
-			if( !selectionMolecules[i1] ){
-				selectionMolecules[i1] = true;
-				molecules[nbMol++] = i1;
-			}
-			if( !selectionMolecules[i2] ){
-				selectionMolecules[i2] = true;
-				molecules[nbMol++] = i2;
-			}
+	m_components.build( m_segmentationNeighbors, 3, selectionFaces, nbFaces );
+	int nbComponents = m_components.nbComponents();
+	m_areaComponents.assign( nbComponents, 0. );
+	m_moleculesComponents.resize( nbComponents );
+	m_outlineComponents.resize( nbComponents );
+	m_objectComponents.assign( nbComponents, NULL );
+#pragma omp parallel for schedule(dynamic, 64)
+	for( int c = 0; c < nbComponents; c++ ){
+		const int * members = m_components.members( c );
+		double area = 0.;
+		std::vector < unsigned int > & molecules = m_moleculesComponents[c];
+		molecules.reserve( 3 * m_components.nbMembers( c ) );
+		for( int i = 0; i < m_components.nbMembers( c ); i++ ){
+			FaceHandle f = m_segmentationFaces[members[i]];
+			area += m_faceAreas[members[i]];
+			for( int j = 0; j < 3; j++ )
+				molecules.push_back( f->vertex( j )->info() );
 		}
-		if( area > _minArea && nbMol > _minLocs && area <= _maxArea && nbMol <= _maxLocs){
-			//Check if watershed is selected
-			if (_watershed && (nbMol > (1.5 * _nbLocsWatershed))){
-				KdPointCloud_D cloud;
-				cloud.m_pts.resize(nbMol);
-				double x = 0, y = 0, nbD = nbMol;
-				for (unsigned int n2 = 0; n2 < nbMol; n2++){
-					VertHandle v = m_infos[molecules[n2]].getMolecule();
-					cloud.m_pts[n2].m_x = v->point().x();
-					cloud.m_pts[n2].m_y = v->point().y();
-					x += cloud.m_pts[n2].m_x / nbD;
-					y += cloud.m_pts[n2].m_y / nbD;
-				}
-				fs << "For cluster [" << x << ", " << y << "] - " << nbMol << std::endl;
-				KdTree_2D_double tree(2, cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */));
-				tree.buildIndex();
-				double dWatershedSqr = _radiusWatershed * _radiusWatershed;
-				const double search_radius = static_cast<double>(dWatershedSqr);
-				std::vector<std::pair<std::size_t, double> > ret_matches;
-				nanoflann::SearchParams params;
-				std::size_t nMatches;
-				std::vector <std::pair< unsigned int, unsigned int >> indexesSup;
-				indexesSup.resize(nbMol);
-				for (unsigned int n2 = 0; n2 < nbMol; n2++){
-					const double queryPt[2] = { cloud.m_pts[n2].m_x, cloud.m_pts[n2].m_y };
-					indexesSup[n2].first = n2;
-					indexesSup[n2].second = tree.radiusSearch(&queryPt[0], search_radius, ret_matches, params);
-					//std::cout << "[" << cloud.m_pts[n2].m_x << ", " << cloud.m_pts[n2].m_y << "] ------> " << indexesSup[n2].second << std::endl;
-				}
-				std::sort(indexesSup.begin(), indexesSup.end(), boost::bind(&std::pair<unsigned int, unsigned int>::second, _1) > boost::bind(&std::pair<unsigned int, unsigned int>::second, _2));
-				double limitNb = _nbLocsWatershed * 0.8;
-				std::vector < unsigned int > localMaxima;
-				localMaxima.push_back(indexesSup[0].first);
-				unsigned int current = 1;
-				//std::cout << __LINE__ << std::endl;
-				while (indexesSup[current].second > limitNb){
-					bool tooclose = false;
-					unsigned int index1 = indexesSup[current].first, nKeep;
-					double d;
-					for (unsigned int n = 0; n < localMaxima.size() && !tooclose; n++){
-						unsigned int index2 = localMaxima[n];
-						d = Geometry::distanceSqr(cloud.m_pts[index1].m_x, cloud.m_pts[index1].m_y, cloud.m_pts[index2].m_x, cloud.m_pts[index2].m_y);
-						tooclose = (d < dWatershedSqr);
-						nKeep = n;
-					}
-					if (!tooclose)
-						localMaxima.push_back(index1);
-					current++;
-				}
-				for (unsigned int n = 0; n < localMaxima.size(); n++){
-					unsigned int index = localMaxima[n];
-					m_ptsLocalMax.push_back(Vec2md(cloud.m_pts[index].m_x, cloud.m_pts[index].m_y));
-					fs << "Local max = [" << cloud.m_pts[index].m_x << ", " << cloud.m_pts[index].m_y << "]" << std::endl;;
-				}
+		std::sort( molecules.begin(), molecules.end() );
+		molecules.erase( std::unique( molecules.begin(), molecules.end() ), molecules.end() );
+		m_areaComponents[c] = area;
+	}
+	delete [] selectionFaces;
 
-				//std::cout << __LINE__ << std::endl;
-				bool * closers = new bool[nbMol];
-				memset(closers, 0, nbMol * sizeof(bool));
-				unsigned int index = localMaxima[0];
-				for (unsigned int n = 0; n < nbMol; n++){
-					bool closer = true;
-					double d1 = Geometry::distanceSqr(cloud.m_pts[index].m_x, cloud.m_pts[index].m_y, cloud.m_pts[n].m_x, cloud.m_pts[n].m_y);
-					for (unsigned int i = 1; i < localMaxima.size() && closer; i++){
-						unsigned int index2 = localMaxima[i];
-						double d2 = Geometry::distanceSqr(cloud.m_pts[n].m_x, cloud.m_pts[n].m_y, cloud.m_pts[index2].m_x, cloud.m_pts[index2].m_y);
-						closer = d1 < d2;
-					}
-					closers[n] = closer;
-				}
+	m_segmentationCached = true;
+	m_cachedSelection = m_selection;
+	m_cachedCutD = _applyCutD;
+	m_cachedCutDSqr = _cutDSqr;
+}
 
-				//std::cout << __LINE__ << std::endl;
-				for (int i = 0; i < indexQueue; i++){
-					FaceHandle f = allFaces[i];
-					i0 = f->vertex(0)->info();
-					i1 = f->vertex(1)->info();
-					i2 = f->vertex(2)->info();
-					selectionMolecules[i0] = selectionMolecules[i1] = selectionMolecules[i2] = false;
-				}
+void WrapperVoronoiDiagram::clearSegmentationCache()
+{
+	if( m_segmentationNeighbors != NULL )
+		delete [] m_segmentationNeighbors;
+	m_segmentationNeighbors = NULL;
+	m_segmentationFaces.clear();
+	m_components.clear();
+	m_areaComponents.clear();
+	m_moleculesComponents.clear();
+	m_outlineComponents.clear();
+	m_objectComponents.clear();
+	m_lastObjects.clear();
+	m_segmentationCached = false;
+}
 
-				//std::cout << __LINE__ << std::endl;
-				nbMolsWatershed = 0;
-				for (unsigned int n = 0; n < nbMol; n++){
-					if (closers[n]){
-						moleculesWaterhshed[nbMolsWatershed] = molecules[n];
-						nbMolsWatershed++;
-						selectionMolecules[molecules[n]] = true;
-					}
-				}
+NeuronObjectList WrapperVoronoiDiagram::createVoronoiObjects(const double _minArea, const unsigned int _minLocs, const double _maxArea, const unsigned int _maxLocs, const bool _applyCutD, const double _cutDSqr, const bool _pca, const bool _watershed, const double _radiusWatershed, const double _nbLocsWatershed, const NeuronObjectList & _current)
+{
+	NeuronObjectList neuronObjects;
+	m_ptsLocalMax.clear();
 
-				//std::cout << __LINE__ << std::endl;
-				nbFacesWatershed = 0;
-				area = 0.;
-				for (int i = 0; i < indexQueue; i++){
-					FaceHandle f = allFaces[i];
-					i0 = f->vertex(0)->info();
-					i1 = f->vertex(1)->info();
-					i2 = f->vertex(2)->info();
-					if (selectionMolecules[i0] && selectionMolecules[i1] && selectionMolecules[i2]){
-						area += Geometry::getTriangleArea(f->vertex(0), f->vertex(1), f->vertex(2));
-						facesWatershed[nbFacesWatershed++] = f;
-					}
-					//else
-						//selectionFaces[f->info()] = true;
-				}
-				//std::cout << __LINE__ << std::endl;
-				for (int i = 0; i < indexQueue; i++){
-					FaceHandle f = allFaces[i];
-					selectionFaces[f->info()] = true;
-				}
-				//std::cout << __LINE__ << std::endl;
-				for (int i = 0; i < nbMolsWatershed; i++){
-					VertHandle v = m_infos[moleculesWaterhshed[i]].getMolecule();
-					Delaunay_triangulation_2::Face_circulator firstFace = m_delau.incident_faces(v);
-					Delaunay_triangulation_2::Face_circulator currentFace = firstFace;
-					do{
-						int index = currentFace->info();
-						//Test if the triangle is infinite (index == -1)
-						if (index >= 0)
-							selectionFaces[index] = false;
-						currentFace++;
-					} while (currentFace != firstFace);
-
-					/*FaceHandle f = facesWatershed[i];
-					selectionFaces[f->info()] = false;
-					for (int j = 0; j < 3; j++){
-							FaceHandle neigh = f->neighbor(j);
-							if (neigh->info() >= 0)
-								selectionFaces[neigh->info()] = false;
-					}*/
-				}
-				//std::cout << __LINE__ << std::endl;
-				indexQueue = nbFacesWatershed;
-				memcpy(allFaces, facesWatershed, indexQueue * sizeof(FaceHandle));
-				nbMol = nbMolsWatershed;
-				memcpy(molecules, moleculesWaterhshed, nbMolsWatershed * sizeof(unsigned int));
-			}
+	bool sameSelection = m_segmentationCached && ( m_selection == m_cachedSelection || m_selection == m_cachedObjectsSelection );
+	if( !sameSelection || _applyCutD != m_cachedCutD || ( _applyCutD && _cutDSqr != m_cachedCutDSqr ) )
+		computeSegmentationComponents( _applyCutD, _cutDSqr );
+	else
+		std::cout << "Reusing the " << m_components.nbComponents() << " components of the previous segmentation" << std::endl;
+	//The objects of the previous segmentation are only kept if they are still the current ones
+	bool keepObjects = ( _current == m_lastObjects && _pca == m_cachedPca );
+	m_cachedPca = _pca;
 
-			for (int i = 0; i < indexQueue; i++){
-				FaceHandle f = allFaces[i];
-				selectionFacesForOutline[f->info()] = true;
+	//The components are filtered in parallel and the outlines of the accepted ones are computed once
+	int nbComponents = m_components.nbComponents();
+	const int * labels = m_components.getLabels();
+	std::vector < char > keptComponents( nbComponents, 0 ), watershedComponents( nbComponents, 0 );
+#pragma omp parallel for schedule(dynamic, 64)
+	for( int c = 0; c < nbComponents; c++ ){
+		const int * members = m_components.members( c );
+		int nbMembers = m_components.nbMembers( c );
+		double area = m_areaComponents[c];
+		unsigned int nbMol = m_moleculesComponents[c].size();
+		if( !( area > _minArea && nbMol > _minLocs && area <= _maxArea && nbMol <= _maxLocs ) ) continue;
+		//The components split by the watershed are handled by the post-pass below
+		if( _watershed && ( nbMol > ( 1.5 * _nbLocsWatershed ) ) ){
+			watershedComponents[c] = 1;
+			continue;
+		}
+		keptComponents[c] = 1;
+		std::vector < Vec2dm > & outline = m_outlineComponents[c];
+		if( !outline.empty() ) continue;
+		for( int i = 0; i < nbMembers; i++ ){
+			FaceHandle f = m_segmentationFaces[members[i]];
+			for( int j = 0; j < 3; j++ ){
+				int neigh = m_segmentationNeighbors[3 * members[i] + j];
+				if( neigh >= 0 && labels[neigh] == c ) continue;
+				VertHandle v1 = f->vertex( ( j + 1 ) % 3 ), v2 = f->vertex( ( j + 2 ) % 3 );
+				outline.push_back( Vec2dm( v1->point().x(), v1->point().y() ) );
+				outline.push_back( Vec2dm( v2->point().x(), v2->point().y() ) );
 			}
+		}
+	}
 
-			/*std::cout << "*********************\nMolecules of cluster:\n";
-			for (unsigned int n = 0; n < nbMol; n++){
-				VertHandle v = m_infos[molecules[n]].getMolecule();
-				std::cout << "[" << v->point().x() << ", " << v->point().y() << "]" << std::endl;
-			}*/
-
-			//Determining the border edges
-			std::vector < Vec2dm > borderEdges;
-			for( int i = 0; i < indexQueue; i++ ){
-				FaceHandle f = allFaces[i];
-				for( int j = 0; j < 3; j++ ){
-					FaceHandle neigh = f->neighbor( j );
-					bool selected = (neigh->info() >= 0 );
-					if (selected) selected = selected && selectionFacesForOutline[neigh->info()];// selectionFacesOriginal[neigh->info()];
-					if( !selected ){
-						int index1 = ( j + 1 ) % 3, index2 = ( j + 2 ) % 3;
-						VertHandle v1 = f->vertex( index1 ), v2 = f->vertex( index2 );
-						borderEdges.push_back( Vec2dm( v1->point().x(), v1->point().y() ) );
-						borderEdges.push_back( Vec2dm( v2->point().x(), v2->point().y() ) );
-					}
-				}
+	//Watershed post-pass, one component per iteration. The components are disjoint so they share the molecule
+	//labels, and the neighbors are counted in the spatial index of the molecules
+	std::vector < int > watershedList;
+	for( int c = 0; c < nbComponents; c++ )
+		if( watershedComponents[c] )
+			watershedList.push_back( c );
+	std::vector < std::vector < WatershedPiece > > pieces( watershedList.size() );
+	if( !watershedList.empty() ){
+		const KdTree_2D_columns * tree = getSpatialIndex();
+		std::vector < int > moleculeComponents( m_nbMolecules, -1 ), moleculeIndexes( m_nbMolecules, -1 );
+		for( unsigned int n = 0; n < watershedList.size(); n++ ){
+			const std::vector < unsigned int > & molecules = m_moleculesComponents[watershedList[n]];
+			for( unsigned int i = 0; i < molecules.size(); i++ ){
+				moleculeComponents[molecules[i]] = watershedList[n];
+				moleculeIndexes[molecules[i]] = i;
 			}
-			
+		}
+#pragma omp parallel for schedule(dynamic, 1)
+		for( int n = 0; n < ( int )watershedList.size(); n++ )
+			splitWatershed( watershedList[n], tree, &moleculeComponents[0], &moleculeIndexes[0], _radiusWatershed, _nbLocsWatershed, pieces[n] );
+	}
+
+	m_selection.clearAll();
+
+	printf("Creation of 0 Voronoi objects.");
+	std::vector < FaceHandle > facesComponent;
+	for( int c = 0; c < nbComponents; c++ ){
+		NeuronObject * nobj = ( keepObjects ) ? m_objectComponents[c] : NULL;
+		m_objectComponents[c] = NULL;
+		if( !keptComponents[c] ) continue;
+		std::vector < unsigned int > & molecules = m_moleculesComponents[c];
+		if( nobj != NULL )
+			nobj->clearClusters();
+		else{
+			const int * members = m_components.members( c );
+			facesComponent.resize( m_components.nbMembers( c ) );
+			for( int i = 0; i < m_components.nbMembers( c ); i++ )
+				facesComponent[i] = m_segmentationFaces[members[i]];
 			VoronoiObject * obj = new VoronoiObject( this );
-			obj->setTriangles( allFaces, indexQueue );
-			obj->setMolecules( molecules, nbMol );
-			obj->setOutline( borderEdges );
+			obj->setTriangles( &facesComponent[0], facesComponent.size() );
+			obj->setMolecules( &molecules[0], molecules.size() );
+			obj->setOutline( m_outlineComponents[c] );
 			if (_pca)
 				obj->fitEllipsePCA();
 			else
 				obj->fitBoundingEllipse();
-			obj->setArea( area );
-			neuronObjects.push_back( new NeuronObject( obj ) );
+			obj->setArea( m_areaComponents[c] );
+			nobj = new NeuronObject( obj );
+		}
+		m_objectComponents[c] = nobj;
+		neuronObjects.push_back( nobj );
+		printf("\rCreation of %i Voronoi objects.", neuronObjects.size());
+		for( unsigned int i = 0; i < molecules.size(); i++ )
+			m_selection.set( molecules[i] );
+	}
 
+	//The pieces of the watershed are filtered as the components, they are never kept between segmentations
+	for( unsigned int n = 0; n < pieces.size(); n++ ){
+		for( unsigned int k = 0; k < pieces[n].size(); k++ ){
+			WatershedPiece & piece = pieces[n][k];
+			m_ptsLocalMax.push_back( piece.m_maximum );
+			unsigned int nbMol = piece.m_molecules.size();
+			if( piece.m_faces.empty() || !( piece.m_area > _minArea && nbMol > _minLocs && piece.m_area <= _maxArea && nbMol <= _maxLocs ) ) continue;
+			VoronoiObject * obj = new VoronoiObject( this );
+			obj->setTriangles( &piece.m_faces[0], piece.m_faces.size() );
+			obj->setMolecules( &piece.m_molecules[0], nbMol );
+			obj->setOutline( piece.m_outline );
+			if (_pca)
+				obj->fitEllipsePCA();
+			else
+				obj->fitBoundingEllipse();
+			obj->setArea( piece.m_area );
+			neuronObjects.push_back( new NeuronObject( obj ) );
 			printf("\rCreation of %i Voronoi objects.", neuronObjects.size());
+			for( unsigned int i = 0; i < nbMol; i++ )
+				m_selection.set( piece.m_molecules[i] );
+		}
+	}
+
+	regenerateIntensityColorVector();
+	std::sort( neuronObjects.begin(), neuronObjects.end(), sortNeuronbjects );
+
+	m_lastObjects = neuronObjects;
+	m_cachedObjectsSelection = m_selection;
+	return neuronObjects;
+}
+
+//Splits a component around its local maxima, the molecules with the most neighbors of the component within the
+//radius. They are taken by decreasing number of neighbors from a priority queue, each one suppressing the molecules
+//within the radius, until the number of neighbors falls under 80% of _nbLocs. Each molecule goes to its closest
+//maximum and a piece is made of the faces whose three molecules go to the same maximum
+void WrapperVoronoiDiagram::splitWatershed( const int _component, const KdTree_2D_columns * _tree, const int * _moleculeComponents, const int * _moleculeIndexes, const double _radius, const double _nbLocs, std::vector < WatershedPiece > & _pieces ) const
+{
+	const std::vector < unsigned int > & molecules = m_moleculesComponents[_component];
+	int nbMol = molecules.size();
+	const LocReal * xs = &m_moleculeXs[0], * ys = &m_moleculeYs[0];
+	const LocReal radiusSqr = static_cast < LocReal >( _radius * _radius );
+	nanoflann::SearchParams params;
 
-			for( int i = 0; i < indexQueue; i++ ){
-				FaceHandle f = allFaces[i];
-				m_selection[f->vertex( 0 )->info()] = true;
-				m_selection[f->vertex( 1 )->info()] = true;
-				m_selection[f->vertex( 2 )->info()] = true;
+	std::vector < std::pair < unsigned int, int > > counts( nbMol );
+	for( int n = 0; n < nbMol; n++ ){
+		unsigned int molecule = molecules[n];
+		const LocReal queryPt[2] = { xs[molecule], ys[molecule] };
+		ComponentNeighbors neighbors( radiusSqr, _moleculeComponents, _component );
+		_tree->findNeighbors( neighbors, queryPt, params );
+		counts[n] = std::make_pair( neighbors.size(), n );
+	}
+
+	std::priority_queue < std::pair < unsigned int, int > > queue( counts.begin(), counts.end() );
+	std::vector < char > suppressed( nbMol, 0 );
+	std::vector < int > maxima;
+	double limitNb = _nbLocs * 0.8;
+	while( !queue.empty() && ( maxima.empty() || queue.top().first > limitNb ) ){
+		int index = queue.top().second;
+		queue.pop();
+		if( suppressed[index] ) continue;
+		maxima.push_back( index );
+		unsigned int molecule = molecules[index];
+		const LocReal queryPt[2] = { xs[molecule], ys[molecule] };
+		ComponentNeighbors neighbors( radiusSqr, _moleculeComponents, _component, _moleculeIndexes, &suppressed[0] );
+		_tree->findNeighbors( neighbors, queryPt, params );
+	}
+
+	_pieces.resize( maxima.size() );
+	for( unsigned int k = 0; k < maxima.size(); k++ ){
+		unsigned int molecule = molecules[maxima[k]];
+		_pieces[k].m_maximum = Vec2md( xs[molecule], ys[molecule] );
+		_pieces[k].m_area = 0.;
+	}
+	std::vector < int > owners( nbMol );
+	for( int n = 0; n < nbMol; n++ ){
+		unsigned int molecule = molecules[n];
+		double dMin = DBL_MAX;
+		for( unsigned int k = 0; k < maxima.size(); k++ ){
+			unsigned int moleculeMax = molecules[maxima[k]];
+			double d = Geometry::distanceSqr( xs[molecule], ys[molecule], xs[moleculeMax], ys[moleculeMax] );
+			if( d < dMin ){
+				dMin = d;
+				owners[n] = k;
 			}
 		}
-		for( int i = 0; i < indexQueue; i++ ){
-			FaceHandle f = allFaces[i];
-			i0 = f->vertex( 0 )->info();
-			i1 = f->vertex( 1 )->info();
-			i2 = f->vertex( 2 )->info();
-			selectionMolecules[i0] = selectionMolecules[i1] = selectionMolecules[i2] = false;
-			selectionFacesForOutline[f->info()] = true;
+		_pieces[owners[n]].m_molecules.push_back( molecules[n] );
+	}
+
+	//Piece of each face of the component, -1 if its molecules go to different maxima
+	const int * members = m_components.members( _component );
+	int nbMembers = m_components.nbMembers( _component );
+	std::vector < int > facePieces( nbMembers );
+	for( int i = 0; i < nbMembers; i++ ){
+		FaceHandle f = m_segmentationFaces[members[i]];
+		int o0 = owners[_moleculeIndexes[f->vertex( 0 )->info()]], o1 = owners[_moleculeIndexes[f->vertex( 1 )->info()]], o2 = owners[_moleculeIndexes[f->vertex( 2 )->info()]];
+		facePieces[i] = ( o0 == o1 && o0 == o2 ) ? o0 : -1;
+		if( facePieces[i] < 0 ) continue;
+		_pieces[o0].m_faces.push_back( f );
+		_pieces[o0].m_area += m_faceAreas[members[i]];
+	}
+	const int * labels = m_components.getLabels();
+	for( int i = 0; i < nbMembers; i++ ){
+		int piece = facePieces[i];
+		if( piece < 0 ) continue;
+		FaceHandle f = m_segmentationFaces[members[i]];
+		for( int j = 0; j < 3; j++ ){
+			int neigh = m_segmentationNeighbors[3 * members[i] + j];
+			if( neigh >= 0 && labels[neigh] == _component && facePieces[std::lower_bound( members, members + nbMembers, neigh ) - members] == piece ) continue;
+			VertHandle v1 = f->vertex( ( j + 1 ) % 3 ), v2 = f->vertex( ( j + 2 ) % 3 );
+			_pieces[piece].m_outline.push_back( Vec2dm( v1->point().x(), v1->point().y() ) );
+			_pieces[piece].m_outline.push_back( Vec2dm( v2->point().x(), v2->point().y() ) );
 		}
 	}
+}
 
+//Statistics of the objects for each density factor, applied to the average density of the whole diagram
+std::vector < DensitySweep::Threshold > WrapperVoronoiDiagram::sweepDensityFactors( const std::vector < double > & _factors, const double _minArea, const unsigned int _minLocs, const double _maxArea, const unsigned int _maxLocs, const bool _applyCutD, const double _cutDSqr )
+{
+	int nbFaces = m_delau.number_of_faces();
+	int * faceMolecules = new int[3 * nbFaces], * neighborFaces = new int[3 * nbFaces];
+	bool * validFaces = new bool[nbFaces];
+	std::vector < FaceHandle > faces( nbFaces );
+	int cpt = 0;
+	for( Delaunay_triangulation_2::Finite_faces_iterator it = m_delau.finite_faces_begin(); it != m_delau.finite_faces_end(); it++, cpt++ ){
+		it->info() = cpt;
+		faces[cpt] = it;
+	}
+#pragma omp parallel for
+	for( int n = 0; n < nbFaces; n++ ){
+		FaceHandle f = faces[n];
+		for( int j = 0; j < 3; j++ ){
+			faceMolecules[3 * n + j] = f->vertex( j )->info();
+			neighborFaces[3 * n + j] = f->neighbor( j )->info();
+		}
+	}
+	for( int n = 0; n < nbFaces; n++ )
+		validFaces[n] = !_applyCutD || m_faceMaxEdgesSqr[n] <= _cutDSqr;
+
+	std::vector < DensitySweep::Threshold > thresholds( _factors.size() );
+	for( unsigned int n = 0; n < _factors.size(); n++ ){
+		thresholds[n].m_factor = _factors[n];
+		thresholds[n].m_threshold = _factors[n] * m_avgDensity;
+	}
+	DensitySweep sweep( faceMolecules, neighborFaces, m_faceAreas, m_faceMinDensities, validFaces, nbFaces, m_nbMolecules );
+	sweep.sweep( thresholds, _minArea, _minLocs, _maxArea, _maxLocs );
+
+	delete [] faceMolecules;
+	delete [] neighborFaces;
+	delete [] validFaces;
+	return thresholds;
+}
+
+//Length of the Delaunay edge at the given fraction of all the edges sorted by length
+double WrapperVoronoiDiagram::getEdgeLengthQuantile( const double _fraction )
+{
+	if( !m_edgeSegmentation.isBuilt() )
+		m_edgeSegmentation.build( m_delau, m_nbMolecules );
+	return m_edgeSegmentation.getQuantile( _fraction );
+}
+
+//Selects the molecules of the components with more than _minLocs molecules once the edges longer than _maxLength are removed
+void WrapperVoronoiDiagram::applyEdgeLengthThreshold( const double _maxLength, const unsigned int _minLocs )
+{
+	if( !m_edgeSegmentation.isBuilt() )
+		m_edgeSegmentation.build( m_delau, m_nbMolecules );
+	m_edgeSegmentation.label( _maxLength );
+	const int * labels = m_edgeSegmentation.getLabels();
+	m_selection.clearAll();
+	for( int n = 0; n < m_nbMolecules; n++ )
+		if( m_edgeSegmentation.componentSize( labels[n] ) > ( int )_minLocs )
+			m_selection.set( n );
+	m_nbSelection = m_selection.count();
 	regenerateIntensityColorVector();
-	std::sort( neuronObjects.begin(), neuronObjects.end(), sortNeuronbjects );
+}
 
-	delete [] selectionFaces;
-	delete [] allFaces;
-	delete [] molecules;
-	delete [] selectionMolecules;
-	delete [] selectionFacesOriginal;
+//The objects are the connected components of the molecules once the edges longer than _maxLength are removed, they
+//are made of the faces whose three edges are kept. It does not depend on the density selection
+NeuronObjectList WrapperVoronoiDiagram::createEdgeLengthObjects( const double _maxLength, const double _minArea, const unsigned int _minLocs, const double _maxArea, const unsigned int _maxLocs, const bool _pca )
+{
+	NeuronObjectList neuronObjects;
+	//The components of the density segmentation do not match the selection anymore
+	clearSegmentationCache();
+	if( !m_edgeSegmentation.isBuilt() )
+		m_edgeSegmentation.build( m_delau, m_nbMolecules );
+	int nbComponents = m_edgeSegmentation.label( _maxLength );
+	const int * labels = m_edgeSegmentation.getLabels();
 
-	delete[] facesWatershed;
+	//Molecules and faces of each component, stored contiguously
+	std::vector < int > firstMolecule( nbComponents + 1, 0 ), firstFace( nbComponents + 1, 0 ), next;
+	std::vector < unsigned int > molecules( m_nbMolecules );
+	for( int n = 0; n < m_nbMolecules; n++ )
+		firstMolecule[labels[n] + 1]++;
+	for( int c = 0; c < nbComponents; c++ )
+		firstMolecule[c + 1] += firstMolecule[c];
+	next.assign( firstMolecule.begin(), firstMolecule.end() - 1 );
+	for( int n = 0; n < m_nbMolecules; n++ )
+		molecules[next[labels[n]]++] = n;
 
-	fs.close();
+	int nbFaces = m_delau.number_of_faces();
+	//Same test as the labelling, so a face is kept exactly when its three edges are
+	float maxLengthSqr = m_edgeSegmentation.getMaxLengthSqr();
+	std::vector < FaceHandle > faces( nbFaces ), facesComponents( nbFaces );
+	std::vector < int > faceLabels( nbFaces, -1 );
+	for( Delaunay_triangulation_2::Finite_faces_iterator it = m_delau.finite_faces_begin(); it != m_delau.finite_faces_end(); it++ ){
+		int index = it->info();
+		faces[index] = it;
+		int label = labels[it->vertex( 0 )->info()];
+		if( m_faceMaxEdgesSqr[index] <= maxLengthSqr && labels[it->vertex( 1 )->info()] == label && labels[it->vertex( 2 )->info()] == label ){
+			faceLabels[index] = label;
+			firstFace[label + 1]++;
+		}
+	}
+	for( int c = 0; c < nbComponents; c++ )
+		firstFace[c + 1] += firstFace[c];
+	next.assign( firstFace.begin(), firstFace.end() - 1 );
+	for( int n = 0; n < nbFaces; n++ )
+		if( faceLabels[n] >= 0 )
+			facesComponents[next[faceLabels[n]]++] = faces[n];
 
+	//The components are filtered and their outlines computed in parallel
+	std::vector < double > areas( nbComponents, 0. );
+	std::vector < std::vector < Vec2dm > > outlines( nbComponents );
+	std::vector < char > keptComponents( nbComponents, 0 );
+#pragma omp parallel for schedule(dynamic, 64)
+	for( int c = 0; c < nbComponents; c++ ){
+		unsigned int nbMol = firstMolecule[c + 1] - firstMolecule[c];
+		if( firstFace[c + 1] == firstFace[c] || nbMol <= _minLocs || nbMol > _maxLocs ) continue;
+		double area = 0.;
+		for( int i = firstFace[c]; i < firstFace[c + 1]; i++ )
+			area += m_faceAreas[facesComponents[i]->info()];
+		if( !( area > _minArea && area <= _maxArea ) ) continue;
+		areas[c] = area;
+		keptComponents[c] = 1;
+		std::vector < Vec2dm > & outline = outlines[c];
+		for( int i = firstFace[c]; i < firstFace[c + 1]; i++ ){
+			FaceHandle f = facesComponents[i];
+			for( int j = 0; j < 3; j++ ){
+				int neigh = f->neighbor( j )->info();
+				if( neigh >= 0 && faceLabels[neigh] == c ) continue;
+				VertHandle v1 = f->vertex( ( j + 1 ) % 3 ), v2 = f->vertex( ( j + 2 ) % 3 );
+				outline.push_back( Vec2dm( v1->point().x(), v1->point().y() ) );
+				outline.push_back( Vec2dm( v2->point().x(), v2->point().y() ) );
+			}
+		}
+	}
+
+	m_selection.clearAll();
+	printf("Creation of 0 Voronoi objects.");
+	for( int c = 0; c < nbComponents; c++ ){
+		if( !keptComponents[c] ) continue;
+		VoronoiObject * obj = new VoronoiObject( this );
+		obj->setTriangles( &facesComponents[firstFace[c]], firstFace[c + 1] - firstFace[c] );
+		obj->setMolecules( &molecules[firstMolecule[c]], firstMolecule[c + 1] - firstMolecule[c] );
+		obj->setOutline( outlines[c] );
+		if (_pca)
+			obj->fitEllipsePCA();
+		else
+			obj->fitBoundingEllipse();
+		obj->setArea( areas[c] );
+		neuronObjects.push_back( new NeuronObject( obj ) );
+		printf("\rCreation of %i Voronoi objects.", neuronObjects.size());
+		for( int i = firstMolecule[c]; i < firstMolecule[c + 1]; i++ )
+			m_selection.set( molecules[i] );
+	}
+	m_nbSelection = m_selection.count();
+
+	regenerateIntensityColorVector();
+	std::sort( neuronObjects.begin(), neuronObjects.end(), sortNeuronbjects );
 	return neuronObjects;
 }
 
@@ -755,18 +1353,19 @@ void WrapperVoronoiDiagram::applyDensityFactorROIs( const double _factor, const
 
 	for( unsigned int n = 0; n < m_nbMolecules; n++ ){
 		GeneralTools::m_imw->m_progress->setValue( cpt++ );
-		VertHandle v = m_infos[n].getMolecule();
-		m_selection[n] = true;
+		VertHandle v = m_infos.getMolecule( n );
+		bool inside = true;
 		if( !_rois.empty() && _selectionOnROIs ){
-			m_selection[n] = false;
-			for( RoiList::const_iterator it = _rois.begin(); it != _rois.end() && !m_selection[n]; it++ ){
+			inside = false;
+			for( RoiList::const_iterator it = _rois.begin(); it != _rois.end() && !inside; it++ ){
 				const Roi & roi = *it;
-				m_selection[n] = roi.inside( v->point().x(), v->point().y() );
+				inside = roi.inside( v->point().x(), v->point().y() );
 			}
 		}
+		m_selection.set( n, inside );
 		if( m_selection[n] ){
 			nbInsideROIs++;
-			areaInsideROIs += m_infos[n].getData( MoleculeInfos::Area );
+			areaInsideROIs += m_infos.getData( MoleculeInfos::Area, n );
 		}
 	}
 
@@ -776,7 +1375,7 @@ void WrapperVoronoiDiagram::applyDensityFactorROIs( const double _factor, const
 	for( unsigned n = 0; n < m_nbMolecules; n++ ){
 		GeneralTools::m_imw->m_progress->setValue( cpt++ );
 		if( !m_selection[n] ) continue;
-		m_selection[n] = m_infos[n].getData( MoleculeInfos::LocalDensity ) > thresh;
+		m_selection.set( n, m_infos.getData( MoleculeInfos::LocalDensity, n ) > thresh );
 	}
 
 	regenerateIntensityColorVector();
@@ -40,24 +40,36 @@
 #include "SuperResObject.hpp"
 #include "GeneralTools.hpp"
 #include "MoleculeInfos.hpp"
+#include "NeighborGraph.hpp"
+#include "DensitySweep.hpp"
+#include "ConnectedComponents.hpp"
+#include "nanoflann.hpp"
+#include "EdgeLengthSegmentation.hpp"
+
+class DetectionSet;
 
 class WrapperVoronoiDiagram: public ObjectInterface{
 public:
-	WrapperVoronoiDiagram( DetectionPoint *, const int, const double, const double );
+	WrapperVoronoiDiagram( DetectionSet *, const double, const double );
 	~WrapperVoronoiDiagram();
 
+	bool update( DetectionSet * );
+
 	inline double getData( const int _typeHisto, const int _idx ) const {return m_data[_typeHisto][_idx];}
 	inline bool isPolygonFilled() const {return m_filled;}
 	inline void setPolygonFilled( const bool _val ){m_filled = _val;}
 	inline int nbMolecules() const {return m_nbMolecules;}
-	inline double getInfosData( const int _typeHisto, const int _idx ) const {return m_infos[_idx].getData( _typeHisto );}
-	inline double getInfosDataLog( const int _typeHisto, const int _idx ) const {return m_infos[_idx].getDataLog( _typeHisto );}
+	inline double getInfosData( const int _typeHisto, const int _idx ) const {return m_infos.getData( _typeHisto, _idx );}
+	inline double getInfosDataLog( const int _typeHisto, const int _idx ) const {return m_infos.getDataLog( _typeHisto, _idx );}
 	inline double getAverageDensity() const {return m_avgDensity;}
 	inline double getFactorDensity() const {return m_factorDensity;}
 	inline void setFactorDensity( const double _val ){m_factorDensity = _val;}
 	inline double getArea() const {return m_area;}
 	inline int getNbFiniteTriangles() const {return m_nbFiniteTriangles;}
-	inline MoleculeInfos * getMoleculeInfos() const {return m_infos;}
+	inline float getFaceArea( const int _idx ) const {return m_faceAreas[_idx];}
+	inline float getFaceMaxEdgeSqr( const int _idx ) const {return m_faceMaxEdgesSqr[_idx];}
+	inline LocReal getFaceMinDensity( const int _idx ) const {return m_faceMinDensities[_idx];}
+	inline const MoleculeInfos * getMoleculeInfos() const {return &m_infos;}
 	inline const double getWidth() const { return m_originalWidth; }
 	inline const double getHeight() const { return m_originalHeight; }
 
@@ -68,17 +80,52 @@ public:
 	void forceRegenerateSelection();
 	void determineSelection( const bool = false );
 	void resetDataSelection();
-	void regenerateIntensityColorVector();
-
-	NeuronObjectList createVoronoiObjects(const double = 0., const unsigned int = 1, const double = DBL_MAX, const unsigned int = UINT_MAX, const bool = false, const double = DBL_MAX, const bool = true, const bool = false, const double = 60., const double = 60.);
+	void regenerateIntensityColorVector() const;
+	void getCellTriangles( const int, Vec2mf * ) const;
+	inline int nbCellTriangleVertices( const int _idx ) const {return 3 * m_sizeCell[_idx];}
+	inline unsigned int getSeedVertex( const int _idx ) const {return m_nbVoronoiVertices - m_nbMolecules + _idx;}
+	//Feature holding the local density of the rank, the rank 1 is MoleculeInfos::LocalDensity
+	inline int getDensityFeature( const int _rank ) const {return ( _rank == 1 ) ? MoleculeInfos::LocalDensity : _rank + 1;}
+	inline int getMaxDensityRank() const {return m_maxDensityRank;}
+
+	static inline void setMaxDensityRank( const int _val ){m_maxDensityRankParam = _val;}
+	static inline int getMaxDensityRankParam(){return m_maxDensityRankParam;}
+
+	NeuronObjectList createVoronoiObjects(const double = 0., const unsigned int = 1, const double = DBL_MAX, const unsigned int = UINT_MAX, const bool = false, const double = DBL_MAX, const bool = true, const bool = false, const double = 60., const double = 60., const NeuronObjectList & = NeuronObjectList());
 	void iterativeAddCells( FaceHandle, FaceHandle *, int &, bool * );
+	std::vector < DensitySweep::Threshold > sweepDensityFactors( const std::vector < double > &, const double = 0., const unsigned int = 1, const double = DBL_MAX, const unsigned int = UINT_MAX, const bool = false, const double = DBL_MAX );
+	double getEdgeLengthQuantile( const double );
+	void applyEdgeLengthThreshold( const double, const unsigned int = 1 );
+	NeuronObjectList createEdgeLengthObjects( const double, const double = 0., const unsigned int = 1, const double = DBL_MAX, const unsigned int = UINT_MAX, const bool = true );
 
 	const double getMeanDensityFromSelectedLocalizations( unsigned int *, const unsigned int ) const;
 
 	void applyDensityFactorROIs( const double, const bool, const bool, const RoiList & );
 
+protected:
+	static const int NB_COLOR_LEVELS = 256;
+
+	//Part of a component split by the watershed
+	struct WatershedPiece{
+		std::vector < FaceHandle > m_faces;
+		std::vector < unsigned int > m_molecules;
+		std::vector < Vec2dm > m_outline;
+		double m_area;
+		Vec2md m_maximum;
+	};
+
 protected:
 	void generateDisplay();
+	void generateDisplayBuffers() const;
+	void generateRankDensities( const int, const int * = NULL );
+	void findUnchangedMolecules( std::vector < int > & ) const;
+	bool copyPreviousCell( const int, const std::vector < int > &, const double *, Vec2mf *, int * ) const;
+	void releaseDisplay();
+	void computeSegmentationComponents( const bool, const double );
+	void clearSegmentationCache();
+	const KdTree_2D_columns * getSpatialIndex();
+	void releaseSpatialIndex();
+	void splitWatershed( const int, const KdTree_2D_columns *, const int *, const int *, const double, const double, std::vector < WatershedPiece > & ) const;
 
 protected:
 	double m_originalWidth, m_originalHeight;
@@ -86,26 +133,66 @@ protected:
 
 	double ** m_data;
 
-	MoleculeInfos * m_infos;
-	EdgeCirc * m_edgesVoronoiPolygons;
+	MoleculeInfos m_infos;
+	NeighborGraph m_neighborGraph;
 
 	int m_nbMolecules, m_nbFiniteTriangles, m_nbOriginalPoints;
-	double * m_areaTriangles;
+	//Per finite face, indexed by its info: area, longest squared edge and minimal local density of its molecules
+	float * m_faceAreas, * m_faceMaxEdgesSqr;
+	LocReal * m_faceMinDensities;
 	bool m_filled;
 
-	Vec2mf * m_linesCell;
-	int * m_firstVerticesLine, * m_sizeVerticesLine;
-	Color4D * m_colorsLine;
-	int m_nbVertForLines;
+	//Indexed mesh of the cells: unique Voronoi vertices, then one seed vertex per molecule for the triangle fans
+	Vec2mf * m_voronoiVertices;
+	int m_nbVoronoiVertices;
+	unsigned int * m_cellIndexes;
+	int * m_firstCellVertex, * m_sizeCell;
+	int m_nbCellVertices;
 
-	Vec2mf * m_trianglesCell;
-	int * m_firstVerticesTriangle, * m_sizeVerticesTriangle;
-	Color4D * m_colorsTriangle;
-	int m_nbVertForTriangles;
+	//Index buffers of the selected cells sorted by color level, built the first time the diagram is drawn
+	mutable unsigned int * m_lineIndexes, * m_triangleIndexes;
+	mutable int m_firstLineLevel[NB_COLOR_LEVELS + 1], m_firstTriangleLevel[NB_COLOR_LEVELS + 1];
+	mutable Color4D m_levelColors[NB_COLOR_LEVELS];
 
-	double m_avgDensity, m_factorDensity, m_area;
+	double m_avgDensity, m_factorDensity, m_area, m_maxArea;
+	int m_maxDensityRank;
+	static int m_maxDensityRankParam;
 
 	std::vector < Vec2md > m_ptsLocalMax;
+	//Molecules are renumbered in the triangulation order, duplicated localizations have no molecule (-1)
+	std::vector < unsigned int > m_moleculeToPoint;
+	std::vector < int > m_pointToMolecule;
+	//Spatial index of the molecules on their own coordinates, built the first time the watershed needs it
+	std::vector < LocReal > m_moleculeXs, m_moleculeYs;
+	KdColumns_L * m_kdColumns;
+	KdTree_2D_columns * m_kdTree;
+	//Only set during an update: the previous features, the previous molecule of each localization and the
+	//localizations whose Delaunay neighbors changed
+	MoleculeInfos m_previousInfos;
+	std::vector < int > m_pointToPrevious;
+	std::vector < bool > m_changedPoints;
+	//Cells of the previous diagram, their vertices below m_previousNbFaces being the circumcenters of its faces
+	std::vector < unsigned int > m_previousCellIndexes;
+	std::vector < int > m_previousFirstCellVertex, m_previousSizeCell;
+	int m_previousNbFaces;
+
+	//Connected components of the last segmentation, kept for the selection and the cut distance they were computed
+	//with (or the selection of the objects they gave). A change of the size filters only filters them again, and the
+	//objects still accepted are kept when they are still the current ones
+	bool m_segmentationCached, m_cachedCutD, m_cachedPca;
+	double m_cachedCutDSqr;
+	BitMask m_cachedSelection, m_cachedObjectsSelection;
+	std::vector < FaceHandle > m_segmentationFaces;
+	int * m_segmentationNeighbors;
+	ConnectedComponents m_components;
+	std::vector < double > m_areaComponents;
+	std::vector < std::vector < unsigned int > > m_moleculesComponents;
+	std::vector < std::vector < Vec2dm > > m_outlineComponents;
+	std::vector < NeuronObject * > m_objectComponents;
+	NeuronObjectList m_lastObjects;
+
+	//Delaunay edges sorted by length for the edge length segmentation, built the first time it is used
+	EdgeLengthSegmentation m_edgeSegmentation;
 
 	friend class VoronoiObject;
 	friend class VoronoiCluster;
@@ -53,6 +53,8 @@
 #include <cmath>   // for fabs(),...
 #include <limits>
 
+#include "Precision.hpp"
+
 // Avoid conflicting declaration of min/max macros in windows headers
 #if !defined(NOMINMAX) && (defined(_WIN32) || defined(_WIN32_)  || defined(WIN32) || defined(_WIN64))
 # define NOMINMAX
@@ -1445,5 +1447,35 @@ struct KdPointCloud
 typedef  KdPointCloud<double> KdPointCloud_D;
 typedef nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Simple_Adaptor<double, KdPointCloud_D >, KdPointCloud_D, 2 /* dim */> KdTree_2D_double;
 
+// Dataset adaptor reading the coordinates directly from x/y columns, without copying them
+template <typename T>
+struct KdColumns
+{
+	const T * m_xs, * m_ys;
+	size_t m_nb;
+
+	KdColumns(const T * _xs, const T * _ys, const size_t _nb) :m_xs(_xs), m_ys(_ys), m_nb(_nb){}
+
+	inline size_t kdtree_get_point_count() const { return m_nb; }
+
+	inline T kdtree_distance(const T *p1, const size_t idx_p2, size_t /*size*/) const
+	{
+		const T d0 = p1[0] - m_xs[idx_p2];
+		const T d1 = p1[1] - m_ys[idx_p2];
+		return d0*d0 + d1*d1;
+	}
+
+	inline T kdtree_get_pt(const size_t idx, int dim) const
+	{
+		return (dim == 0) ? m_xs[idx] : m_ys[idx];
+	}
+
+	template <class BBOX>
+	bool kdtree_get_bbox(BBOX& /*bb*/) const { return false; }
+};
+
+typedef KdColumns<LocReal> KdColumns_L;
+typedef nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Simple_Adaptor<LocReal, KdColumns_L >, KdColumns_L, 2 /* dim */> KdTree_2D_columns;
+
 
 #endif /* NANOFLANN_HPP_ */